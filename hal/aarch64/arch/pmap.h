@@ -36,9 +36,13 @@
 #define PGHD_READ       0x00U
 #define PGHD_MASK       0x1fU
 
+/* Block descriptor in level 2 translation table */
+#define SIZE_LARGEPAGE 0x200000UL
+
 
 /* Page flags */
-#define PAGE_FREE 0x00000001U
+#define PAGE_FREE   0x00000001U
+#define PAGE_CACHED 0x00000080U /* Single page held in a per-CPU cache */
 
 #define PAGE_OWNER_BOOT   (0U << 1)
 #define PAGE_OWNER_KERNEL (1U << 1)
@@ -225,13 +225,21 @@ static void _pmap_asidDealloc(pmap_t *pmap)
 static void _pmap_cacheOpBeforeChange(descr_t oldEntry, descr_t newEntry, ptr_t vaddr, unsigned int lvl)
 {
 	addr_t pa;
+	size_t size, offs;
 	int oldCachedRW, newNoncached;
 	if ((oldEntry & DESCR_VALID) == 0U) {
 		return;
 	}
 
-	if (lvl != 3U) {
-		/* Large mappings currently not supported */
+	if (lvl == 2U) {
+		size = SIZE_LARGEPAGE;
+		vaddr &= ~((ptr_t)SIZE_LARGEPAGE - 1U);
+	}
+	else if (lvl == 3U) {
+		size = SIZE_PAGE;
+	}
+	else {
+		/* Level 1 blocks currently not supported */
 		return;
 	}
 
@@ -242,13 +250,15 @@ static void _pmap_cacheOpBeforeChange(descr_t oldEntry, descr_t newEntry, ptr_t
 		pa = _pmap_hwTranslate(vaddr);
 		if (((pa & 1U) == 0U) && (DESCR_PA(oldEntry) == (pa & ((1UL << 48) - (1UL << 12))))) {
 			/* VA is currently mapped - simply flush cache by virtual address */
-			hal_cpuFlushDataCache(vaddr, vaddr + SIZE_PAGE);
+			hal_cpuFlushDataCache(vaddr, vaddr + size);
 		}
 		else {
 			/* Temporarily map to pmap_common.scratch_page */
 			/* TODO: this will only work properly if the processor uses PIPT data cache (typical but not required on ARMv8) */
-			_pmap_mapScratch(pmap_common.scratch_page, DESCR_PA(oldEntry));
-			hal_cpuFlushDataCache((ptr_t)pmap_common.scratch_page, (ptr_t)pmap_common.scratch_page + SIZE_PAGE);
+			for (offs = 0; offs < size; offs += SIZE_PAGE) {
+				_pmap_mapScratch(pmap_common.scratch_page, DESCR_PA(oldEntry) + offs);
+				hal_cpuFlushDataCache((ptr_t)pmap_common.scratch_page, (ptr_t)pmap_common.scratch_page + SIZE_PAGE);
+			}
 		}
 	}
 }
@@ -256,18 +266,26 @@ static void _pmap_cacheOpBeforeChange(descr_t oldEntry, descr_t newEntry, ptr_t
 
 static void _pmap_cacheOpAfterChange(descr_t newEntry, ptr_t vaddr, unsigned int lvl)
 {
+	size_t size;
 	if ((newEntry & DESCR_VALID) == 0U) {
 		return;
 	}
 
-	if (lvl != 3U) {
-		/* Large mappings currently not supported */
+	if (lvl == 2U) {
+		size = SIZE_LARGEPAGE;
+		vaddr &= ~((ptr_t)SIZE_LARGEPAGE - 1U);
+	}
+	else if (lvl == 3U) {
+		size = SIZE_PAGE;
+	}
+	else {
+		/* Level 1 blocks currently not supported */
 		return;
 	}
 
 	/* Instruction cache may contain old data */
 	if ((newEntry & (DESCR_PXN | DESCR_UXN)) == 0U) {
-		hal_cpuInvalInstrCache(vaddr, vaddr + SIZE_PAGE);
+		hal_cpuInvalInstrCache(vaddr, vaddr + size);
 	}
 }
 
@@ -399,11 +417,11 @@ void pmap_switch(pmap_t *pmap)
 }
 
 
-/* Writes the translation descriptor into the level 3 translation table.
+/* Writes the translation descriptor into the level `lvl` translation table (page at level 3, block above).
  * Assumes that the table is already mapped mapped into pmap_common.scratch_tt */
-static void _pmap_writeTtl3(void *va, addr_t pa, vm_attr_t attr, asid_t asid)
+static void _pmap_writeDescr(void *va, addr_t pa, vm_attr_t attr, asid_t asid, unsigned int lvl)
 {
-	unsigned int idx = (unsigned int)TTL_IDX(3U, va);
+	unsigned int idx = (unsigned int)TTL_IDX(lvl, va);
 	descr_t descr, oldDescr;
 
 	oldDescr = pmap_common.scratch_tt[idx];
@@ -412,7 +430,11 @@ static void _pmap_writeTtl3(void *va, addr_t pa, vm_attr_t attr, asid_t asid)
 		descr = 0;
 	}
 	else {
-		descr = DESCR_PA(pa) | DESCR_VALID | DESCR_TABLE | DESCR_AF | DESCR_ISH;
+		descr = DESCR_PA(pa) | DESCR_VALID | DESCR_AF | DESCR_ISH;
+		if (lvl == 3U) {
+			descr |= DESCR_TABLE;
+		}
+
 		if ((ptr_t)va < VADDR_USR_MAX) {
 			descr |= DESCR_nG;
 		}
@@ -449,7 +471,7 @@ static void _pmap_writeTtl3(void *va, addr_t pa, vm_attr_t attr, asid_t asid)
 		}
 	}
 
-	_pmap_cacheOpBeforeChange(oldDescr, descr, (ptr_t)va, 3);
+	_pmap_cacheOpBeforeChange(oldDescr, descr, (ptr_t)va, lvl);
 	hal_cpuDataSyncBarrier();
 	if ((oldDescr & DESCR_VALID) != 0U) {
 		/* D8.16.1 Using break-before-make when updating translation table entries */
@@ -459,7 +481,7 @@ static void _pmap_writeTtl3(void *va, addr_t pa, vm_attr_t attr, asid_t asid)
 
 	pmap_common.scratch_tt[idx] = descr;
 	hal_cpuDataSyncBarrier();
-	_pmap_cacheOpAfterChange(descr, (ptr_t)va, 3);
+	_pmap_cacheOpAfterChange(descr, (ptr_t)va, lvl);
 }
 
 
@@ -476,6 +498,16 @@ static int _pmap_enter(pmap_t *pmap, addr_t pa, void *vaddr, vm_attr_t attr, pag
 	tt = pmap->ttl1;
 	for (lvl = 1; lvl <= 2U; lvl++) {
 		entry = tt[TTL_IDX(lvl, vaddr)];
+		if (((entry & DESCR_VALID) != 0U) && ((entry & DESCR_TABLE) == 0U)) {
+			/* Block is replaced by a table, its remaining pages are faulted in again */
+			if (alloc == NULL) {
+				return -EFAULT;
+			}
+			tt[TTL_IDX(lvl, vaddr)] = 0;
+			pmap_tlbInval((ptr_t)vaddr, asid);
+			entry = 0;
+		}
+
 		if ((entry & DESCR_VALID) == 0U) {
 			if (alloc == NULL) {
 				return -EFAULT;
@@ -489,10 +521,6 @@ static int _pmap_enter(pmap_t *pmap, addr_t pa, void *vaddr, vm_attr_t attr, pag
 			hal_cpuDataSyncBarrier();
 			alloc = NULL;
 		}
-		else if ((entry & DESCR_TABLE) == 0U) {
-			/* Already mapped as a block - not supported right now */
-			return -EINVAL;
-		}
 		else {
 			addr = DESCR_PA(entry);
 		}
@@ -501,7 +529,7 @@ static int _pmap_enter(pmap_t *pmap, addr_t pa, void *vaddr, vm_attr_t attr, pag
 		tt = pmap_common.scratch_tt;
 	}
 
-	_pmap_writeTtl3(vaddr, pa, attr, asid);
+	_pmap_writeDescr(vaddr, pa, attr, asid, 3U);
 
 	return EOK;
 }
@@ -519,6 +547,69 @@ int pmap_enter(pmap_t *pmap, addr_t paddr, void *vaddr, vm_attr_t attr, page_t *
 }
 
 
+int pmap_enterLarge(pmap_t *pmap, addr_t paddr, void *vaddr, vm_attr_t attr, page_t *alloc, addr_t *ptable)
+{
+	unsigned int i, idx1 = (unsigned int)TTL_IDX(1U, vaddr);
+	descr_t entry;
+	addr_t addr;
+	spinlock_ctx_t sc;
+
+	*ptable = 0U;
+
+	if ((((ptr_t)vaddr | paddr) & (SIZE_LARGEPAGE - 1U)) != 0U) {
+		return -EINVAL;
+	}
+
+	hal_spinlockSet(&pmap_common.lock, &sc);
+
+	entry = pmap->ttl1[idx1];
+	if ((entry & DESCR_VALID) == 0U) {
+		if (alloc == NULL) {
+			hal_spinlockClear(&pmap_common.lock, &sc);
+			return -EFAULT;
+		}
+
+		addr = alloc->addr;
+		_pmap_mapScratch(pmap_common.scratch_page, addr);
+		hal_memset(pmap_common.scratch_page, 0, SIZE_PAGE);
+		hal_cpuDataSyncBarrier();
+		pmap->ttl1[idx1] = DESCR_PA(addr) | DESCR_VALID | DESCR_TABLE;
+		hal_cpuDataSyncBarrier();
+	}
+	else if ((entry & DESCR_TABLE) == 0U) {
+		hal_spinlockClear(&pmap_common.lock, &sc);
+		return -EINVAL;
+	}
+	else {
+		addr = DESCR_PA(entry);
+	}
+
+	_pmap_mapScratch(pmap_common.scratch_tt, addr);
+
+	entry = pmap_common.scratch_tt[TTL_IDX(2U, vaddr)];
+	if ((entry & (DESCR_TABLE | DESCR_VALID)) == (DESCR_TABLE | DESCR_VALID)) {
+		/* Translation table can be replaced only if nothing is mapped through it */
+		_pmap_mapScratch(pmap_common.scratch_tt, DESCR_PA(entry));
+		for (i = 0U; i < 512U; i++) {
+			if ((pmap_common.scratch_tt[i] & DESCR_VALID) != 0U) {
+				hal_spinlockClear(&pmap_common.lock, &sc);
+				return -EBUSY;
+			}
+		}
+		*ptable = DESCR_PA(entry);
+
+		_pmap_mapScratch(pmap_common.scratch_tt, addr);
+		pmap_common.scratch_tt[TTL_IDX(2U, vaddr)] = 0;
+		pmap_tlbInval((ptr_t)vaddr, pmap->asid);
+	}
+
+	_pmap_writeDescr(vaddr, paddr, attr, pmap->asid, 2U);
+	hal_spinlockClear(&pmap_common.lock, &sc);
+
+	return EOK;
+}
+
+
 static void _pmap_remove(pmap_t *pmap, void *vstart, void *vend)
 {
 	unsigned int lvl;
@@ -561,6 +652,11 @@ static void _pmap_remove(pmap_t *pmap, void *vstart, void *vend)
 			tt[TTL_IDX(lvl, vaddr)] = 0;
 			pmap_tlbInval(vaddr, pmap->asid);
 			_pmap_cacheOpAfterChange(0, vaddr, lvl);
+
+			/* Block is removed as a whole */
+			if (lvl == 2U) {
+				vaddr = (vaddr & ~((ptr_t)SIZE_LARGEPAGE - 1U)) + SIZE_LARGEPAGE - SIZE_PAGE;
+			}
 		}
 		else {
 			descrValid = 1;
@@ -581,6 +677,84 @@ int pmap_remove(pmap_t *pmap, void *vstart, void *vend)
 }
 
 
+int pmap_writeProtect(pmap_t *pmap, void *vstart, void *vend)
+{
+	volatile descr_t *tt = pmap_common.scratch_tt;
+	descr_t entry;
+	ptr_t vaddr, end;
+	unsigned int idx;
+	spinlock_ctx_t sc;
+
+	hal_spinlockSet(&pmap_common.lock, &sc);
+
+	for (vaddr = (ptr_t)vstart; vaddr < (ptr_t)vend; vaddr = end) {
+		/* Range covered by a single level 3 table */
+		end = (vaddr & ~((ptr_t)SIZE_LARGEPAGE - 1U)) + SIZE_LARGEPAGE;
+		if (end > (ptr_t)vend) {
+			end = (ptr_t)vend;
+		}
+
+		entry = pmap->ttl1[TTL_IDX(1U, vaddr)];
+		if ((entry & (DESCR_TABLE | DESCR_VALID)) != (DESCR_TABLE | DESCR_VALID)) {
+			continue;
+		}
+		_pmap_mapScratch(pmap_common.scratch_tt, DESCR_PA(entry));
+
+		idx = (unsigned int)TTL_IDX(2U, vaddr);
+		entry = tt[idx];
+		if ((entry & DESCR_VALID) == 0U) {
+			continue;
+		}
+
+		/* Permission only change doesn't require break-before-make */
+		if ((entry & DESCR_TABLE) == 0U) {
+			tt[idx] = entry | DESCR_AP2;
+			continue;
+		}
+		_pmap_mapScratch(pmap_common.scratch_tt, DESCR_PA(entry));
+
+		for (; vaddr < end; vaddr += SIZE_PAGE) {
+			idx = (unsigned int)TTL_IDX(3U, vaddr);
+			if ((tt[idx] & DESCR_VALID) != 0U) {
+				tt[idx] |= DESCR_AP2;
+			}
+		}
+	}
+
+	hal_cpuDataSyncBarrier();
+	if (pmap->asid != ASID_NONE) {
+		hal_tlbInvalASID_IS(pmap->asid);
+	}
+	hal_spinlockClear(&pmap_common.lock, &sc);
+
+	return EOK;
+}
+
+
+int pmap_isWritable(pmap_t *pmap, void *vaddr)
+{
+	volatile descr_t *tt = pmap->ttl1;
+	descr_t entry = 0;
+	unsigned int lvl;
+	spinlock_ctx_t sc;
+
+	hal_spinlockSet(&pmap_common.lock, &sc);
+
+	for (lvl = 1; lvl <= 3U; lvl++) {
+		entry = tt[TTL_IDX(lvl, vaddr)];
+		if (((entry & DESCR_VALID) == 0U) || (lvl == 3U) || ((entry & DESCR_TABLE) == 0U)) {
+			break;
+		}
+		_pmap_mapScratch(pmap_common.scratch_tt, DESCR_PA(entry));
+		tt = pmap_common.scratch_tt;
+	}
+
+	hal_spinlockClear(&pmap_common.lock, &sc);
+
+	return (((entry & DESCR_VALID) != 0U) && ((entry & DESCR_AP2) == 0U)) ? 1 : 0;
+}
+
+
 /* Functions returns physical address associated with specified virtual address */
 addr_t pmap_resolve(pmap_t *pmap, void *vaddr)
 {
@@ -600,7 +774,8 @@ addr_t pmap_resolve(pmap_t *pmap, void *vaddr)
 				break;
 			}
 			else if ((lvl == 3U) || ((entry & DESCR_TABLE) == 0U)) {
-				addr = DESCR_PA(entry);
+				/* Offset within block, page offset is masked below */
+				addr = DESCR_PA(entry) | ((ptr_t)vaddr & ((1UL << (39U - (9U * lvl))) - 1U));
 				break;
 			}
 			else {
@@ -415,6 +415,73 @@ int pmap_remove(pmap_t *pmap, void *vstart, void *vend)
 }
 
 
+int pmap_writeProtect(pmap_t *pmap, void *vstart, void *vend)
+{
+	unsigned int pti;
+	addr_t addr;
+	spinlock_ctx_t sc;
+	ptr_t vaddr, end;
+
+	hal_spinlockSet(&pmap_common.lock, &sc);
+
+	const u8 asid = pmap_common.asids[pmap->asid_ix];
+
+	for (vaddr = (ptr_t)vstart; vaddr < (ptr_t)vend; vaddr = end) {
+		/* Range covered by a single page of L2 tables */
+		end = (vaddr & ~0x3fffffU) + 0x400000U;
+		if ((end == 0U) || (end > (ptr_t)vend)) {
+			end = (ptr_t)vend;
+		}
+
+		addr = pmap->pdir[ID_PDIR(vaddr)];
+		if (addr == PDIR_TYPE_INVALID) {
+			continue;
+		}
+
+		if (pmap_common.kptab[ID_PTABLE(pmap_common.sptab)] != ((addr & ~0xfffU) | attrMap[SCRATCH_ATTRS])) {
+			_pmap_mapScratch(addr, asid);
+		}
+
+		for (; vaddr < end; vaddr += SIZE_PAGE) {
+			pti = ID_PTABLE(vaddr);
+			if ((pmap_common.sptab[pti] & 0x3U) != 0U) {
+				pmap_common.sptab[pti] |= TT2S_READONLY;
+			}
+		}
+		hal_cpuCleanDataCache((ptr_t)pmap_common.sptab, (ptr_t)pmap_common.sptab + SIZE_PAGE);
+	}
+
+	hal_cpuDataSyncBarrier();
+	hal_cpuInvalASIDAll(asid);
+	hal_spinlockClear(&pmap_common.lock, &sc);
+
+	return EOK;
+}
+
+
+int pmap_isWritable(pmap_t *pmap, void *vaddr)
+{
+	addr_t addr;
+	spinlock_ctx_t sc;
+	int ret = 0;
+
+	hal_spinlockSet(&pmap_common.lock, &sc);
+
+	addr = pmap->pdir[ID_PDIR((ptr_t)vaddr)];
+	if (addr != PDIR_TYPE_INVALID) {
+		_pmap_mapScratch(addr, pmap_common.asids[pmap->asid_ix]);
+		addr = pmap_common.sptab[ID_PTABLE((ptr_t)vaddr)];
+		if (((addr & 0x3U) != 0U) && ((addr & TT2S_READONLY) == 0U)) {
+			ret = 1;
+		}
+	}
+
+	hal_spinlockClear(&pmap_common.lock, &sc);
+
+	return ret;
+}
+
+
 /* Functions returns physical address associated with specified virtual address */
 addr_t pmap_resolve(pmap_t *pmap, void *vaddr)
 {
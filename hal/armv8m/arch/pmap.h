@@ -27,7 +27,8 @@
 #define PGHD_READ       0x00U
 
 /* Page flags */
-#define PAGE_FREE 0x00000001U
+#define PAGE_FREE   0x00000001U
+#define PAGE_CACHED 0x00000080U /* Single page held in a per-CPU cache */
 
 #define PAGE_OWNER_BOOT   (0U << 1)
 #define PAGE_OWNER_KERNEL (1U << 1)
@@ -43,6 +43,9 @@
 #define PGHD_4MB_GLOBAL 0x100U
 #define PGHD_4MB_PAT    0x1000U
 
+/* Page directory entry mapping 4 MB page directly (PSE) */
+#define SIZE_LARGEPAGE 0x400000U
+
 
 /* Architecture dependent page table attributes */
 #define PTHD_PRESENT 0x01U
@@ -51,7 +54,8 @@
 
 
 /* Page flags */
-#define PAGE_FREE 0x00000001U
+#define PAGE_FREE   0x00000001U
+#define PAGE_CACHED 0x00000080U /* Single page held in a per-CPU cache */
 
 #define PAGE_OWNER_BOOT   (0U << 1)
 #define PAGE_OWNER_KERNEL (1U << 1)
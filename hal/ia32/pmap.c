@@ -64,7 +64,8 @@ addr_t pmap_destroy(pmap_t *pmap, unsigned int *i)
 	unsigned int kernel = ((VADDR_KERNEL + SIZE_PAGE) & ~(SIZE_PAGE - 1U)) >> 22;
 
 	while (*i < kernel) {
-		if (pmap->pdir[*i] != 0U) {
+		/* Large pages have no page table to free */
+		if ((pmap->pdir[*i] != 0U) && ((pmap->pdir[*i] & PGHD_4MB) == 0U)) {
 			return pmap->pdir[(*i)++] & ~(SIZE_PAGE - 1U);
 		}
 		(*i)++;
@@ -85,16 +86,18 @@ int _pmap_enter(u32 *pdir, addr_t *pt, addr_t paddr, void *vaddr, vm_attr_t attr
 	addr_t addr;
 	addr_t *ptable;
 	u32 pdi, pti;
+	int fresh = 0;
 
 	pdi = (u32)vaddr >> 22;
 	pti = ((u32)vaddr >> 12) & 0x000003ffU;
 
-	/* If no page table is allocated add new one */
-	if (pdir[pdi] == 0U) {
+	/* If no page table is allocated add new one, large page is replaced and its remaining pages are faulted in again */
+	if ((pdir[pdi] == 0U) || ((pdir[pdi] & PGHD_4MB) != 0U)) {
 		if (alloc == NULL) {
 			return -EFAULT;
 		}
 		pdir[pdi] = ((alloc->addr & ~(SIZE_PAGE - 1U)) | PTHD_USER | PTHD_WRITE | PTHD_PRESENT);
+		fresh = 1;
 	}
 
 	/* Map selected page table to specified virtual address */
@@ -109,6 +112,10 @@ int _pmap_enter(u32 *pdir, addr_t *pt, addr_t paddr, void *vaddr, vm_attr_t attr
 
 	hal_tlbInvalidateLocalEntry(NULL, pt);
 
+	if (fresh != 0) {
+		hal_memset(pt, 0, SIZE_PAGE);
+	}
+
 	/* And at last map page or only changle attributes of map entry */
 	pt[pti] = ((paddr & ~(SIZE_PAGE - 1U)) | ((addr_t)attr & 0xfffU) | PGHD_PRESENT);
 
@@ -141,6 +148,47 @@ int pmap_enter(pmap_t *pmap, addr_t paddr, void *vaddr, vm_attr_t attr, page_t *
 }
 
 
+int pmap_enterLarge(pmap_t *pmap, addr_t paddr, void *vaddr, vm_attr_t attr, page_t *alloc, addr_t *ptable)
+{
+	spinlock_ctx_t sc;
+	u32 pdi = (u32)vaddr >> 22;
+	addr_t addr, *pt = hal_config.ptable;
+	unsigned int i;
+
+	(void)alloc;
+	*ptable = 0U;
+
+	if ((((u32)vaddr | paddr) & (SIZE_LARGEPAGE - 1U)) != 0U) {
+		return -EINVAL;
+	}
+
+	hal_spinlockSet(&pmap_common.lock, &sc);
+
+	addr = pmap->pdir[pdi];
+	if ((addr != 0U) && ((addr & PGHD_4MB) == 0U)) {
+		/* Page table can be replaced only if nothing is mapped through it */
+		((addr_t *)(syspage->hs.ptable + VADDR_KERNEL))[((u32)pt >> 12) & 0x000003ffU] = (addr & ~(SIZE_PAGE - 1U)) | (PGHD_WRITE | PGHD_PRESENT);
+		hal_tlbInvalidateLocalEntry(NULL, pt);
+
+		for (i = 0U; i < (SIZE_PAGE / sizeof(addr_t)); ++i) {
+			if (pt[i] != 0U) {
+				hal_spinlockClear(&pmap_common.lock, &sc);
+				return -EBUSY;
+			}
+		}
+		*ptable = addr & ~(SIZE_PAGE - 1U);
+	}
+
+	pmap->pdir[pdi] = paddr | ((addr_t)attr & 0x1fU) | PGHD_4MB | PGHD_PRESENT;
+
+	/* Single invalidation drops the whole large TLB entry */
+	hal_tlbInvalidateEntry(NULL, vaddr, 1U);
+	hal_tlbCommit(&pmap_common.lock, &sc);
+
+	return EOK;
+}
+
+
 static int _pmap_remove(u32 *pdir, addr_t *pt, void *vaddr, size_t count, int tlbInval)
 {
 	u32 pdi, pti;
@@ -151,7 +199,7 @@ static int _pmap_remove(u32 *pdir, addr_t *pt, void *vaddr, size_t count, int tl
 	ptable = (addr_t *)(syspage->hs.ptable + VADDR_KERNEL);
 	va = vaddr;
 
-	for (i = 0; i < count; ++i) {
+	for (i = 0; i < count; ++i, va += SIZE_PAGE) {
 		pdi = (u32)va >> 22;
 		pti = ((u32)va >> 12) & 0x000003ffU;
 
@@ -160,6 +208,12 @@ static int _pmap_remove(u32 *pdir, addr_t *pt, void *vaddr, size_t count, int tl
 			continue;
 		}
 
+		/* Large page is removed as a whole */
+		if ((pdir[pdi] & PGHD_4MB) != 0U) {
+			pdir[pdi] = 0U;
+			continue;
+		}
+
 		/* Map selected page table to specified virtual address */
 		addr = pdir[pdi];
 		if ((u32)pt < VADDR_KERNEL) {
@@ -173,8 +227,6 @@ static int _pmap_remove(u32 *pdir, addr_t *pt, void *vaddr, size_t count, int tl
 
 		/* Unmap page */
 		pt[pti] = 0;
-
-		va += SIZE_PAGE;
 	}
 
 	if (tlbInval != 0) {
@@ -207,6 +259,59 @@ int pmap_remove(pmap_t *pmap, void *vstart, void *vend)
 }
 
 
+int pmap_writeProtect(pmap_t *pmap, void *vstart, void *vend)
+{
+	spinlock_ctx_t sc;
+	u32 pdi, pti;
+	addr_t addr, *pt = hal_config.ptable;
+	ptr_t vaddr, end;
+
+	hal_spinlockSet(&pmap_common.lock, &sc);
+
+	for (vaddr = (ptr_t)vstart; vaddr < (ptr_t)vend; vaddr = end) {
+		/* Range covered by a single page table */
+		end = (vaddr & ~(SIZE_LARGEPAGE - 1U)) + SIZE_LARGEPAGE;
+		if ((end == 0U) || (end > (ptr_t)vend)) {
+			end = (ptr_t)vend;
+		}
+
+		pdi = (u32)vaddr >> 22;
+		addr = pmap->pdir[pdi];
+		if (addr == 0U) {
+			continue;
+		}
+
+		if ((addr & PGHD_4MB) != 0U) {
+			pmap->pdir[pdi] = addr & ~PGHD_WRITE;
+			continue;
+		}
+
+		((addr_t *)(syspage->hs.ptable + VADDR_KERNEL))[((u32)pt >> 12) & 0x000003ffU] = (addr & ~(SIZE_PAGE - 1U)) | (PGHD_WRITE | PGHD_PRESENT);
+		hal_tlbInvalidateLocalEntry(NULL, pt);
+
+		for (pti = ((u32)vaddr >> 12) & 0x000003ffU; vaddr < end; vaddr += SIZE_PAGE, ++pti) {
+			pt[pti] &= ~PGHD_WRITE;
+		}
+	}
+
+	/* Range may span many page tables, whole TLB is flushed */
+	hal_tlbInvalidateEntry(NULL, NULL, 0U);
+	hal_tlbFlushLocal(NULL);
+	hal_tlbCommit(&pmap_common.lock, &sc);
+
+	return EOK;
+}
+
+
+int pmap_isWritable(pmap_t *pmap, void *vaddr)
+{
+	/* Resolved address carries attribute bits of the entry */
+	addr_t addr = pmap_resolve(pmap, vaddr);
+
+	return ((addr & (PGHD_PRESENT | PGHD_WRITE)) == (PGHD_PRESENT | PGHD_WRITE)) ? 1 : 0;
+}
+
+
 /* Functions returns physical address associated with specified virtual address */
 addr_t pmap_resolve(pmap_t *pmap, void *vaddr)
 {
@@ -221,6 +326,11 @@ addr_t pmap_resolve(pmap_t *pmap, void *vaddr)
 		return 0;
 	}
 
+	addr = pmap->pdir[pdi];
+	if ((addr & PGHD_4MB) != 0U) {
+		return (addr & ~(SIZE_LARGEPAGE - 1U)) | ((u32)vaddr & (SIZE_LARGEPAGE - 1U) & ~(SIZE_PAGE - 1U)) | (addr & 0x1fU);
+	}
+
 	hal_spinlockSet(&pmap_common.lock, &sc);
 
 	/* Map page table corresponding to vaddr at specified virtual address */
@@ -50,10 +50,32 @@ void pmap_switch(pmap_t *pmap);
 int pmap_enter(pmap_t *pmap, addr_t paddr, void *vaddr, vm_attr_t attr, page_t *alloc);
 
 
+#ifdef SIZE_LARGEPAGE
+
+/* Function maps SIZE_LARGEPAGE aligned block, returns -EBUSY if small pages are mapped in the range.
+ * Empty page table replaced by the block is returned in ptable (0 otherwise) to be freed by the caller.
+ * Small page entered over a large mapping drops the large mapping */
+int pmap_enterLarge(pmap_t *pmap, addr_t paddr, void *vaddr, vm_attr_t attr, page_t *alloc, addr_t *ptable);
+
+#endif
+
+
 /* Function removes mapping in range [vstart, vend) */
 int pmap_remove(pmap_t *pmap, void *vstart, void *vend);
 
 
+#ifndef NOMMU
+
+/* Function revokes write access to pages mapped in range [vstart, vend), missing page tables are skipped */
+int pmap_writeProtect(pmap_t *pmap, void *vstart, void *vend);
+
+
+/* Function returns 1 if page at vaddr is mapped with write access, mapping isn't changed */
+int pmap_isWritable(pmap_t *pmap, void *vaddr);
+
+#endif
+
+
 addr_t pmap_resolve(pmap_t *pmap, void *vaddr);
 
 
@@ -34,7 +34,8 @@
 #define PGHD_NOT_CACHED 0x00U
 
 /* Page flags */
-#define PAGE_FREE 0x00000001U
+#define PAGE_FREE   0x00000001U
+#define PAGE_CACHED 0x00000080U /* Single page held in a per-CPU cache */
 
 #define PAGE_OWNER_BOOT   (0U << 1)
 #define PAGE_OWNER_KERNEL (1U << 1)
@@ -59,6 +60,9 @@
 
 #define SIZE_PDIR SIZE_PAGE
 
+/* Megapage - leaf entry in second level pdir */
+#define SIZE_LARGEPAGE 0x200000UL
+
 #define PAGE_ALIGN(addr) (((addr_t)(addr)) & ~(SIZE_PAGE - 1UL))
 #define PAGE_OFFS(addr)  (((addr_t)(addr)) & (SIZE_PAGE - 1UL))
 
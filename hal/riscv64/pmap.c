@@ -37,7 +37,8 @@
 #define PTE_TO_ADDR(pte)  ((((u64)(pte) >> 10) << 12) & 0xfffffffffff000UL)
 
 /* PTE attributes */
-#define PTE_V (1UL << 0)
+#define PTE_V    (1UL << 0)
+#define PTE_LEAF (PGHD_READ | PGHD_WRITE | PGHD_EXEC)
 
 #define CEIL_PAGE(x) ((((addr_t)(x)) + SIZE_PAGE - 1UL) & ~(SIZE_PAGE - 1UL))
 
@@ -154,6 +155,10 @@ addr_t pmap_destroy(pmap_t *pmap, unsigned int *i)
 				entry = pmap_common.ptable[j];
 				if ((entry & PTE_V) != 0U) {
 					pmap_common.ptable[j] = 0U;
+					/* Megapage has no page table to free */
+					if ((entry & PTE_LEAF) != 0U) {
+						continue;
+					}
 					hal_spinlockClear(&pmap_common.lock, &sc);
 
 					return PTE_TO_ADDR(entry);
@@ -219,7 +224,8 @@ static int _pmap_map(u64 *pdir2, u64 satpVal, addr_t pa, void *vaddr, vm_attr_t
 		hal_cpuDCacheInval(pmap_common.ptable, sizeof(pmap_common.ptable));
 	}
 
-	if ((pmap_common.ptable[pdi1] & PTE_V) == 0U) {
+	/* Megapage is replaced by a page table, its remaining pages are faulted in again */
+	if (((pmap_common.ptable[pdi1] & PTE_V) == 0U) || ((pmap_common.ptable[pdi1] & PTE_LEAF) != 0U)) {
 		if (alloc == NULL) {
 			return -EFAULT;
 		}
@@ -312,6 +318,83 @@ int pmap_enter(pmap_t *pmap, addr_t paddr, void *vaddr, vm_attr_t attr, page_t *
 }
 
 
+int pmap_enterLarge(pmap_t *pmap, addr_t paddr, void *vaddr, vm_attr_t attr, page_t *alloc, addr_t *ptable)
+{
+	spinlock_ctx_t sc;
+	addr_t entry, pdir1;
+	unsigned long pdi2 = PDIR2_IDX(vaddr);
+	unsigned long pdi1 = PDIR1_IDX(vaddr);
+	unsigned int i;
+
+	*ptable = 0U;
+
+	if ((((ptr_t)vaddr | paddr) & (SIZE_LARGEPAGE - 1U)) != 0U) {
+		return -EINVAL;
+	}
+
+	if ((attr & PGHD_WRITE) != 0U) {
+		/* RISC-V ISA: w/wx mapping reserved for future use */
+		attr |= PGHD_READ;
+	}
+
+	/* Entry without R/W/X bits would point to the next level */
+	if ((attr & PTE_LEAF) == 0U) {
+		return -EINVAL;
+	}
+
+	hal_spinlockSet(&pmap_common.lock, &sc);
+
+	if ((pmap->pdir2[pdi2] & PTE_V) == 0U) {
+		if (alloc == NULL) {
+			hal_spinlockClear(&pmap_common.lock, &sc);
+			return -EFAULT;
+		}
+
+		pmap->pdir2[pdi2] = PTE(alloc->addr, PTE_V);
+
+		pmap_common.pdir0[PDIR0_IDX(pmap_common.ptable)] = PTE(alloc->addr, 0xc7U);
+		hal_cpuLocalFlushTLB(0U, pmap_common.ptable);
+		hal_memset(pmap_common.ptable, 0, sizeof(pmap_common.ptable));
+	}
+
+	pdir1 = PTE_TO_ADDR(pmap->pdir2[pdi2]);
+	pmap_common.pdir0[PDIR0_IDX(pmap_common.ptable)] = PTE(pdir1, 0xc7U);
+	hal_cpuLocalFlushTLB(0U, pmap_common.ptable);
+	hal_cpuDCacheInval(pmap_common.ptable, sizeof(pmap_common.ptable));
+
+	entry = pmap_common.ptable[pdi1];
+	if (((entry & PTE_V) != 0U) && ((entry & PTE_LEAF) == 0U)) {
+		/* Page table can be replaced only if nothing is mapped through it */
+		pmap_common.pdir0[PDIR0_IDX(pmap_common.ptable)] = PTE(PTE_TO_ADDR(entry), 0xc7U);
+		hal_cpuLocalFlushTLB(0U, pmap_common.ptable);
+		hal_cpuDCacheInval(pmap_common.ptable, sizeof(pmap_common.ptable));
+
+		for (i = 0U; i < 512U; i++) {
+			if ((pmap_common.ptable[i] & PTE_V) != 0U) {
+				hal_spinlockClear(&pmap_common.lock, &sc);
+				return -EBUSY;
+			}
+		}
+		*ptable = PTE_TO_ADDR(entry);
+
+		pmap_common.pdir0[PDIR0_IDX(pmap_common.ptable)] = PTE(pdir1, 0xc7U);
+		hal_cpuLocalFlushTLB(0U, pmap_common.ptable);
+	}
+
+	pmap_common.ptable[pdi1] = PTE(paddr, 0xc1U | (attr & 0x3fU));
+	RISCV_FENCE(w, rw);
+
+	hal_cpuRemoteFlushTLB(0U, vaddr, SIZE_LARGEPAGE);
+	hal_cpuInstrBarrier();
+	if ((attr & PGHD_EXEC) != 0U) {
+		hal_cpuRfenceI();
+	}
+	hal_spinlockClear(&pmap_common.lock, &sc);
+
+	return EOK;
+}
+
+
 static u8 _pmap_remove(pmap_t *pmap, void *vstart, void *vend)
 {
 	addr_t addr, entry;
@@ -346,6 +429,16 @@ static u8 _pmap_remove(pmap_t *pmap, void *vstart, void *vend)
 				continue;
 			}
 
+			/* Megapage is removed as a whole */
+			if ((entry & PTE_LEAF) != 0U) {
+				if ((entry & (unsigned int)PGHD_EXEC) != 0U) {
+					isync = 1;
+				}
+				pmap_common.ptable[pdi1] = 0;
+				vaddr = (vaddr & ~(SIZE_LARGEPAGE - 1U)) + SIZE_LARGEPAGE - SIZE_PAGE;
+				continue;
+			}
+
 			addr = PTE_TO_ADDR(entry);
 			pmap_common.pdir0[PDIR0_IDX(pmap_common.ptable)] = PTE(addr, 0xc7U);
 			hal_cpuLocalFlushTLB(0U, pmap_common.ptable);
@@ -402,6 +495,91 @@ int pmap_remove(pmap_t *pmap, void *vstart, void *vend)
 }
 
 
+int pmap_writeProtect(pmap_t *pmap, void *vstart, void *vend)
+{
+	addr_t entry;
+	ptr_t vaddr, end;
+	unsigned long pdi1, pti;
+	spinlock_ctx_t sc;
+
+	hal_spinlockSet(&pmap_common.lock, &sc);
+
+	for (vaddr = (ptr_t)vstart; vaddr < (ptr_t)vend; vaddr = end) {
+		/* Range covered by a single page table */
+		end = (vaddr & ~(SIZE_LARGEPAGE - 1U)) + SIZE_LARGEPAGE;
+		if (end > (ptr_t)vend) {
+			end = (ptr_t)vend;
+		}
+
+		entry = pmap->pdir2[PDIR2_IDX(vaddr)];
+		if ((entry & PTE_V) == 0U) {
+			continue;
+		}
+
+		pmap_common.pdir0[PDIR0_IDX(pmap_common.ptable)] = PTE(PTE_TO_ADDR(entry), 0xc7U);
+		hal_cpuLocalFlushTLB(0U, pmap_common.ptable);
+		hal_cpuDCacheInval(pmap_common.ptable, sizeof(pmap_common.ptable));
+
+		pdi1 = PDIR1_IDX(vaddr);
+		entry = pmap_common.ptable[pdi1];
+		if ((entry & PTE_V) == 0U) {
+			continue;
+		}
+
+		if ((entry & PTE_LEAF) != 0U) {
+			pmap_common.ptable[pdi1] = entry & ~(addr_t)PGHD_WRITE;
+			continue;
+		}
+
+		pmap_common.pdir0[PDIR0_IDX(pmap_common.ptable)] = PTE(PTE_TO_ADDR(entry), 0xc7U);
+		hal_cpuLocalFlushTLB(0U, pmap_common.ptable);
+		hal_cpuDCacheInval(pmap_common.ptable, sizeof(pmap_common.ptable));
+
+		for (pti = PDIR0_IDX(vaddr); vaddr < end; vaddr += SIZE_PAGE, ++pti) {
+			pmap_common.ptable[pti] &= ~(addr_t)PGHD_WRITE;
+		}
+	}
+
+	RISCV_FENCE(w, rw);
+
+	hal_cpuRemoteFlushTLB(0U, vstart, (size_t)((ptr_t)vend - (ptr_t)vstart));
+	hal_spinlockClear(&pmap_common.lock, &sc);
+
+	return EOK;
+}
+
+
+int pmap_isWritable(pmap_t *pmap, void *vaddr)
+{
+	addr_t entry;
+	spinlock_ctx_t sc;
+
+	entry = pmap->pdir2[PDIR2_IDX(vaddr)];
+	if ((entry & PTE_V) == 0U) {
+		return 0;
+	}
+
+	hal_spinlockSet(&pmap_common.lock, &sc);
+
+	pmap_common.pdir0[PDIR0_IDX(pmap_common.ptable)] = PTE(PTE_TO_ADDR(entry), 0xc7U);
+	hal_cpuLocalFlushTLB(0U, pmap_common.ptable);
+	hal_cpuDCacheInval(pmap_common.ptable, sizeof(pmap_common.ptable));
+
+	entry = pmap_common.ptable[PDIR1_IDX(vaddr)];
+	if (((entry & PTE_V) != 0U) && ((entry & PTE_LEAF) == 0U)) {
+		pmap_common.pdir0[PDIR0_IDX(pmap_common.ptable)] = PTE(PTE_TO_ADDR(entry), 0xc7U);
+		hal_cpuLocalFlushTLB(0U, pmap_common.ptable);
+		hal_cpuDCacheInval(pmap_common.ptable, sizeof(pmap_common.ptable));
+
+		entry = pmap_common.ptable[PDIR0_IDX(vaddr)];
+	}
+
+	hal_spinlockClear(&pmap_common.lock, &sc);
+
+	return (((entry & PTE_V) != 0U) && ((entry & (addr_t)PGHD_WRITE) != 0U)) ? 1 : 0;
+}
+
+
 /* Functions returns physical address associated with specified virtual address */
 addr_t pmap_resolve(pmap_t *pmap, void *vaddr)
 {
@@ -426,6 +604,10 @@ addr_t pmap_resolve(pmap_t *pmap, void *vaddr)
 	hal_cpuDCacheInval(pmap_common.ptable, sizeof(pmap_common.ptable));
 
 	addr = PTE_TO_ADDR(pmap_common.ptable[pdi1]);
+	if ((pmap_common.ptable[pdi1] & PTE_LEAF) != 0U) {
+		hal_spinlockClear(&pmap_common.lock, &sc);
+		return addr + ((ptr_t)vaddr & (SIZE_LARGEPAGE - 1U) & ~(SIZE_PAGE - 1U));
+	}
 
 	pmap_common.pdir0[PDIR0_IDX(pmap_common.ptable)] = PTE(addr, 0xc7U);
 	hal_cpuLocalFlushTLB(0U, pmap_common.ptable);
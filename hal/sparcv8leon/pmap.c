@@ -473,6 +473,81 @@ int pmap_remove(pmap_t *pmap, void *vstart, void *vend)
 }
 
 
+int pmap_writeProtect(pmap_t *pmap, void *vstart, void *vend)
+{
+	size_t idx3;
+	addr_t addr, descr;
+	spinlock_ctx_t sc;
+	ptr_t vaddr, end;
+
+	hal_spinlockSet(&pmap_common.lock, &sc);
+
+	for (vaddr = (ptr_t)vstart; vaddr < (ptr_t)vend; vaddr = end) {
+		/* Range covered by a single 3rd level table */
+		end = (vaddr & ~0x3ffffU) + 0x40000U;
+		if ((end == 0U) || (end > (ptr_t)vend)) {
+			end = (ptr_t)vend;
+		}
+
+		descr = pmap->pdir1[PDIR1_IDX(vaddr)];
+		if ((descr & 0x3U) == PAGE_INVALID) {
+			continue;
+		}
+
+		descr = hal_cpuLoadPaddr(&((u32 *)PTD_TO_ADDR(descr))[PDIR2_IDX(vaddr)]);
+		if ((descr & 0x3U) == PAGE_INVALID) {
+			continue;
+		}
+		addr = PTD_TO_ADDR(descr);
+
+		for (; vaddr < end; vaddr += SIZE_PAGE) {
+			idx3 = PDIR3_IDX(vaddr);
+			descr = hal_cpuLoadPaddr(&((u32 *)addr)[idx3]);
+
+			/* User RW and RWX become RO and RX */
+			if (((descr & 0x3U) == PAGE_ENTRY) && ((((descr >> 2) & 0x7U) & 0x5U) == PERM_USER_RW)) {
+				hal_cpuStorePaddr(&((u32 *)addr)[idx3], descr & ~(PERM_USER_RW << 2));
+			}
+		}
+	}
+
+	hal_cpuflushDCacheL1();
+
+	hal_tlbInvalidateEntry(pmap, vstart, CEIL_PAGE((ptr_t)vend - (ptr_t)vstart) / SIZE_PAGE);
+
+	hal_tlbCommit(&pmap_common.lock, &sc);
+
+	return EOK;
+}
+
+
+int pmap_isWritable(pmap_t *pmap, void *vaddr)
+{
+	addr_t descr;
+	spinlock_ctx_t sc;
+	int ret = 0;
+
+	hal_spinlockSet(&pmap_common.lock, &sc);
+
+	descr = pmap->pdir1[PDIR1_IDX(vaddr)];
+	if ((descr & 0x3U) != PAGE_INVALID) {
+		descr = hal_cpuLoadPaddr(&((u32 *)PTD_TO_ADDR(descr))[PDIR2_IDX(vaddr)]);
+		if ((descr & 0x3U) != PAGE_INVALID) {
+			descr = hal_cpuLoadPaddr(&((u32 *)PTD_TO_ADDR(descr))[PDIR3_IDX(vaddr)]);
+
+			/* User RW or RWX */
+			if (((descr & 0x3U) == PAGE_ENTRY) && ((((descr >> 2) & 0x7U) & 0x5U) == PERM_USER_RW)) {
+				ret = 1;
+			}
+		}
+	}
+
+	hal_spinlockClear(&pmap_common.lock, &sc);
+
+	return ret;
+}
+
+
 int pmap_getPage(page_t *page, addr_t *addr)
 {
 	size_t i;
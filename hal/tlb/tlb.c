@@ -80,6 +80,7 @@ void hal_tlbInvalidateEntry(const pmap_t *pmap, const void *vaddr, size_t count)
 {
 	/* TODO: Make sure that we aren't pushing into full queue */
 	unsigned int i;
+	size_t j;
 	const unsigned int n = hal_cpuGetCount(), id = hal_cpuGetID();
 	size_t tasks_size;
 	spinlock_ctx_t sc;
@@ -110,7 +111,17 @@ void hal_tlbInvalidateEntry(const pmap_t *pmap, const void *vaddr, size_t count)
 			hal_spinlockClear(&tlb_common.tlbs[i].todo_spinlock, &sc);
 		}
 	}
-	hal_tlbInvalidateLocalEntry(pmap, vaddr);
+
+	/* Local TLB is invalidated the same way as the remote ones */
+	if ((vaddr == NULL) && (count == 0U)) {
+		hal_tlbFlushLocal(pmap);
+	}
+	else {
+		for (j = 0; j < count; ++j) {
+			hal_tlbInvalidateLocalEntry(pmap, vaddr);
+			vaddr += SIZE_PAGE;
+		}
+	}
 }
 
 
@@ -19,6 +19,30 @@
 /* Return id, allocated in msgReceive, used in msgRespond */
 typedef int msg_rid_t;
 
+/* Port set member selection policy */
+#define PORTSET_ROUNDROBIN 0U /* Members are served in turns */
+#define PORTSET_PRIORITY   1U /* Member with the lowest priority value is served first */
+
+#define PORT_HANDLE 0x80000000U /* Port argument is a handle from portHandleOpen */
+
+#define MSG_IOV_MAX  8U          /* Maximum number of segments of msgSendv payload */
+#define MSG_IOV_SIZE (16U << 20) /* Maximum total size of msgSendv payload */
+
+
+/* Port load, lets servers size their worker pools */
+typedef struct _port_pressure_t {
+	unsigned int queued;   /* Messages waiting for a receiver */
+	unsigned int idle;     /* Threads blocked in receive (including port set receivers) */
+	unsigned int inflight; /* Messages received and not responded yet */
+} port_pressure_t;
+
+
+/* Payload segment, receiver gets all segments as one contiguous buffer */
+typedef struct _msg_iov_t {
+	void *base;
+	size_t len;
+} msg_iov_t;
+
 /*
  * Message types
  */
@@ -33,7 +57,7 @@ enum {
 	mtCreate, mtDestroy, mtSetAttr, mtGetAttr, mtGetAttrAll,
 
 	/* Directory operations */
-	mtLookup, mtLink, mtUnlink, mtReaddir,
+	mtLookup, mtLink, mtUnlink, mtReaddir, mtLookupOpen,
 
 	mtCount,
 
@@ -114,6 +138,13 @@ typedef struct _msg_t {
 				off_t offs;
 			} readdir;
 
+			/* LOOKUPOPEN */
+			struct {
+				unsigned int flags; /* Open flags */
+				int type;           /* Type of object created if final component doesn't exist, -1 - don't create */
+				unsigned int mode;
+			} lookupopen;
+
 			unsigned char raw[64];
 		};
 
@@ -139,6 +170,14 @@ typedef struct _msg_t {
 				oid_t dev;
 			} lookup;
 
+			/* LOOKUPOPEN - as LOOKUP, server opens dev if it resolved whole path and serves dev itself */
+			struct {
+				oid_t fil;
+				oid_t dev;
+				int open;   /* Open result */
+				int opened; /* 0 - not opened, 1 - opened, 2 - created and opened */
+			} lookupopen;
+
 			unsigned char raw[64];
 		};
 
@@ -129,7 +129,24 @@
 	\
 	ID(sys_statvfs) \
 	ID(sys_uname) \
-	ID(schedInfo)
+	ID(schedInfo) \
+	ID(msgRecvBatch) \
+	ID(msgRespondBatch) \
+	ID(portSetCreate) \
+	ID(portSetAdd) \
+	ID(portSetRemove) \
+	ID(msgRecvSet) \
+	ID(msginfo) \
+	ID(portHandleOpen) \
+	ID(portHandleClose) \
+	ID(notifyCreate) \
+	ID(notifySignal) \
+	ID(notifyWait) \
+	ID(portsinfo) \
+	ID(msgSendv) \
+	ID(portPressure) \
+	ID(portPressureNotify) \
+	ID(kcacheinfo)
 
 /* parasoft-end-suppress MISRAC2012-RULE_20_7-a */
 /* clang-format on */
@@ -76,6 +76,16 @@ typedef struct {
 } mapinfo_t;
 
 
+typedef struct {
+	char name[16];
+	unsigned int objsz;
+	unsigned int slabs;
+	unsigned int total;  /* Objects in all slabs */
+	unsigned int used;   /* Objects taken from slabs, including cached */
+	unsigned int cached; /* Objects held in per CPU magazines */
+} kcacheinfo_t;
+
+
 /* TODO: Consider changing type of kmaps mapsz from int to unsigned int */
 typedef struct _meminfo_t {
 	struct {
@@ -99,4 +109,35 @@ typedef struct _meminfo_t {
 } meminfo_t;
 
 
+typedef struct _portinfo_t {
+	unsigned int id;
+	pid_t pid;
+
+	unsigned int received, responded;
+	unsigned int depth, maxdepth;
+	time_t qtime; /* Total time messages spent queued [us] */
+	time_t stime; /* Total time between receive and response [us] */
+} __attribute__((packed)) portinfo_t;
+
+
+typedef struct _msginfo_t {
+	struct {
+		unsigned int size, threshold;
+		unsigned int count;
+	} bounce;
+
+	struct {
+		unsigned int size, entries;
+		unsigned int hits, misses;
+		unsigned int invalidations, evictions;
+	} mapcache;
+
+	struct {
+		unsigned int size, entries;
+		unsigned int hits, misses;
+		unsigned int invalidations, evictions;
+	} namecache;
+} msginfo_t;
+
+
 #endif
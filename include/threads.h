@@ -38,4 +38,10 @@ struct condAttr {
 };
 
 
+/* Notification flags */
+
+
+#define PH_NOTIFY_SHARED 1 /* Any process may signal the notification */
+
+
 #endif
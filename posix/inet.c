@@ -40,12 +40,18 @@ static ssize_t socksrvcall(msg_t *msg)
 }
 
 
-static ssize_t sockcall(unsigned int socket, msg_t *msg)
+static ssize_t sockcallv(unsigned int socket, msg_t *msg, const msg_iov_t *iiov, size_t ni, const msg_iov_t *oiov, size_t no)
 {
 	sockport_resp_t *smo = (void *)msg->o.raw;
 	ssize_t err;
 
-	err = proc_send(socket, msg);
+	if ((ni == 0U) && (no == 0U)) {
+		err = proc_send(socket, msg);
+	}
+	else {
+		err = proc_sendv(socket, msg, iiov, ni, oiov, no);
+	}
+
 	if (err < 0) {
 		return err;
 	}
@@ -55,12 +61,37 @@ static ssize_t sockcall(unsigned int socket, msg_t *msg)
 }
 
 
-static ssize_t socknamecall(unsigned int socket, msg_t *msg, struct sockaddr *address, socklen_t *address_len)
+static ssize_t sockcall(unsigned int socket, msg_t *msg)
+{
+	return sockcallv(socket, msg, NULL, 0, NULL, 0);
+}
+
+
+/* Converts msghdr buffers to message segments */
+static int sockiov(const struct msghdr *msg, msg_iov_t *iov, size_t *niov)
+{
+	size_t i;
+
+	if ((msg->msg_iovlen < 0) || ((size_t)msg->msg_iovlen > MSG_IOV_MAX)) {
+		return -EINVAL;
+	}
+
+	for (i = 0; i < (size_t)msg->msg_iovlen; i++) {
+		iov[i].base = msg->msg_iov[i].iov_base;
+		iov[i].len = msg->msg_iov[i].iov_len;
+	}
+	*niov = i;
+
+	return EOK;
+}
+
+
+static ssize_t socknamecallv(unsigned int socket, msg_t *msg, const msg_iov_t *oiov, size_t no, struct sockaddr *address, socklen_t *address_len)
 {
 	sockport_resp_t *smo = (void *)msg->o.raw;
 	ssize_t err;
 
-	err = sockcall(socket, msg);
+	err = sockcallv(socket, msg, NULL, 0, oiov, no);
 	if (err < 0) {
 		return err;
 	}
@@ -78,7 +109,13 @@ static ssize_t socknamecall(unsigned int socket, msg_t *msg, struct sockaddr *ad
 }
 
 
-static ssize_t sockdestcall(unsigned int socket, msg_t *msg, const struct sockaddr *address, socklen_t address_len)
+static ssize_t socknamecall(unsigned int socket, msg_t *msg, struct sockaddr *address, socklen_t *address_len)
+{
+	return socknamecallv(socket, msg, NULL, 0, address, address_len);
+}
+
+
+static ssize_t sockdestcallv(unsigned int socket, msg_t *msg, const msg_iov_t *iiov, size_t ni, const struct sockaddr *address, socklen_t address_len)
 {
 	sockport_msg_t *smi = (void *)msg->i.raw;
 
@@ -89,7 +126,13 @@ static ssize_t sockdestcall(unsigned int socket, msg_t *msg, const struct sockad
 	smi->send.addrlen = address_len;
 	hal_memcpy(smi->send.addr, address, address_len);
 
-	return sockcall(socket, msg);
+	return sockcallv(socket, msg, iiov, ni, NULL, 0);
+}
+
+
+static ssize_t sockdestcall(unsigned int socket, msg_t *msg, const struct sockaddr *address, socklen_t address_len)
+{
+	return sockdestcallv(socket, msg, NULL, 0, address, address_len);
 }
 
 
@@ -220,15 +263,29 @@ ssize_t inet_sendto(unsigned int socket, const void *message, size_t length, uns
 ssize_t inet_recvmsg(unsigned int socket, struct msghdr *msg, unsigned int flags)
 {
 	ssize_t ret = 0;
+	msg_t m;
+	sockport_msg_t *smi = (void *)m.i.raw;
+	msg_iov_t iov[MSG_IOV_MAX];
+	size_t niov;
 
-	/* multiple buffers are not supported */
-	if (msg->msg_iovlen > 1) {
+	if (sockiov(msg, iov, &niov) < 0) {
 		return -EINVAL;
 	}
 
-	if (msg->msg_iovlen == 1) {
+	if (niov == 1U) {
 		ret = inet_recvfrom(socket, msg->msg_iov->iov_base, msg->msg_iov->iov_len, flags, msg->msg_name, &msg->msg_namelen);
 	}
+	else if (niov > 1U) {
+		/* Server scatters data directly to the buffers */
+		hal_memset(&m, 0, sizeof(m));
+		m.type = sockmRecv;
+		smi->send.flags = flags;
+
+		ret = socknamecallv(socket, &m, iov, niov, msg->msg_name, &msg->msg_namelen);
+	}
+	else {
+		/* No action required */
+	}
 
 	if (ret >= 0) {
 		/* control data is not supported */
@@ -247,20 +304,30 @@ ssize_t inet_recvmsg(unsigned int socket, struct msghdr *msg, unsigned int flags
 ssize_t inet_sendmsg(unsigned int socket, const struct msghdr *msg, unsigned int flags)
 {
 	ssize_t ret = 0;
-
-	/* multiple buffers are not supported */
-	if (msg->msg_iovlen > 1) {
-		return -EINVAL;
-	}
+	msg_t m;
+	sockport_msg_t *smi = (void *)m.i.raw;
+	msg_iov_t iov[MSG_IOV_MAX];
+	size_t niov;
 
 	/* control data is not supported */
-	if (msg->msg_controllen > 0U) {
+	if ((msg->msg_controllen > 0U) || (sockiov(msg, iov, &niov) < 0)) {
 		return -EINVAL;
 	}
 
-	if (msg->msg_iovlen == 1) {
+	if (niov == 1U) {
 		ret = inet_sendto(socket, msg->msg_iov->iov_base, msg->msg_iov->iov_len, flags, msg->msg_name, msg->msg_namelen);
 	}
+	else if (niov > 1U) {
+		/* Header and payload buffers are passed without joining them first */
+		hal_memset(&m, 0, sizeof(m));
+		m.type = sockmSend;
+		smi->send.flags = flags;
+
+		ret = sockdestcallv(socket, &m, iov, niov, msg->msg_name, msg->msg_namelen);
+	}
+	else {
+		/* No action required */
+	}
 
 	return ret;
 }
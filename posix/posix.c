@@ -66,6 +66,9 @@ static struct {
 	lock_t lock;
 	id_t fresh;
 	char hostname[HOST_NAME_MAX + 1U];
+
+	vm_kmemcache_t *files;
+	vm_kmemcache_t *pinfos;
 } posix_common;
 
 
@@ -108,7 +111,7 @@ void pinfo_put(process_info_t *p)
 
 	vm_kfree(p->fds);
 	(void)proc_lockDone(&p->lock);
-	vm_kfree(p);
+	vm_kmemCacheFree(posix_common.pinfos, p);
 }
 
 
@@ -129,7 +132,7 @@ int posix_fileDeref(open_file_t *f)
 		}
 
 		(void)proc_lockDone(&f->lock);
-		vm_kfree(f);
+		vm_kmemCacheFree(posix_common.files, f);
 	}
 	else {
 		(void)proc_lockClear(&f->lock);
@@ -144,7 +147,7 @@ static void posix_putUnusedFile(process_info_t *p, int fd)
 
 	f = p->fds[fd].file;
 	(void)proc_lockDone(&f->lock);
-	vm_kfree(f);
+	vm_kmemCacheFree(posix_common.files, f);
 	p->fds[fd].file = NULL;
 }
 
@@ -220,7 +223,7 @@ int posix_newFile(process_info_t *p, int fd)
 {
 	open_file_t *f;
 
-	f = vm_kmalloc(sizeof(open_file_t));
+	f = vm_kmemCacheAlloc(posix_common.files);
 	if (f == NULL) {
 		return -ENOMEM;
 	}
@@ -230,7 +233,7 @@ int posix_newFile(process_info_t *p, int fd)
 	fd = _posix_allocfd(p, fd);
 	if (fd < 0) {
 		(void)proc_lockClear(&p->lock);
-		vm_kfree(f);
+		vm_kmemCacheFree(posix_common.files, f);
 		return -ENFILE;
 	}
 
@@ -308,7 +311,7 @@ int posix_clone(int ppid)
 
 	proc = proc_current()->process;
 
-	p = vm_kmalloc(sizeof(process_info_t));
+	p = vm_kmemCacheAlloc(posix_common.pinfos);
 	if (p == NULL) {
 		return -ENOMEM;
 	}
@@ -340,7 +343,7 @@ int posix_clone(int ppid)
 	p->fds = vm_kmalloc((size_t)p->fdsz * sizeof(fildes_t));
 	if (p->fds == NULL) {
 		(void)proc_lockDone(&p->lock);
-		vm_kfree(p);
+		vm_kmemCacheFree(posix_common.pinfos, p);
 		if (pp != NULL) {
 			(void)proc_lockClear(&pp->lock);
 			pinfo_put(pp);
@@ -370,7 +373,7 @@ int posix_clone(int ppid)
 		hal_memset(p->fds, 0, (size_t)p->fdsz * sizeof(fildes_t));
 
 		for (i = 0; i < 3; ++i) {
-			f = vm_kmalloc(sizeof(open_file_t));
+			f = vm_kmemCacheAlloc(posix_common.files);
 			p->fds[i].file = f;
 			if (f == NULL) {
 				for (j = 0; j < i; j++) {
@@ -378,7 +381,7 @@ int posix_clone(int ppid)
 				}
 				(void)proc_lockDone(&p->lock);
 				vm_kfree(p->fds);
-				vm_kfree(p);
+				vm_kmemCacheFree(posix_common.pinfos, p);
 				return -ENOMEM;
 			}
 
@@ -560,7 +563,7 @@ int posix_open(const char *filename, int oflag, u8 *ustack)
 {
 	TRACE("open(%s, %d, %d)", filename, oflag);
 	oid_t ln, oid, dev, pipesrv;
-	int fd = 0, err = 0, created = 0;
+	int fd = 0, err = 0, created = 0, opened = 0;
 	process_info_t *p;
 	open_file_t *f;
 	mode_t mode;
@@ -585,7 +588,7 @@ int posix_open(const char *filename, int oflag, u8 *ustack)
 			break;
 		}
 
-		f = vm_kmalloc(sizeof(open_file_t));
+		f = vm_kmemCacheAlloc(posix_common.files);
 		if (f == NULL) {
 			err = -ENOMEM;
 			break;
@@ -596,10 +599,21 @@ int posix_open(const char *filename, int oflag, u8 *ustack)
 		(void)proc_lockClear(&p->lock);
 
 		do {
-			err = proc_lookup(filename, &ln, &oid);
-			if ((err == -ENOENT) && (((unsigned int)oflag & O_CREAT) != 0U)) {
+			/* Servers supporting it resolve, create and open the file in one message */
+			if (((unsigned int)oflag & O_CREAT) != 0U) {
 				GETFROMSTACK(ustack, mode_t, mode, 2U);
+				err = proc_lookupOpen(filename, (unsigned int)oflag, 1 /* otFile */, mode | S_IFREG, &ln, &oid, &opened);
+			}
+			else {
+				err = proc_lookupOpen(filename, (unsigned int)oflag, -1, 0, &ln, &oid, &opened);
+			}
 
+			/* Server could have created the file even if opening it failed afterwards */
+			if (opened == 2) {
+				created = 1;
+			}
+
+			if ((err == -ENOENT) && (((unsigned int)oflag & O_CREAT) != 0U)) {
 				err = posix_create(filename, 1 /* otFile */, mode | S_IFREG, dev, &oid);
 				if (err < 0) {
 					break;
@@ -614,7 +628,7 @@ int posix_open(const char *filename, int oflag, u8 *ustack)
 				/* No action required */
 			}
 
-			if (oid.port != US_PORT) {
+			if ((opened == 0) && (oid.port != US_PORT)) {
 				err = proc_open(oid, (unsigned int)oflag);
 				if (err < 0) {
 					break;
@@ -675,7 +689,7 @@ int posix_open(const char *filename, int oflag, u8 *ustack)
 		(void)proc_lockSet(&p->lock);
 		p->fds[fd].file = NULL;
 		(void)proc_lockDone(&f->lock);
-		vm_kfree(f);
+		vm_kmemCacheFree(posix_common.files, f);
 
 	} while (0);
 
@@ -990,16 +1004,16 @@ int posix_pipe(int fildes[2])
 		return res;
 	}
 
-	fo = vm_kmalloc(sizeof(open_file_t));
+	fo = vm_kmemCacheAlloc(posix_common.files);
 	if (fo == NULL) {
 		(void)proc_destroy(oid.port, oid);
 		pinfo_put(p);
 		return -ENOMEM;
 	}
 
-	fi = vm_kmalloc(sizeof(open_file_t));
+	fi = vm_kmemCacheAlloc(posix_common.files);
 	if (fi == NULL) {
-		vm_kfree(fo);
+		vm_kmemCacheFree(posix_common.files, fo);
 		(void)proc_destroy(oid.port, oid);
 		pinfo_put(p);
 		return -ENOMEM;
@@ -1014,8 +1028,8 @@ int posix_pipe(int fildes[2])
 	if ((fildes[0] < 0) || (fildes[1] < 0)) {
 		(void)proc_lockClear(&p->lock);
 
-		vm_kfree(fo);
-		vm_kfree(fi);
+		vm_kmemCacheFree(posix_common.files, fo);
+		vm_kmemCacheFree(posix_common.files, fi);
 
 		(void)proc_destroy(oid.port, oid);
 
@@ -2834,6 +2848,8 @@ void posix_init(void)
 {
 	(void)proc_lockInit(&posix_common.lock, &proc_lockAttrDefault, "posix.common");
 	lib_rbInit(&posix_common.pid, pinfo_cmp, NULL);
+	posix_common.files = vm_kmemCacheCreate("posix.file", sizeof(open_file_t), VM_KMEM_CACHELINE, NULL);
+	posix_common.pinfos = vm_kmemCacheCreate("posix.process", sizeof(process_info_t), 0, NULL);
 	unix_sockets_init();
 	posix_common.fresh = 0;
 	hal_memset(posix_common.hostname, 0, sizeof(posix_common.hostname));
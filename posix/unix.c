@@ -76,6 +76,7 @@ typedef struct _unixsock_t {
 static struct {
 	rbtree_t tree;
 	lock_t lock;
+	vm_kmemcache_t *cache;
 } unix_common;
 
 
@@ -203,7 +204,7 @@ static unixsock_t *unixsock_alloc(unsigned int *id, unsigned int type, int nonbl
 		}
 	}
 
-	r = vm_kmalloc(sizeof(unixsock_t));
+	r = vm_kmemCacheAlloc(unix_common.cache);
 	if (r == NULL) {
 		(void)proc_lockClear(&unix_common.lock);
 		return NULL;
@@ -313,7 +314,7 @@ static void unixsock_put(unixsock_t *s)
 		if (s->fdpacks != NULL) {
 			(void)fdpass_discard(&s->fdpacks);
 		}
-		vm_kfree(s);
+		vm_kmemCacheFree(unix_common.cache, s);
 		return;
 	}
 	(void)proc_lockClear(&unix_common.lock);
@@ -1280,4 +1281,5 @@ void unix_sockets_init(void)
 {
 	lib_rbInit(&unix_common.tree, unixsock_cmp, unixsock_augment);
 	(void)proc_lockInit(&unix_common.lock, &proc_lockAttrDefault, "unix.common");
+	unix_common.cache = vm_kmemCacheCreate("unix.socket", sizeof(unixsock_t), VM_KMEM_CACHELINE, NULL);
 }
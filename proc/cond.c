@@ -22,6 +22,11 @@
 #include "resource.h"
 
 
+static struct {
+	vm_kmemcache_t *cache;
+} cond_common;
+
+
 cond_t *cond_get(int c)
 {
 	thread_t *t = proc_current();
@@ -45,7 +50,7 @@ void cond_put(cond_t *cond)
 			t->process->path, process_getPid(t->process), proc_getTid(t));
 	if (rem == 0) {
 		proc_threadBroadcastYield(&cond->queue);
-		vm_kfree(cond);
+		vm_kmemCacheFree(cond_common.cache, cond);
 	}
 }
 
@@ -60,7 +65,7 @@ int proc_condCreate(const struct condAttr *attr)
 		return -EINVAL;
 	}
 
-	cond = vm_kmalloc(sizeof(*cond));
+	cond = vm_kmemCacheAlloc(cond_common.cache);
 	if (cond == NULL) {
 		return -ENOMEM;
 	}
@@ -70,7 +75,7 @@ int proc_condCreate(const struct condAttr *attr)
 
 	id = resource_alloc(p, &cond->resource);
 	if (id < 0) {
-		vm_kfree(cond);
+		vm_kmemCacheFree(cond_common.cache, cond);
 		return -ENOMEM;
 	}
 
@@ -179,3 +184,9 @@ int proc_condBroadcast(int c)
 
 	return EOK;
 }
+
+
+void _cond_init(void)
+{
+	cond_common.cache = vm_kmemCacheCreate("user.cond", sizeof(cond_t), 0, NULL);
+}
@@ -45,4 +45,7 @@ int proc_condSignal(int c);
 int proc_condBroadcast(int c);
 
 
+void _cond_init(void);
+
+
 #endif
@@ -18,11 +18,6 @@
 #include "proc.h"
 #include "vm/vm.h"
 
-/* clang-format off */
-enum { msg_rejected = -1, msg_waiting = 0, msg_received, msg_responded };
-/* clang-format on */
-
-
 static struct {
 	vm_map_t *kmap;
 	vm_object_t *kernel;
@@ -37,6 +32,7 @@ int proc_send(u32 port, msg_t *msg)
 	thread_t *sender;
 	spinlock_ctx_t sc;
 	int state;
+	u32 id;
 
 	p = proc_portGet(port);
 	if (p == NULL) {
@@ -60,7 +56,12 @@ int proc_send(u32 port, msg_t *msg)
 	}
 	else {
 		LIST_ADD(&p->kmessages, &kmsg);
+		_port_statQueue(p, &kmsg);
+		_port_pressureCheck(p);
 		(void)proc_threadWakeup(&p->threads);
+		if (p->set != NULL) {
+			(void)proc_threadWakeup(&p->set->threads);
+		}
 
 		state = kmsg.state;
 		while ((state != msg_responded) && (state != msg_rejected)) {
@@ -80,6 +81,7 @@ int proc_send(u32 port, msg_t *msg)
 			state = kmsg.state;
 			if ((err != EOK) && (state == msg_waiting)) {
 				LIST_REMOVE(&p->kmessages, &kmsg);
+				_port_statDequeue(p, &kmsg, 0);
 				break;
 			}
 		}
@@ -99,74 +101,149 @@ int proc_send(u32 port, msg_t *msg)
 
 	hal_spinlockClear(&p->spinlock, &sc);
 
+	id = (u32)p->linkage.id;
 	port_put(p, 0);
 
+	if ((err == EOK) && (msg->o.err >= 0)) {
+		proc_nameUpdate(id, msg);
+	}
+
 	return err;
 }
 
 
-static void proc_msgReject(kmsg_t *kmsg, port_t *p)
+static int msg_iovSize(const msg_iov_t *iov, size_t niov, size_t *size)
 {
-	spinlock_ctx_t sc;
+	size_t i;
 
-	hal_spinlockSet(&p->spinlock, &sc);
-	kmsg->state = msg_rejected;
-	(void)proc_threadWakeup(&kmsg->threads);
-	hal_spinlockClear(&p->spinlock, &sc);
+	*size = 0;
+	for (i = 0; i < niov; i++) {
+		if (iov[i].len > MSG_IOV_SIZE - *size) {
+			return -EINVAL;
+		}
+		*size += iov[i].len;
+	}
 
-	port_put(p, 0);
+	return EOK;
 }
 
 
-int proc_recv(u32 port, msg_t *msg, msg_rid_t *rid)
+static void *msg_iovGather(const msg_iov_t *iov, size_t niov, size_t size, int copy)
 {
-	port_t *p;
-	kmsg_t *kmsg;
-	spinlock_ctx_t sc;
-	int err = 0;
-	thread_t *current = proc_current();
-	void *idata = NULL;
+	size_t i, offs;
+	void *buf;
 
-	p = proc_portGet(port);
-	if (p == NULL) {
+	buf = vm_kmalloc(size);
+	if ((buf != NULL) && (copy != 0)) {
+		for (i = 0, offs = 0; i < niov; offs += iov[i].len, i++) {
+			hal_memcpy(buf + offs, iov[i].base, iov[i].len);
+		}
+	}
+
+	return buf;
+}
+
+
+/* Without MMU receiver accesses sender's buffer directly, segments are always gathered */
+int proc_sendv(u32 port, msg_t *msg, const msg_iov_t *iiov, size_t ni, const msg_iov_t *oiov, size_t no)
+{
+	msg_t m;
+	void *ibuf = NULL, *obuf = NULL;
+	size_t i, offs, isize, osize;
+	int err;
+
+	if ((msg == NULL) || (ni > MSG_IOV_MAX) || (no > MSG_IOV_MAX)) {
 		return -EINVAL;
 	}
 
-	hal_spinlockSet(&p->spinlock, &sc);
+	if ((msg_iovSize(iiov, ni, &isize) < 0) || (msg_iovSize(oiov, no, &osize) < 0)) {
+		return -EINVAL;
+	}
 
-	while ((p->kmessages == NULL) && (p->closed == 0) && (err != -EINTR)) {
-		err = proc_threadWaitInterruptible(&p->threads, &p->spinlock, 0, &sc);
+	hal_memcpy(&m, msg, sizeof(m));
+
+	if (ni == 1U) {
+		m.i.data = iiov[0].base;
+		m.i.size = isize;
+	}
+	else if (ni > 1U) {
+		m.i.size = isize;
+		ibuf = msg_iovGather(iiov, ni, isize, 1);
+		if (ibuf == NULL) {
+			return -ENOMEM;
+		}
+		m.i.data = ibuf;
+	}
+	else {
+		/* No action required */
 	}
 
-	kmsg = p->kmessages;
-	if (kmsg != NULL) {
-		kmsg->state = msg_received;
-		LIST_REMOVE(&p->kmessages, kmsg);
+	if (no == 1U) {
+		m.o.data = oiov[0].base;
+		m.o.size = osize;
+	}
+	else if (no > 1U) {
+		m.o.size = osize;
+		obuf = msg_iovGather(oiov, no, osize, 0);
+		if (obuf == NULL) {
+			if (ibuf != NULL) {
+				vm_kfree(ibuf);
+			}
+			return -ENOMEM;
+		}
+		m.o.data = obuf;
+	}
+	else {
+		/* No action required */
 	}
 
-	if (p->closed != 0) {
-		/* Port is being removed */
-		if (kmsg != NULL) {
-			kmsg->state = msg_rejected;
-			(void)proc_threadWakeup(&kmsg->threads);
+	err = proc_send(port, &m);
+
+	if (err == EOK) {
+		if (obuf != NULL) {
+			for (i = 0, offs = 0; i < no; offs += oiov[i].len, i++) {
+				hal_memcpy(oiov[i].base, obuf + offs, oiov[i].len);
+			}
 		}
 
-		err = -EINVAL;
+		hal_memcpy(msg->o.raw, m.o.raw, sizeof(msg->o.raw));
+		msg->o.err = m.o.err;
 	}
-	hal_spinlockClear(&p->spinlock, &sc);
 
-	if (err < 0) {
-		port_put(p, 0);
-		return err;
+	if (ibuf != NULL) {
+		vm_kfree(ibuf);
+	}
+	if (obuf != NULL) {
+		vm_kfree(obuf);
 	}
 
-	if (proc_portRidAlloc(p, kmsg) < 0) {
+	return err;
+}
+
+
+static void proc_msgReject(kmsg_t *kmsg, port_t *p)
+{
+	spinlock_ctx_t sc;
+
+	hal_spinlockSet(&p->spinlock, &sc);
+	_port_statReject(p, kmsg);
+	kmsg->state = msg_rejected;
+	(void)proc_threadWakeup(&kmsg->threads);
+	hal_spinlockClear(&p->spinlock, &sc);
+}
+
+
+static int msg_deliver(port_t *p, kmsg_t *kmsg, msg_t *msg, msg_rid_t *rid)
+{
+	thread_t *current = proc_current();
+	void *idata = NULL;
+
+	*rid = proc_portRidAlloc(p, kmsg);
+	if (*rid < 0) {
 		proc_msgReject(kmsg, p);
 		return -ENOMEM;
 	}
 
-	*rid = lib_idtreeId(&kmsg->idlinkage);
-
 	hal_memcpy(msg, kmsg->msg, sizeof(*msg));
 
 	kmsg->imapped = NULL;
@@ -206,24 +283,117 @@ int proc_recv(u32 port, msg_t *msg, msg_rid_t *rid)
 		kmsg->omapped = msg->o.data;
 	}
 
-	port_put(p, 0);
-
 	return EOK;
 }
 
 
-int proc_respond(u32 port, msg_t *msg, msg_rid_t rid)
+int proc_recvBatch(u32 port, msg_t *msgs, msg_rid_t *rids, size_t n)
 {
 	port_t *p;
 	kmsg_t *kmsg;
 	spinlock_ctx_t sc;
-	thread_t *current = proc_current();
+	size_t cnt = 0;
+	int err = EOK;
+
+	if (n == 0U) {
+		return -EINVAL;
+	}
 
 	p = proc_portGet(port);
 	if (p == NULL) {
 		return -EINVAL;
 	}
 
+	hal_spinlockSet(&p->spinlock, &sc);
+
+	while ((p->kmessages == NULL) && (p->closed == 0) && (err != -EINTR)) {
+		p->idle++;
+		err = proc_threadWaitInterruptible(&p->threads, &p->spinlock, 0, &sc);
+		p->idle--;
+	}
+
+	while ((err == EOK) && (cnt < n)) {
+		kmsg = p->kmessages;
+		if (kmsg != NULL) {
+			kmsg->state = msg_received;
+			LIST_REMOVE(&p->kmessages, kmsg);
+			_port_statDequeue(p, kmsg, (p->closed == 0) ? 1 : 0);
+		}
+
+		if (p->closed != 0) {
+			/* Port is being removed */
+			if (kmsg != NULL) {
+				kmsg->state = msg_rejected;
+				(void)proc_threadWakeup(&kmsg->threads);
+			}
+
+			err = -EINVAL;
+			break;
+		}
+
+		/* Don't block once we have something to return */
+		if (kmsg == NULL) {
+			break;
+		}
+
+		hal_spinlockClear(&p->spinlock, &sc);
+
+		err = msg_deliver(p, kmsg, &msgs[cnt], &rids[cnt]);
+		if (err == EOK) {
+			cnt++;
+		}
+
+		hal_spinlockSet(&p->spinlock, &sc);
+	}
+
+	hal_spinlockClear(&p->spinlock, &sc);
+	port_put(p, 0);
+
+	return (cnt != 0U) ? (int)cnt : err;
+}
+
+
+int proc_recv(u32 port, msg_t *msg, msg_rid_t *rid)
+{
+	int err = proc_recvBatch(port, msg, rid, 1);
+
+	return (err < 0) ? err : EOK;
+}
+
+
+int proc_recvSet(int set, msg_t *msg, msg_rid_t *rid, u32 *port)
+{
+	portset_t *s;
+	port_t *p;
+	kmsg_t *kmsg;
+	int err;
+
+	s = portset_get(set);
+	if (s == NULL) {
+		return -EINVAL;
+	}
+
+	err = portset_wait(s, &p, &kmsg);
+	portset_put(s);
+
+	if (err < 0) {
+		return err;
+	}
+
+	*port = (u32)p->linkage.id;
+	err = msg_deliver(p, kmsg, msg, rid);
+	port_put(p, 0);
+
+	return err;
+}
+
+
+static int msg_respond(port_t *p, msg_t *msg, msg_rid_t rid)
+{
+	kmsg_t *kmsg;
+	spinlock_ctx_t sc;
+	thread_t *current = proc_current();
+
 	kmsg = proc_portRidGet(p, rid);
 	if (kmsg == NULL) {
 		return -ENOENT;
@@ -242,16 +412,68 @@ int proc_respond(u32 port, msg_t *msg, msg_rid_t rid)
 	}
 
 	hal_spinlockSet(&p->spinlock, &sc);
+	_port_statRespond(p, kmsg);
 	kmsg->state = msg_responded;
 	kmsg->src = current->process;
 	(void)proc_threadWakeup(&kmsg->threads);
 	hal_spinlockClear(&p->spinlock, &sc);
-	port_put(p, 0);
 
 	return EOK;
 }
 
 
+int proc_respondBatch(u32 port, msg_t *msgs, const msg_rid_t *rids, size_t n)
+{
+	port_t *p;
+	size_t i;
+	int err = EOK;
+
+	if (n == 0U) {
+		return -EINVAL;
+	}
+
+	p = proc_portGet(port);
+	if (p == NULL) {
+		return -EINVAL;
+	}
+
+	for (i = 0; i < n; i++) {
+		err = msg_respond(p, &msgs[i], rids[i]);
+		if (err < 0) {
+			break;
+		}
+	}
+
+	port_put(p, 0);
+
+	return (i != 0U) ? (int)i : err;
+}
+
+
+int proc_respond(u32 port, msg_t *msg, msg_rid_t rid)
+{
+	int err = proc_respondBatch(port, msg, &rid, 1);
+
+	return (err < 0) ? err : EOK;
+}
+
+
+size_t proc_msgBounce(size_t threshold)
+{
+	/* Data is passed by pointer, nothing to copy */
+	(void)threshold;
+
+	return 0;
+}
+
+
+void proc_msgInfo(msginfo_t *info)
+{
+	/* Messages are passed by pointer, there are no mappings to cache */
+	hal_memset(info, 0, sizeof(*info));
+}
+
+
 void _msg_init(vm_map_t *kmap, vm_object_t *kernel)
 {
 	msg_common.kmap = kmap;
@@ -22,15 +22,867 @@
 #define CEIL(x)  (((x) + SIZE_PAGE - 1U) & ~(SIZE_PAGE - 1U))
 
 
+#ifndef MSG_MAPCACHE_SIZE
+#define MSG_MAPCACHE_SIZE 8U /* Cached receiver windows per address space */
+#endif
+
+#ifndef MSG_MAPCACHE_PAGES
+#define MSG_MAPCACHE_PAGES 16U /* Largest cached window in pages */
+#endif
+
+
+#ifndef MSG_BOUNCE_SIZE
+#define MSG_BOUNCE_SIZE 2048U /* Largest payload copied instead of mapped */
+#endif
+
+#ifndef MSG_BOUNCE_COUNT
+#define MSG_BOUNCE_COUNT 8U /* Bounce buffers per CPU */
+#endif
+
+#define MSG_BOUNCE_SLOTS 8U /* Receiver slots per address space */
+
+
+/* Mapping cache entry states */
 /* clang-format off */
-enum { msg_rejected = -1, msg_waiting = 0, msg_received, msg_responded };
+enum { mc_free = 0, mc_idle, mc_busy, mc_stale };
 /* clang-format on */
 
 
-static struct {
-	vm_map_t *kmap;
-	vm_object_t *kernel;
-} msg_common;
+/* Window layout, head and tail are copied through shadow pages */
+#define MSG_SHAPE_HEAD   1U
+#define MSG_SHAPE_TAIL   2U
+#define MSG_SHAPE_SHARED 4U /* Tail uses the head shadow page */
+
+
+/* Window of source pages kept mapped in the receiver between messages */
+typedef struct _msg_mapcache_t {
+	int state;
+	int invalid;
+	int dir;
+	unsigned int stamp;
+
+	vm_map_t *srcmap;
+	ptr_t start; /* First source page */
+	size_t npages;
+	unsigned int shape;
+
+	void *w;
+	page_t *bp;
+	page_t *ep;
+	void *bvaddr; /* Source head page in kernel */
+	void *evaddr; /* Source tail page in kernel */
+	void *bk;     /* Shadow head page in kernel */
+	void *ek;     /* Shadow tail page in kernel */
+} msg_mapcache_t;
+
+
+/* Windows cached in the receiver address space */
+typedef struct _msg_wcache_t {
+	struct _msg_wcache_t *next;
+	struct _msg_wcache_t *prev;
+	vm_map_t *map;
+
+	lock_t lock;
+	unsigned int count;
+	unsigned int stamp;
+
+	unsigned int hits;
+	unsigned int misses;
+	unsigned int invalidations;
+	unsigned int evictions;
+
+	msg_mapcache_t entries[MSG_MAPCACHE_SIZE];
+} msg_wcache_t;
+
+
+typedef struct _msg_bounce_t {
+	struct _msg_bounce_t *next;
+	struct _msg_bpool_t *pool;
+	u8 data[MSG_BOUNCE_SIZE];
+} msg_bounce_t;
+
+
+typedef struct _msg_bpool_t {
+	spinlock_t spinlock;
+	msg_bounce_t *free;
+	unsigned int count;
+} msg_bpool_t;
+
+
+typedef struct _msg_area_t {
+	spinlock_t spinlock;
+	void *base;
+	unsigned long free;
+} msg_area_t;
+
+
+static struct {
+	vm_map_t *kmap;
+	vm_object_t *kernel;
+
+	msg_bpool_t *bpools;
+	size_t bthreshold;
+
+	lock_t mclock; /* Protects list of window caches, taken before their locks */
+	msg_wcache_t *caches;
+
+	/* Statistics of destroyed caches */
+	unsigned int hits;
+	unsigned int misses;
+	unsigned int invalidations;
+	unsigned int evictions;
+} msg_common;
+
+
+static msg_bounce_t *msg_bounceAlloc(void)
+{
+	msg_bpool_t *pool;
+	msg_bounce_t *b = NULL;
+	unsigned int i, n, id;
+	spinlock_ctx_t sc;
+
+	if (msg_common.bpools == NULL) {
+		return NULL;
+	}
+
+	/* Start with pool of the current CPU */
+	n = hal_cpuGetCount();
+	id = hal_cpuGetID();
+
+	for (i = 0; (i < n) && (b == NULL); i++) {
+		pool = &msg_common.bpools[(id + i) % n];
+
+		hal_spinlockSet(&pool->spinlock, &sc);
+		b = pool->free;
+		if (b != NULL) {
+			pool->free = b->next;
+			pool->count++;
+		}
+		hal_spinlockClear(&pool->spinlock, &sc);
+	}
+
+	return b;
+}
+
+
+static void msg_bounceFree(msg_bounce_t *b)
+{
+	spinlock_ctx_t sc;
+
+	if (b != NULL) {
+		hal_spinlockSet(&b->pool->spinlock, &sc);
+		b->next = b->pool->free;
+		b->pool->free = b;
+		b->pool->count--;
+		hal_spinlockClear(&b->pool->spinlock, &sc);
+	}
+}
+
+
+/* Copies medium size payloads in sender context, so receiver doesn't have to map them */
+static void msg_bounceStage(kmsg_t *kmsg)
+{
+	size_t threshold = msg_common.bthreshold;
+
+	if ((kmsg->i.niov == 0U) && (kmsg->msg.i.data != NULL) && (kmsg->msg.i.size != 0U) && (kmsg->msg.i.size <= threshold) &&
+			((kmsg->msg.i.data < (void *)kmsg->msg.i.raw) || (kmsg->msg.i.data >= (void *)kmsg->msg.i.raw + sizeof(kmsg->msg.i.raw)))) {
+		kmsg->i.bounce = msg_bounceAlloc();
+		if (kmsg->i.bounce != NULL) {
+			hal_memcpy(kmsg->i.bounce->data, kmsg->msg.i.data, kmsg->msg.i.size);
+		}
+	}
+
+	/* Smaller output is packed by msg_opack() */
+	if ((kmsg->o.niov == 0U) && (kmsg->msg.o.data != NULL) && (kmsg->msg.o.size > sizeof(kmsg->msg.o.raw)) && (kmsg->msg.o.size <= threshold)) {
+		kmsg->o.bounce = msg_bounceAlloc();
+	}
+}
+
+
+static msg_area_t *msg_areaGet(vm_map_t *map)
+{
+	msg_area_t *area = map->msgarea;
+
+	if (area != NULL) {
+		return area;
+	}
+
+	area = vm_kmalloc(sizeof(*area));
+	if (area == NULL) {
+		return NULL;
+	}
+
+	area->base = vm_mmap(map, NULL, NULL, round_page(MSG_BOUNCE_SLOTS * MSG_BOUNCE_SIZE), PROT_READ | PROT_WRITE | PROT_USER, NULL, -1, MAP_NOINHERIT);
+	if (area->base == NULL) {
+		vm_kfree(area);
+		return NULL;
+	}
+
+	area->free = (1UL << MSG_BOUNCE_SLOTS) - 1U;
+	hal_spinlockCreate(&area->spinlock, "msg.area");
+
+	(void)proc_lockSet(&msg_common.mclock);
+	if (map->msgarea == NULL) {
+		map->msgarea = area;
+		area = NULL;
+	}
+	(void)proc_lockClear(&msg_common.mclock);
+
+	/* Other receiver thread was first */
+	if (area != NULL) {
+		(void)vm_munmap(map, area->base, round_page(MSG_BOUNCE_SLOTS * MSG_BOUNCE_SIZE));
+		hal_spinlockDestroy(&area->spinlock);
+		vm_kfree(area);
+	}
+
+	return map->msgarea;
+}
+
+
+static void *msg_bounceMap(int dir, struct _kmsg_layout_t *ml, size_t size, process_t *to)
+{
+	msg_area_t *area;
+	unsigned int i;
+	spinlock_ctx_t sc;
+
+	if (ml->bounce == NULL) {
+		return NULL;
+	}
+
+	/* Kernel receiver uses bounce buffer directly */
+	if (to == NULL) {
+		/* Don't expose output of the previous message */
+		if (dir != 0) {
+			hal_memset(ml->bounce->data, 0, size);
+		}
+		return ml->bounce->data;
+	}
+
+	area = msg_areaGet(to->mapp);
+	if (area == NULL) {
+		return NULL;
+	}
+
+	hal_spinlockSet(&area->spinlock, &sc);
+	if (area->free == 0U) {
+		hal_spinlockClear(&area->spinlock, &sc);
+		return NULL;
+	}
+	i = hal_cpuGetFirstBit(area->free);
+	area->free &= ~(1UL << i);
+	hal_spinlockClear(&area->spinlock, &sc);
+
+	ml->slot = area->base + i * MSG_BOUNCE_SIZE;
+
+	if (dir == 0) {
+		hal_memcpy(ml->slot, ml->bounce->data, size);
+	}
+	else {
+		hal_memset(ml->slot, 0, size);
+	}
+
+	return ml->slot;
+}
+
+
+static void msg_bounceUnmap(struct _kmsg_layout_t *ml, vm_map_t *map)
+{
+	msg_area_t *area = map->msgarea;
+	unsigned int i;
+	spinlock_ctx_t sc;
+
+	i = (unsigned int)((ptr_t)(ml->slot - area->base) / MSG_BOUNCE_SIZE);
+
+	hal_spinlockSet(&area->spinlock, &sc);
+	area->free |= 1UL << i;
+	hal_spinlockClear(&area->spinlock, &sc);
+
+	ml->slot = NULL;
+}
+
+
+size_t proc_msgBounce(size_t threshold)
+{
+	size_t prev = msg_common.bthreshold;
+
+	msg_common.bthreshold = min(threshold, MSG_BOUNCE_SIZE);
+
+	return prev;
+}
+
+
+static unsigned int msg_cacheShape(size_t boffs, size_t eoffs)
+{
+	unsigned int shape = 0;
+
+	if (boffs != 0U) {
+		shape |= MSG_SHAPE_HEAD;
+	}
+
+	if (eoffs != 0U) {
+		shape |= MSG_SHAPE_TAIL;
+		if ((boffs != 0U) && (eoffs < boffs)) {
+			shape |= MSG_SHAPE_SHARED;
+		}
+	}
+
+	return shape;
+}
+
+
+static int msg_cacheOverlaps(ptr_t start, size_t npages, ptr_t vstart, ptr_t vend)
+{
+	return ((start < vend) && (vstart < (start + npages * SIZE_PAGE))) ? 1 : 0;
+}
+
+
+static msg_wcache_t *msg_wcacheGet(vm_map_t *map)
+{
+	msg_wcache_t *c = map->msgcache;
+
+	if (c != NULL) {
+		return c;
+	}
+
+	c = vm_kmalloc(sizeof(*c));
+	if (c == NULL) {
+		return NULL;
+	}
+
+	hal_memset(c, 0, sizeof(*c));
+	c->map = map;
+	(void)proc_lockInit(&c->lock, &proc_lockAttrDefault, "msg.mapcache");
+
+	(void)proc_lockSet(&msg_common.mclock);
+	if (map->msgcache == NULL) {
+		map->msgcache = c;
+		LIST_ADD(&msg_common.caches, c);
+		c = NULL;
+	}
+	(void)proc_lockClear(&msg_common.mclock);
+
+	/* Other receiver thread was first */
+	if (c != NULL) {
+		(void)proc_lockDone(&c->lock);
+		vm_kfree(c);
+	}
+
+	return map->msgcache;
+}
+
+
+/* Must be called with entry removed from the cache, without cache lock, window is left in place if dstmap is NULL */
+static void msg_cacheTeardown(msg_mapcache_t *t, vm_map_t *dstmap)
+{
+	if ((dstmap != NULL) && (t->w != NULL)) {
+		(void)vm_munmap(dstmap, t->w, t->npages * SIZE_PAGE);
+	}
+
+	if ((t->ek != NULL) && (t->ek != t->bk)) {
+		(void)vm_munmap(msg_common.kmap, t->ek, SIZE_PAGE);
+	}
+
+	if (t->bk != NULL) {
+		(void)vm_munmap(msg_common.kmap, t->bk, SIZE_PAGE);
+	}
+
+	if (t->bp != NULL) {
+		vm_pageFree(t->bp);
+	}
+
+	if (t->ep != NULL) {
+		vm_pageFree(t->ep);
+	}
+
+	if (t->bvaddr != NULL) {
+		(void)vm_munmap(msg_common.kmap, t->bvaddr, SIZE_PAGE);
+	}
+
+	if (t->evaddr != NULL) {
+		(void)vm_munmap(msg_common.kmap, t->evaddr, SIZE_PAGE);
+	}
+}
+
+
+static void _msg_cacheTake(msg_wcache_t *c, msg_mapcache_t *e, msg_mapcache_t *t)
+{
+	hal_memcpy(t, e, sizeof(*t));
+
+	if (e->srcmap != NULL) {
+		(void)lib_atomicDecrement(&e->srcmap->msgrefs);
+	}
+
+	e->state = mc_free;
+	c->count--;
+}
+
+
+static void _msg_cacheStale(msg_wcache_t *c, msg_mapcache_t *e)
+{
+	if (e->state == mc_idle) {
+		/* Revoke receiver access to the source pages, the window itself is reclaimed by the receiver */
+		(void)pmap_remove(&c->map->pmap, e->w, e->w + e->npages * SIZE_PAGE);
+		e->state = mc_stale;
+		c->invalidations++;
+	}
+	else if ((e->state == mc_busy) && (e->invalid == 0)) {
+		e->invalid = 1;
+		c->invalidations++;
+	}
+	else {
+		/* No action required */
+	}
+
+	/* Stale window doesn't follow its source anymore, busy one is dropped on release */
+	if ((e->state == mc_stale) && (e->srcmap != NULL)) {
+		(void)lib_atomicDecrement(&e->srcmap->msgrefs);
+		e->srcmap = NULL;
+	}
+}
+
+
+/* Window found in the cache is still mapped, only shadowed head and tail are refreshed */
+static void *msg_cacheGet(int dir, struct _kmsg_layout_t *ml, vm_map_t *srcmap, vm_map_t *dstmap, const void *data, size_t size, size_t npages, size_t eoffs)
+{
+	msg_wcache_t *c = dstmap->msgcache;
+	msg_mapcache_t *e = NULL;
+	ptr_t start = FLOOR((ptr_t)data);
+	size_t boffs = (size_t)((ptr_t)data & (SIZE_PAGE - 1U));
+	unsigned int i, shape = msg_cacheShape(boffs, eoffs);
+
+	if (c == NULL) {
+		return NULL;
+	}
+
+	(void)proc_lockSet(&c->lock);
+
+	for (i = 0; i < MSG_MAPCACHE_SIZE; i++) {
+		e = &c->entries[i];
+		if ((e->state == mc_idle) && (e->srcmap == srcmap) && (e->dir == dir) && (e->start == start) && (e->npages == npages) && (e->shape == shape)) {
+			break;
+		}
+	}
+
+	if (i == MSG_MAPCACHE_SIZE) {
+		c->misses++;
+		(void)proc_lockClear(&c->lock);
+		return NULL;
+	}
+
+	e->state = mc_busy;
+	c->hits++;
+
+	(void)proc_lockClear(&c->lock);
+
+	if (e->bp != NULL) {
+		hal_memcpy(e->bk + boffs, e->bvaddr + boffs, (size_t)min(size, SIZE_PAGE - boffs));
+	}
+
+	if (eoffs != 0U) {
+		hal_memcpy(e->ek, e->evaddr, eoffs);
+	}
+
+	ml->cached = e;
+	ml->w = e->w;
+	ml->boffs = boffs;
+	ml->bp = e->bp;
+	ml->bvaddr = e->bvaddr;
+	ml->eoffs = eoffs;
+	ml->ep = e->ep;
+	ml->evaddr = e->evaddr;
+
+	return e->w + boffs;
+}
+
+
+static void msg_cacheAdd(int dir, struct _kmsg_layout_t *ml, vm_map_t *srcmap, vm_map_t *dstmap, const void *data, size_t npages)
+{
+	msg_wcache_t *c;
+	msg_mapcache_t *e = NULL, *f, t;
+	void *bk = NULL, *ek = NULL;
+	unsigned int i;
+	int victim = 0;
+
+	c = msg_wcacheGet(dstmap);
+	if (c == NULL) {
+		return;
+	}
+
+	/* Shadow pages are refreshed from the kernel on hit */
+	if (ml->bp != NULL) {
+		bk = vm_mmap(msg_common.kmap, NULL, ml->bp, SIZE_PAGE, PROT_READ | PROT_WRITE, msg_common.kernel, -1, MAP_NONE);
+		if (bk == NULL) {
+			return;
+		}
+	}
+
+	if (ml->ep != NULL) {
+		ek = vm_mmap(msg_common.kmap, NULL, ml->ep, SIZE_PAGE, PROT_READ | PROT_WRITE, msg_common.kernel, -1, MAP_NONE);
+		if (ek == NULL) {
+			if (bk != NULL) {
+				(void)vm_munmap(msg_common.kmap, bk, SIZE_PAGE);
+			}
+			return;
+		}
+	}
+	else if (ml->eoffs != 0U) {
+		/* Head and tail share one shadow page */
+		ek = bk;
+	}
+	else {
+		/* No action required */
+	}
+
+	(void)proc_lockSet(&c->lock);
+
+	/* Take a free slot or replace stale/least recently used entry */
+	for (i = 0; i < MSG_MAPCACHE_SIZE; i++) {
+		f = &c->entries[i];
+		if (f->state == mc_free) {
+			e = f;
+			break;
+		}
+
+		if (f->state != mc_busy) {
+			if ((e == NULL) || ((e->state == mc_idle) && ((f->state == mc_stale) || ((int)(f->stamp - e->stamp) < 0)))) {
+				e = f;
+			}
+		}
+	}
+
+	if (e == NULL) {
+		(void)proc_lockClear(&c->lock);
+
+		if ((ek != NULL) && (ek != bk)) {
+			(void)vm_munmap(msg_common.kmap, ek, SIZE_PAGE);
+		}
+		if (bk != NULL) {
+			(void)vm_munmap(msg_common.kmap, bk, SIZE_PAGE);
+		}
+		return;
+	}
+
+	if (e->state != mc_free) {
+		if (e->state == mc_idle) {
+			c->evictions++;
+		}
+		_msg_cacheTake(c, e, &t);
+		victim = 1;
+	}
+
+	e->state = mc_busy;
+	e->invalid = 0;
+	e->dir = dir;
+	e->srcmap = srcmap;
+	(void)lib_atomicIncrement(&srcmap->msgrefs);
+	e->start = FLOOR((ptr_t)data);
+	e->npages = npages;
+	e->shape = msg_cacheShape(ml->boffs, ml->eoffs);
+	e->w = ml->w;
+	e->bp = ml->bp;
+	e->ep = ml->ep;
+	e->bvaddr = ml->bvaddr;
+	e->evaddr = (ml->eoffs != 0U) ? ml->evaddr : NULL;
+	e->bk = bk;
+	e->ek = ek;
+	c->count++;
+
+	/* Source changed while the window was set up, before the entry became visible to msg_mapInvalidate() */
+	if (srcmap->msggen != ml->cgen) {
+		e->invalid = 1;
+	}
+
+	ml->cached = e;
+
+	(void)proc_lockClear(&c->lock);
+
+	if (victim != 0) {
+		msg_cacheTeardown(&t, dstmap);
+	}
+}
+
+
+/* Called in the receiver context, window stays mapped for the next message */
+static void msg_cacheRelease(vm_map_t *map, msg_mapcache_t *e)
+{
+	msg_wcache_t *c = map->msgcache;
+	msg_mapcache_t t;
+
+	(void)proc_lockSet(&c->lock);
+
+	if (e->invalid != 0) {
+		_msg_cacheTake(c, e, &t);
+		(void)proc_lockClear(&c->lock);
+
+		msg_cacheTeardown(&t, map);
+		return;
+	}
+
+	e->state = mc_idle;
+	e->stamp = ++c->stamp;
+
+	(void)proc_lockClear(&c->lock);
+}
+
+
+/* Drops windows of other maps showing pages of the source map range */
+static void msg_cacheSrcInvalidate(vm_map_t *map, ptr_t vstart, ptr_t vend, int destroy)
+{
+	msg_wcache_t *c;
+	msg_mapcache_t *e;
+	unsigned int i;
+
+	(void)proc_lockSet(&msg_common.mclock);
+
+	map->msggen++;
+
+	c = msg_common.caches;
+	if (c != NULL) {
+		do {
+			(void)proc_lockSet(&c->lock);
+
+			for (i = 0; i < MSG_MAPCACHE_SIZE; i++) {
+				e = &c->entries[i];
+				if ((e->state == mc_free) || (e->srcmap != map) || (msg_cacheOverlaps(e->start, e->npages, vstart, vend) == 0)) {
+					continue;
+				}
+
+				_msg_cacheStale(c, e);
+
+				/* Busy window of the destroyed source is torn down on release */
+				if ((destroy != 0) && (e->srcmap != NULL)) {
+					(void)lib_atomicDecrement(&map->msgrefs);
+					e->srcmap = NULL;
+				}
+			}
+
+			(void)proc_lockClear(&c->lock);
+			c = c->next;
+		} while (c != msg_common.caches);
+	}
+
+	(void)proc_lockClear(&msg_common.mclock);
+}
+
+
+void msg_mapInvalidate(vm_map_t *map, void *vaddr, size_t size)
+{
+	msg_wcache_t *c = map->msgcache;
+	msg_mapcache_t *e;
+	unsigned int i;
+	ptr_t vstart = (ptr_t)vaddr, vend = (ptr_t)vaddr + size;
+
+	/* Receiver unmapped or changed one of its windows */
+	if (c != NULL) {
+		(void)proc_lockSet(&c->lock);
+
+		for (i = 0; i < MSG_MAPCACHE_SIZE; i++) {
+			e = &c->entries[i];
+			if ((e->state != mc_free) && (e->w != NULL) && (msg_cacheOverlaps((ptr_t)e->w, e->npages, vstart, vend) != 0)) {
+				_msg_cacheStale(c, e);
+				/* Range doesn't belong to the window anymore, it isn't unmapped on teardown */
+				e->w = NULL;
+			}
+		}
+
+		(void)proc_lockClear(&c->lock);
+	}
+
+	if (map->msgrefs != 0U) {
+		msg_cacheSrcInvalidate(map, vstart, vend, 0);
+	}
+}
+
+
+int msg_mapBusy(vm_map_t *map, void *vaddr)
+{
+	struct _kmsg_layout_t *ml;
+	spinlock_t *sl = &map->msgspinlock;
+	spinlock_ctx_t sc;
+	int busy = 0;
+
+	/* Only messages sent from this map are walked */
+	hal_spinlockSet(sl, &sc);
+
+	ml = map->msgpins;
+	if (ml != NULL) {
+		do {
+			if (((ptr_t)vaddr >= ml->pstart) && ((ptr_t)vaddr < ml->pend)) {
+				busy = 1;
+				break;
+			}
+			ml = ml->pnext;
+		} while (ml != map->msgpins);
+	}
+
+	hal_spinlockClear(sl, &sc);
+
+	return busy;
+}
+
+
+/* Source pages are resolved and mapped directly, reclaim must leave them in place until release */
+static void msg_pin(struct _kmsg_layout_t *ml, vm_map_t *map, const msg_iov_t *iov, size_t niov)
+{
+	spinlock_ctx_t sc;
+	size_t i;
+
+	ml->pmap = map;
+	ml->pstart = FLOOR((ptr_t)iov[0].base);
+	ml->pend = CEIL((ptr_t)iov[0].base + iov[0].len);
+
+	for (i = 1; i < niov; i++) {
+		ml->pstart = min(ml->pstart, FLOOR((ptr_t)iov[i].base));
+		ml->pend = max(ml->pend, CEIL((ptr_t)iov[i].base + iov[i].len));
+	}
+
+	hal_spinlockSet(&map->msgspinlock, &sc);
+	LIST_ADD_EX(&map->msgpins, ml, pnext, pprev);
+	hal_spinlockClear(&map->msgspinlock, &sc);
+}
+
+
+static void msg_unpin(struct _kmsg_layout_t *ml)
+{
+	spinlock_ctx_t sc;
+
+	if (ml->pmap != NULL) {
+		hal_spinlockSet(&ml->pmap->msgspinlock, &sc);
+		LIST_REMOVE_EX(&ml->pmap->msgpins, ml, pnext, pprev);
+		hal_spinlockClear(&ml->pmap->msgspinlock, &sc);
+		ml->pmap = NULL;
+	}
+}
+
+
+void msg_mapDestroy(vm_map_t *map)
+{
+	msg_wcache_t *c = map->msgcache;
+	msg_mapcache_t t;
+	unsigned int i;
+
+	/* Bounce slots vanish with the map */
+	if (map->msgarea != NULL) {
+		hal_spinlockDestroy(&map->msgarea->spinlock);
+		vm_kfree(map->msgarea);
+		map->msgarea = NULL;
+	}
+
+	if (map->msgrefs != 0U) {
+		msg_cacheSrcInvalidate(map, 0, (ptr_t)-1, 1);
+	}
+
+	if (c == NULL) {
+		return;
+	}
+
+	(void)proc_lockSet(&msg_common.mclock);
+	LIST_REMOVE(&msg_common.caches, c);
+	map->msgcache = NULL;
+	msg_common.hits += c->hits;
+	msg_common.misses += c->misses;
+	msg_common.invalidations += c->invalidations;
+	msg_common.evictions += c->evictions;
+	(void)proc_lockClear(&msg_common.mclock);
+
+	/* Receiver is gone, no thread uses its windows and they vanish with the map */
+	for (i = 0; i < MSG_MAPCACHE_SIZE; i++) {
+		if (c->entries[i].state != mc_free) {
+			_msg_cacheTake(c, &c->entries[i], &t);
+			msg_cacheTeardown(&t, NULL);
+		}
+	}
+
+	(void)proc_lockDone(&c->lock);
+	vm_kfree(c);
+}
+
+
+void proc_msgInfo(msginfo_t *info)
+{
+	msg_wcache_t *c;
+	unsigned int i;
+	spinlock_ctx_t sc;
+
+	info->bounce.size = MSG_BOUNCE_SIZE;
+	info->bounce.threshold = msg_common.bthreshold;
+	info->bounce.count = 0;
+
+	if (msg_common.bpools != NULL) {
+		for (i = 0; i < hal_cpuGetCount(); i++) {
+			hal_spinlockSet(&msg_common.bpools[i].spinlock, &sc);
+			info->bounce.count += msg_common.bpools[i].count;
+			hal_spinlockClear(&msg_common.bpools[i].spinlock, &sc);
+		}
+	}
+
+	(void)proc_lockSet(&msg_common.mclock);
+
+	info->mapcache.size = 0;
+	info->mapcache.entries = 0;
+	info->mapcache.hits = msg_common.hits;
+	info->mapcache.misses = msg_common.misses;
+	info->mapcache.invalidations = msg_common.invalidations;
+	info->mapcache.evictions = msg_common.evictions;
+
+	/* Counters of each cache are read without its lock */
+	c = msg_common.caches;
+	if (c != NULL) {
+		do {
+			info->mapcache.size += MSG_MAPCACHE_SIZE;
+			info->mapcache.entries += c->count;
+			info->mapcache.hits += c->hits;
+			info->mapcache.misses += c->misses;
+			info->mapcache.invalidations += c->invalidations;
+			info->mapcache.evictions += c->evictions;
+			c = c->next;
+		} while (c != msg_common.caches);
+	}
+
+	(void)proc_lockClear(&msg_common.mclock);
+}
+
+
+static size_t msg_iovPages(const msg_iov_t *iov)
+{
+	return (CEIL((ptr_t)iov->base + iov->len) - FLOOR((ptr_t)iov->base)) / SIZE_PAGE;
+}
+
+
+/* Returns address of k-th page of the window formed by segments */
+static void *msg_iovPage(const msg_iov_t *iov, size_t niov, size_t k)
+{
+	size_t s, np;
+
+	for (s = 0; s < niov; s++) {
+		np = msg_iovPages(&iov[s]);
+		if (k < np) {
+			break;
+		}
+		k -= np;
+	}
+
+	return (void *)(FLOOR((ptr_t)iov[s].base) + k * SIZE_PAGE);
+}
+
+
+/* Segments can form one window if they meet at page boundaries */
+static int msg_iovWindow(const msg_iov_t *iov, size_t niov)
+{
+	size_t s, size = 0;
+
+	for (s = 0; s < niov; s++) {
+		if ((iov[s].len == 0U) ||
+				((s != 0U) && (((ptr_t)iov[s].base & (SIZE_PAGE - 1U)) != 0U)) ||
+				((s != niov - 1U) && ((((ptr_t)iov[s].base + iov[s].len) & (SIZE_PAGE - 1U)) != 0U))) {
+			return 0;
+		}
+		size += iov[s].len;
+	}
+
+	/* Small payloads are cheaper to copy */
+	return (size >= SIZE_PAGE) ? 1 : 0;
+}
 
 
 static void *msg_map(int dir, kmsg_t *kmsg, void *data, size_t size, process_t *from, process_t *to)
@@ -38,7 +890,10 @@ static void *msg_map(int dir, kmsg_t *kmsg, void *data, size_t size, process_t *
 	void *w = NULL, *vaddr;
 	size_t boffs, eoffs;
 	u8 bone, eone;
-	size_t n = 0, i;
+	size_t n = 0, i, npages;
+	msg_iov_t seg;
+	const msg_iov_t *iov;
+	size_t niov;
 	vm_attr_t attr;
 	vm_prot_t prot;
 	page_t *nep = NULL, *nbp = NULL;
@@ -47,6 +902,7 @@ static void *msg_map(int dir, kmsg_t *kmsg, void *data, size_t size, process_t *
 	int err;
 	vm_flags_t flags;
 	addr_t bpa, pa, epa;
+	int cache;
 
 	if ((size == 0U) || (data == NULL)) {
 		return NULL;
@@ -65,30 +921,73 @@ static void *msg_map(int dir, kmsg_t *kmsg, void *data, size_t size, process_t *
 		prot |= PROT_USER;
 	}
 
-	boffs = (size_t)(ptr_t)data & (size_t)(SIZE_PAGE - 1U);
+	/* Single buffer is a window of one segment */
+	if (ml->niov != 0U) {
+		iov = ml->iov;
+		niov = ml->niov;
+	}
+	else {
+		seg.base = data;
+		seg.len = size;
+		iov = &seg;
+		niov = 1;
+	}
 
-	if (FLOOR((ptr_t)data + size) > CEIL((ptr_t)data)) {
-		n = (FLOOR((ptr_t)data + size) - CEIL((ptr_t)data)) / SIZE_PAGE;
+	npages = 0;
+	for (i = 0; i < niov; i++) {
+		npages += msg_iovPages(&iov[i]);
 	}
 
-	if ((boffs != 0U) && (FLOOR((ptr_t)data) == FLOOR((ptr_t)data + size))) {
+	boffs = (size_t)(ptr_t)data & (size_t)(SIZE_PAGE - 1U);
+
+	if ((boffs != 0U) && (npages == 1U)) {
 		/* Data is on one page only and will be copied by boffs handler */
 		eoffs = 0U;
 	}
 	else {
-		eoffs = ((size_t)(ptr_t)data + size) & (size_t)(SIZE_PAGE - 1U);
+		eoffs = ((size_t)(ptr_t)iov[niov - 1U].base + iov[niov - 1U].len) & (size_t)(SIZE_PAGE - 1U);
 	}
 
 	bone = (boffs != 0U) ? 1U : 0U;
 	eone = (eoffs != 0U) ? 1U : 0U;
+	n = npages - bone - eone;
 
 	srcmap = (from == NULL) ? msg_common.kmap : from->mapp;
 	dstmap = (to == NULL) ? msg_common.kmap : to->mapp;
 
-	if ((srcmap == dstmap) && (pmap_belongs(&dstmap->pmap, data) != 0)) {
+	if ((niov == 1U) && (srcmap == dstmap) && (pmap_belongs(&dstmap->pmap, data) != 0)) {
 		return data;
 	}
 
+	if (from != NULL) {
+		msg_pin(ml, srcmap, iov, niov);
+	}
+
+#ifndef NOMMU
+	/* Pages are resolved below, source could have been left unpopulated or write-protected by fork */
+	if ((from != NULL) && (pmap_belongs(&srcmap->pmap, data) != 0)) {
+		for (i = 0; i < niov; i++) {
+			if (vm_mapPopulate(srcmap, iov[i].base, iov[i].len, prot & (PROT_READ | PROT_WRITE)) != EOK) {
+				return NULL;
+			}
+		}
+	}
+#endif
+
+	/* Cache only single buffer windows between user processes */
+	cache = ((niov == 1U) && (from != NULL) && (to != NULL) && ((n + bone + eone) <= MSG_MAPCACHE_PAGES) && (pmap_belongs(&srcmap->pmap, data) != 0)) ? 1 : 0;
+	if (cache != 0) {
+		w = msg_cacheGet(dir, ml, srcmap, dstmap, data, size, npages, eoffs);
+		if (w != NULL) {
+			return w;
+		}
+
+		/* Source invalidations from now on reach the window, vm_mapFlags() below orders them with resolving pages */
+		(void)lib_atomicIncrement(&srcmap->msgrefs);
+		ml->csrc = srcmap;
+		ml->cgen = srcmap->msggen;
+	}
+
 	w = vm_mapFind(dstmap, NULL, (n + bone + eone) * SIZE_PAGE, MAP_NOINHERIT, prot);
 	ml->w = w;
 	if (w == NULL) {
@@ -138,19 +1037,17 @@ static void *msg_map(int dir, kmsg_t *kmsg, void *data, size_t size, process_t *
 	}
 
 	/* Map pages */
-	vaddr = (void *)CEIL((ptr_t)data);
-
 	for (i = 0; i < n; i++) {
+		vaddr = msg_iovPage(iov, niov, i + bone);
 		pa = pmap_resolve(&srcmap->pmap, vaddr) & ~(SIZE_PAGE - 1U);
 		if (page_map(&dstmap->pmap, w + (i + bone) * SIZE_PAGE, pa, attr) < 0) {
 			return NULL;
 		}
-		vaddr += SIZE_PAGE;
 	}
 
 	if (eoffs != 0U) {
 		ml->eoffs = eoffs;
-		vaddr = (void *)FLOOR((ptr_t)data + size);
+		vaddr = msg_iovPage(iov, niov, npages - 1U);
 		epa = pmap_resolve(&srcmap->pmap, vaddr) & ~(SIZE_PAGE - 1U);
 
 		if ((boffs == 0U) || (eoffs >= boffs)) {
@@ -182,62 +1079,74 @@ static void *msg_map(int dir, kmsg_t *kmsg, void *data, size_t size, process_t *
 		}
 	}
 
+	if (cache != 0) {
+		msg_cacheAdd(dir, ml, srcmap, dstmap, data, npages);
+	}
+
 	return (w + boffs);
 }
 
 
-static void msg_release(kmsg_t *kmsg)
+static void msg_layoutRelease(struct _kmsg_layout_t *ml, vm_map_t *map, const void *data, size_t size)
 {
-	process_t *process;
-	vm_map_t *map;
+	msg_unpin(ml);
 
-	if (kmsg->i.bp != NULL) {
-		vm_pageFree(kmsg->i.bp);
-		(void)vm_munmap(msg_common.kmap, kmsg->i.bvaddr, SIZE_PAGE);
-		kmsg->i.bp = NULL;
+	if (ml->slot != NULL) {
+		msg_bounceUnmap(ml, map);
 	}
 
-	if (kmsg->i.eoffs != 0U) {
-		if (kmsg->i.ep != NULL) {
-			vm_pageFree(kmsg->i.ep);
-		}
-		(void)vm_munmap(msg_common.kmap, kmsg->i.evaddr, SIZE_PAGE);
-		kmsg->i.eoffs = 0;
-		kmsg->i.ep = NULL;
+	if (ml->csrc != NULL) {
+		(void)lib_atomicDecrement(&ml->csrc->msgrefs);
+		ml->csrc = NULL;
 	}
 
-	process = proc_current()->process;
-	if (process != NULL) {
-		map = process->mapp;
-	}
-	else {
-		map = msg_common.kmap;
+	if (ml->cached != NULL) {
+		msg_cacheRelease(map, ml->cached);
+		ml->cached = NULL;
+		ml->bp = NULL;
+		ml->eoffs = 0;
+		ml->ep = NULL;
+		ml->w = NULL;
+		return;
 	}
 
-	if (kmsg->i.w != NULL) {
-		(void)vm_munmap(map, kmsg->i.w, CEIL((ptr_t)kmsg->msg.i.data + kmsg->msg.i.size) - FLOOR((ptr_t)kmsg->msg.i.data));
-		kmsg->i.w = NULL;
+	if (ml->bp != NULL) {
+		vm_pageFree(ml->bp);
+		(void)vm_munmap(msg_common.kmap, ml->bvaddr, SIZE_PAGE);
+		ml->bp = NULL;
 	}
 
-	if (kmsg->o.bp != NULL) {
-		vm_pageFree(kmsg->o.bp);
-		(void)vm_munmap(msg_common.kmap, kmsg->o.bvaddr, SIZE_PAGE);
-		kmsg->o.bp = NULL;
+	if (ml->eoffs != 0U) {
+		if (ml->ep != NULL) {
+			vm_pageFree(ml->ep);
+		}
+		(void)vm_munmap(msg_common.kmap, ml->evaddr, SIZE_PAGE);
+		ml->eoffs = 0;
+		ml->ep = NULL;
 	}
 
-	if (kmsg->o.eoffs != 0U) {
-		if (kmsg->o.ep != NULL) {
-			vm_pageFree(kmsg->o.ep);
-		}
-		(void)vm_munmap(msg_common.kmap, kmsg->o.evaddr, SIZE_PAGE);
-		kmsg->o.eoffs = 0;
-		kmsg->o.ep = NULL;
+	if (ml->w != NULL) {
+		(void)vm_munmap(map, ml->w, CEIL((ptr_t)data + size) - FLOOR((ptr_t)data));
+		ml->w = NULL;
 	}
+}
+
+
+static void msg_release(kmsg_t *kmsg)
+{
+	process_t *process;
+	vm_map_t *map;
 
-	if (kmsg->o.w != NULL) {
-		(void)vm_munmap(map, kmsg->o.w, CEIL((ptr_t)kmsg->msg.o.data + kmsg->msg.o.size) - FLOOR((ptr_t)kmsg->msg.o.data));
-		kmsg->o.w = NULL;
+	process = proc_current()->process;
+	if (process != NULL) {
+		map = process->mapp;
+	}
+	else {
+		map = msg_common.kmap;
 	}
+
+	msg_layoutRelease(&kmsg->i, map, kmsg->msg.i.data, kmsg->msg.i.size);
+	msg_layoutRelease(&kmsg->o, map, kmsg->msg.o.data, kmsg->msg.o.size);
 }
 
 
@@ -347,7 +1256,7 @@ static int msg_opack(kmsg_t *kmsg)
 }
 
 
-int proc_send(u32 port, msg_t *msg)
+static int msg_send(u32 port, msg_t *msg, const msg_iov_t *iiov, size_t ni, const msg_iov_t *oiov, size_t no)
 {
 	port_t *p;
 	int err = EOK;
@@ -355,6 +1264,7 @@ int proc_send(u32 port, msg_t *msg)
 	thread_t *sender;
 	spinlock_ctx_t sc;
 	int state;
+	u32 id;
 
 	/* TODO - check if msg pointer belongs to user vm_map */
 	if (msg == NULL) {
@@ -376,7 +1286,22 @@ int proc_send(u32 port, msg_t *msg)
 	kmsg.msg.pid = (sender->process != NULL) ? process_getPid(sender->process) : 0;
 	kmsg.msg.priority = sender->priority;
 
-	msg_ipack(&kmsg);
+	kmsg.i.iov = iiov;
+	kmsg.i.niov = ni;
+	kmsg.o.iov = oiov;
+	kmsg.o.niov = no;
+
+	if (ni == 0U) {
+		msg_ipack(&kmsg);
+	}
+
+	kmsg.i.bounce = NULL;
+	kmsg.o.bounce = NULL;
+
+	/* Kernel to kernel messages are never mapped */
+	if ((kmsg.src != NULL) || (p->owner != NULL)) {
+		msg_bounceStage(&kmsg);
+	}
 
 	hal_spinlockSet(&p->spinlock, &sc);
 
@@ -385,7 +1310,12 @@ int proc_send(u32 port, msg_t *msg)
 	}
 	else {
 		LIST_ADD(&p->kmessages, &kmsg);
+		_port_statQueue(p, &kmsg);
+		_port_pressureCheck(p);
 		(void)proc_threadWakeup(&p->threads);
+		if (p->set != NULL) {
+			(void)proc_threadWakeup(&p->set->threads);
+		}
 
 		state = kmsg.state;
 		while ((state != msg_responded) && (state != msg_rejected)) {
@@ -405,6 +1335,7 @@ int proc_send(u32 port, msg_t *msg)
 			state = kmsg.state;
 			if ((err != EOK) && (state == msg_waiting)) {
 				LIST_REMOVE(&p->kmessages, &kmsg);
+				_port_statDequeue(p, &kmsg, 0);
 				break;
 			}
 		}
@@ -423,65 +1354,151 @@ int proc_send(u32 port, msg_t *msg)
 	}
 
 	hal_spinlockClear(&p->spinlock, &sc);
+	id = (u32)p->linkage.id;
 	port_put(p, 0);
 
 	if (err == EOK) {
 		hal_memcpy(msg->o.raw, kmsg.msg.o.raw, sizeof(msg->o.raw));
 		msg->o.err = kmsg.msg.o.err;
 
+		if (msg->o.err >= 0) {
+			proc_nameUpdate(id, msg);
+		}
+
 		/* If msg.o.data has been packed to msg.o.raw */
 		if ((kmsg.msg.o.data >= (void *)kmsg.msg.o.raw) && (kmsg.msg.o.data < (void *)kmsg.msg.o.raw + sizeof(kmsg.msg.o.raw))) {
 			hal_memcpy(msg->o.data, kmsg.msg.o.data, msg->o.size);
 		}
+		else if (kmsg.o.bounce != NULL) {
+			hal_memcpy(msg->o.data, kmsg.o.bounce->data, kmsg.msg.o.size);
+		}
+		else {
+			/* No action required */
+		}
 	}
 
+	msg_bounceFree(kmsg.i.bounce);
+	msg_bounceFree(kmsg.o.bounce);
+
 	return err;
 }
 
 
-int proc_recv(u32 port, msg_t *msg, msg_rid_t *rid)
+int proc_send(u32 port, msg_t *msg)
 {
-	port_t *p;
-	kmsg_t *kmsg;
-	int ipacked = 0, opacked = 0, err = EOK;
-	spinlock_ctx_t sc;
+	return msg_send(port, msg, NULL, 0, NULL, 0);
+}
 
-	p = proc_portGet(port);
-	if (p == NULL) {
-		return -EINVAL;
+
+static int msg_iovSize(const msg_iov_t *iov, size_t niov, size_t *size)
+{
+	size_t i;
+
+	*size = 0;
+	for (i = 0; i < niov; i++) {
+		if (iov[i].len > MSG_IOV_SIZE - *size) {
+			return -EINVAL;
+		}
+		*size += iov[i].len;
 	}
 
-	hal_spinlockSet(&p->spinlock, &sc);
+	return EOK;
+}
 
-	while ((p->kmessages == NULL) && (p->closed == 0) && (err != -EINTR)) {
-		err = proc_threadWaitInterruptible(&p->threads, &p->spinlock, 0, &sc);
+
+int proc_sendv(u32 port, msg_t *msg, const msg_iov_t *iiov, size_t ni, const msg_iov_t *oiov, size_t no)
+{
+	msg_t m;
+	void *ibuf = NULL, *obuf = NULL;
+	size_t i, offs, isize, osize, wi = 0, wo = 0;
+	int err;
+
+	if ((msg == NULL) || (ni > MSG_IOV_MAX) || (no > MSG_IOV_MAX)) {
+		return -EINVAL;
+	}
+
+	if ((msg_iovSize(iiov, ni, &isize) < 0) || (msg_iovSize(oiov, no, &osize) < 0)) {
+		return -EINVAL;
 	}
 
-	kmsg = p->kmessages;
+	/* Work on a copy, caller's msg never sees kernel buffers */
+	hal_memcpy(&m, msg, sizeof(m));
 
-	if (p->closed != 0) {
-		/* Port is being removed */
-		if (kmsg != NULL) {
-			kmsg->state = msg_rejected;
-			LIST_REMOVE(&p->kmessages, kmsg);
-			(void)proc_threadWakeup(&kmsg->threads);
+	if (ni != 0U) {
+		m.i.data = iiov[0].base;
+		m.i.size = isize;
+
+		if (ni == 1U) {
+			/* Plain buffer */
 		}
+		else if (msg_iovWindow(iiov, ni) != 0) {
+			wi = ni;
+		}
+		else {
+			ibuf = vm_kmalloc(isize);
+			if (ibuf == NULL) {
+				return -ENOMEM;
+			}
 
-		err = -EINVAL;
+			for (i = 0, offs = 0; i < ni; offs += iiov[i].len, i++) {
+				hal_memcpy(ibuf + offs, iiov[i].base, iiov[i].len);
+			}
+			m.i.data = ibuf;
+		}
 	}
-	else {
-		if (err == EOK) {
-			LIST_REMOVE(&p->kmessages, kmsg);
-			kmsg->state = msg_received;
+
+	if (no != 0U) {
+		m.o.data = oiov[0].base;
+		m.o.size = osize;
+
+		if (no == 1U) {
+			/* Plain buffer */
+		}
+		else if (msg_iovWindow(oiov, no) != 0) {
+			wo = no;
+		}
+		else {
+			obuf = vm_kmalloc(osize);
+			if (obuf == NULL) {
+				if (ibuf != NULL) {
+					vm_kfree(ibuf);
+				}
+				return -ENOMEM;
+			}
+			m.o.data = obuf;
 		}
 	}
-	hal_spinlockClear(&p->spinlock, &sc);
 
-	if (err != EOK) {
-		port_put(p, 0);
-		return err;
+	err = msg_send(port, &m, (wi != 0U) ? iiov : NULL, wi, (wo != 0U) ? oiov : NULL, wo);
+
+	if (err == EOK) {
+		if (obuf != NULL) {
+			for (i = 0, offs = 0; i < no; offs += oiov[i].len, i++) {
+				hal_memcpy(oiov[i].base, obuf + offs, oiov[i].len);
+			}
+		}
+
+		hal_memcpy(msg->o.raw, m.o.raw, sizeof(msg->o.raw));
+		msg->o.err = m.o.err;
+	}
+
+	if (ibuf != NULL) {
+		vm_kfree(ibuf);
+	}
+	if (obuf != NULL) {
+		vm_kfree(obuf);
 	}
 
+	return err;
+}
+
+
+static int msg_deliver(port_t *p, kmsg_t *kmsg, msg_t *msg, msg_rid_t *rid)
+{
+	int ipacked = 0, opacked = 0;
+	void *data;
+	spinlock_ctx_t sc;
+
 	kmsg->i.bvaddr = NULL;
 	kmsg->i.boffs = 0;
 	kmsg->i.w = NULL;
@@ -489,6 +1506,10 @@ int proc_recv(u32 port, msg_t *msg, msg_rid_t *rid)
 	kmsg->i.evaddr = NULL;
 	kmsg->i.eoffs = 0;
 	kmsg->i.ep = NULL;
+	kmsg->i.cached = NULL;
+	kmsg->i.slot = NULL;
+	kmsg->i.pmap = NULL;
+	kmsg->i.csrc = NULL;
 
 	kmsg->o.bvaddr = NULL;
 	kmsg->o.boffs = 0;
@@ -497,6 +1518,10 @@ int proc_recv(u32 port, msg_t *msg, msg_rid_t *rid)
 	kmsg->o.evaddr = NULL;
 	kmsg->o.eoffs = 0;
 	kmsg->o.ep = NULL;
+	kmsg->o.cached = NULL;
+	kmsg->o.slot = NULL;
+	kmsg->o.pmap = NULL;
+	kmsg->o.csrc = NULL;
 
 	if ((kmsg->msg.i.data >= (void *)kmsg->msg.i.raw) && (kmsg->msg.i.data < (void *)kmsg->msg.i.raw + sizeof(kmsg->msg.i.raw))) {
 		ipacked = 1;
@@ -505,31 +1530,47 @@ int proc_recv(u32 port, msg_t *msg, msg_rid_t *rid)
 	/* Map data in receiver space */
 	/* Don't map if msg is packed */
 	if (ipacked == 0) {
-		kmsg->msg.i.data = msg_map(0, kmsg, (void *)(ptr_t)kmsg->msg.i.data, kmsg->msg.i.size, kmsg->src, proc_current()->process);
+		data = msg_bounceMap(0, &kmsg->i, kmsg->msg.i.size, proc_current()->process);
+		if (data == NULL) {
+			msg_bounceFree(kmsg->i.bounce);
+			kmsg->i.bounce = NULL;
+			data = msg_map(0, kmsg, (void *)(ptr_t)kmsg->msg.i.data, kmsg->msg.i.size, kmsg->src, proc_current()->process);
+		}
+		kmsg->msg.i.data = data;
 	}
 
-	opacked = msg_opack(kmsg);
+	opacked = (kmsg->o.niov == 0U) ? msg_opack(kmsg) : 0;
 	if (opacked == 0) {
-		kmsg->msg.o.data = msg_map(1, kmsg, kmsg->msg.o.data, kmsg->msg.o.size, kmsg->src, proc_current()->process);
+		data = msg_bounceMap(1, &kmsg->o, kmsg->msg.o.size, proc_current()->process);
+		if (data == NULL) {
+			/* Reply goes directly to the sender buffer, nothing to copy back in msg_send */
+			msg_bounceFree(kmsg->o.bounce);
+			kmsg->o.bounce = NULL;
+			data = msg_map(1, kmsg, kmsg->msg.o.data, kmsg->msg.o.size, kmsg->src, proc_current()->process);
+		}
+		kmsg->msg.o.data = data;
 	}
 
 	if (((kmsg->msg.i.size != 0U) && (kmsg->msg.i.data == NULL)) ||
-			((kmsg->msg.o.size != 0U) && (kmsg->msg.o.data == NULL)) ||
-			(proc_portRidAlloc(p, kmsg) < 0)) {
+			((kmsg->msg.o.size != 0U) && (kmsg->msg.o.data == NULL))) {
+		*rid = -ENOMEM;
+	}
+	else {
+		*rid = proc_portRidAlloc(p, kmsg);
+	}
+
+	if (*rid < 0) {
 		msg_release(kmsg);
 
 		hal_spinlockSet(&p->spinlock, &sc);
+		_port_statReject(p, kmsg);
 		kmsg->state = msg_rejected;
 		(void)proc_threadWakeup(&kmsg->threads);
 		hal_spinlockClear(&p->spinlock, &sc);
 
-		port_put(p, 0);
-
 		return -ENOMEM;
 	}
 
-	*rid = lib_idtreeId(&kmsg->idlinkage);
-
 	hal_memcpy(msg, &kmsg->msg, sizeof(*msg));
 
 	if (ipacked != 0) {
@@ -540,23 +1581,116 @@ int proc_recv(u32 port, msg_t *msg, msg_rid_t *rid)
 		msg->o.data = msg->o.raw + (kmsg->msg.o.data - (void *)kmsg->msg.o.raw);
 	}
 
-	port_put(p, 0);
-
 	return EOK;
 }
 
 
-int proc_respond(u32 port, msg_t *msg, msg_rid_t rid)
+int proc_recvBatch(u32 port, msg_t *msgs, msg_rid_t *rids, size_t n)
 {
 	port_t *p;
 	kmsg_t *kmsg;
+	size_t cnt = 0;
+	int err = EOK;
 	spinlock_ctx_t sc;
 
+	if (n == 0U) {
+		return -EINVAL;
+	}
+
 	p = proc_portGet(port);
 	if (p == NULL) {
 		return -EINVAL;
 	}
 
+	hal_spinlockSet(&p->spinlock, &sc);
+
+	while ((p->kmessages == NULL) && (p->closed == 0) && (err != -EINTR)) {
+		p->idle++;
+		err = proc_threadWaitInterruptible(&p->threads, &p->spinlock, 0, &sc);
+		p->idle--;
+	}
+
+	while ((err == EOK) && (cnt < n)) {
+		kmsg = p->kmessages;
+
+		if (p->closed != 0) {
+			/* Port is being removed */
+			if (kmsg != NULL) {
+				kmsg->state = msg_rejected;
+				LIST_REMOVE(&p->kmessages, kmsg);
+				_port_statDequeue(p, kmsg, 0);
+				(void)proc_threadWakeup(&kmsg->threads);
+			}
+
+			err = -EINVAL;
+			break;
+		}
+
+		/* Don't block once we have something to return */
+		if (kmsg == NULL) {
+			break;
+		}
+
+		LIST_REMOVE(&p->kmessages, kmsg);
+		_port_statDequeue(p, kmsg, 1);
+		kmsg->state = msg_received;
+		hal_spinlockClear(&p->spinlock, &sc);
+
+		err = msg_deliver(p, kmsg, &msgs[cnt], &rids[cnt]);
+		if (err == EOK) {
+			cnt++;
+		}
+
+		hal_spinlockSet(&p->spinlock, &sc);
+	}
+
+	hal_spinlockClear(&p->spinlock, &sc);
+	port_put(p, 0);
+
+	return (cnt != 0U) ? (int)cnt : err;
+}
+
+
+int proc_recv(u32 port, msg_t *msg, msg_rid_t *rid)
+{
+	int err = proc_recvBatch(port, msg, rid, 1);
+
+	return (err < 0) ? err : EOK;
+}
+
+
+int proc_recvSet(int set, msg_t *msg, msg_rid_t *rid, u32 *port)
+{
+	portset_t *s;
+	port_t *p;
+	kmsg_t *kmsg;
+	int err;
+
+	s = portset_get(set);
+	if (s == NULL) {
+		return -EINVAL;
+	}
+
+	err = portset_wait(s, &p, &kmsg);
+	portset_put(s);
+
+	if (err < 0) {
+		return err;
+	}
+
+	*port = (u32)p->linkage.id;
+	err = msg_deliver(p, kmsg, msg, rid);
+	port_put(p, 0);
+
+	return err;
+}
+
+
+static int msg_respond(port_t *p, msg_t *msg, msg_rid_t rid)
+{
+	kmsg_t *kmsg;
+	spinlock_ctx_t sc;
+
 	kmsg = proc_portRidGet(p, rid);
 	if (kmsg == NULL) {
 		return -ENOENT;
@@ -579,26 +1713,98 @@ int proc_respond(u32 port, msg_t *msg, msg_rid_t rid)
 		hal_memcpy(kmsg->o.evaddr, kmsg->o.w + kmsg->o.boffs + kmsg->msg.o.size - kmsg->o.eoffs, (size_t)kmsg->o.eoffs);
 	}
 
+	if (kmsg->o.slot != NULL) {
+		hal_memcpy(kmsg->o.bounce->data, kmsg->o.slot, kmsg->msg.o.size);
+	}
+
 	msg_release(kmsg);
 
 	hal_memcpy(kmsg->msg.o.raw, msg->o.raw, sizeof(msg->o.raw));
 	kmsg->msg.o.err = msg->o.err;
 
 	hal_spinlockSet(&p->spinlock, &sc);
+	_port_statRespond(p, kmsg);
 	kmsg->state = msg_responded;
 	kmsg->src = proc_current()->process;
 	(void)proc_threadWakeup(&kmsg->threads);
 	hal_spinlockClear(&p->spinlock, &sc);
-	(void)hal_cpuReschedule(NULL, NULL);
+
+	return EOK;
+}
+
+
+int proc_respondBatch(u32 port, msg_t *msgs, const msg_rid_t *rids, size_t n)
+{
+	port_t *p;
+	size_t i;
+	int err = EOK;
+
+	if (n == 0U) {
+		return -EINVAL;
+	}
+
+	p = proc_portGet(port);
+	if (p == NULL) {
+		return -EINVAL;
+	}
+
+	for (i = 0; i < n; i++) {
+		err = msg_respond(p, &msgs[i], rids[i]);
+		if (err < 0) {
+			break;
+		}
+	}
+
+	/* Let woken up senders run once for the whole batch */
+	if (i != 0U) {
+		(void)hal_cpuReschedule(NULL, NULL);
+	}
 
 	port_put(p, 0);
 
-	return EOK;
+	return (i != 0U) ? (int)i : err;
+}
+
+
+int proc_respond(u32 port, msg_t *msg, msg_rid_t rid)
+{
+	int err = proc_respondBatch(port, msg, &rid, 1);
+
+	return (err < 0) ? err : EOK;
 }
 
 
 void _msg_init(vm_map_t *kmap, vm_object_t *kernel)
 {
+	msg_bpool_t *pool;
+	msg_bounce_t *b;
+	unsigned int i, j;
+
 	msg_common.kmap = kmap;
 	msg_common.kernel = kernel;
+	msg_common.bthreshold = MSG_BOUNCE_SIZE;
+
+	/* Without bounce buffers all payloads are mapped */
+	msg_common.bpools = vm_kmalloc(sizeof(msg_bpool_t) * hal_cpuGetCount());
+	if (msg_common.bpools != NULL) {
+		for (i = 0; i < hal_cpuGetCount(); i++) {
+			pool = &msg_common.bpools[i];
+			hal_spinlockCreate(&pool->spinlock, "msg.bounce");
+			pool->free = NULL;
+			pool->count = 0;
+
+			b = vm_kmalloc(sizeof(msg_bounce_t) * MSG_BOUNCE_COUNT);
+			for (j = 0; (b != NULL) && (j < MSG_BOUNCE_COUNT); j++) {
+				b[j].pool = pool;
+				b[j].next = pool->free;
+				pool->free = &b[j];
+			}
+		}
+	}
+	msg_common.caches = NULL;
+	msg_common.hits = 0;
+	msg_common.misses = 0;
+	msg_common.invalidations = 0;
+	msg_common.evictions = 0;
+	(void)proc_lockInit(&msg_common.mclock, &proc_lockAttrDefault, "msg.mapcache");
 }
@@ -23,6 +23,12 @@
 #include "threads.h"
 
 
+/* kmsg_t states */
+/* clang-format off */
+enum { msg_rejected = -1, msg_waiting = 0, msg_received, msg_responded };
+/* clang-format on */
+
+
 typedef struct _kmsg_t {
 #ifndef NOMMU
 	msg_t msg;
@@ -33,11 +39,11 @@ typedef struct _kmsg_t {
 	struct _kmsg_t *next;
 	struct _kmsg_t *prev;
 
-	idnode_t idlinkage;
-
 	thread_t *threads;
 	process_t *src;
 	volatile int state;
+	time_t stamp; /* Time of queueing, then of receiving */
+	time_t qtime; /* Time spent in the queue, undone on reject */
 
 #ifndef NOMMU
 	struct _kmsg_layout_t {
@@ -49,6 +55,23 @@ typedef struct _kmsg_t {
 		void *evaddr;
 		size_t eoffs;
 		page_t *ep;
+
+		struct _msg_mapcache_t *cached;
+		vm_map_t *csrc; /* Source referenced while cacheable window is set up */
+		unsigned int cgen;
+
+		struct _msg_bounce_t *bounce;
+		void *slot;
+
+		const msg_iov_t *iov; /* Segments mapped as one window */
+		size_t niov;
+
+		/* Source range kept from reclaim while mapped */
+		struct _kmsg_layout_t *pnext;
+		struct _kmsg_layout_t *pprev;
+		vm_map_t *pmap;
+		ptr_t pstart;
+		ptr_t pend;
 	} i, o;
 #else
 	void *imapped;
@@ -65,12 +88,51 @@ typedef struct _kmsg_t {
 int proc_send(u32 port, msg_t *msg);
 
 
+/* Sends msg with payloads given by segments (replacing i.data/o.data if ni/no != 0).
+ * Page aligned segments are mapped into receiver as one window, others are gathered/scattered by copy */
+int proc_sendv(u32 port, msg_t *msg, const msg_iov_t *iiov, size_t ni, const msg_iov_t *oiov, size_t no);
+
+
 int proc_recv(u32 port, msg_t *msg, msg_rid_t *rid);
 
 
 int proc_respond(u32 port, msg_t *msg, msg_rid_t rid);
 
 
+/* Receives up to n messages, blocks only if none is pending. Returns number of received messages */
+int proc_recvBatch(u32 port, msg_t *msgs, msg_rid_t *rids, size_t n);
+
+
+/* Receives message from any port of the set, returns its source port for respond */
+int proc_recvSet(int set, msg_t *msg, msg_rid_t *rid, u32 *port);
+
+
+/* Responds to n messages, stops on first invalid rid. Returns number of responded messages */
+int proc_respondBatch(u32 port, msg_t *msgs, const msg_rid_t *rids, size_t n);
+
+
+/* Sets payload size up to which data is copied instead of mapped, returns previous one */
+size_t proc_msgBounce(size_t threshold);
+
+
+/* Returns message mapping cache statistics */
+void proc_msgInfo(msginfo_t *info);
+
+
+#ifndef NOMMU
+/* Drops cached message windows overlapping the range of the map, called with the map locked */
+void msg_mapInvalidate(vm_map_t *map, void *vaddr, size_t size);
+
+
+/* Checks if source page of the map is mapped for a message */
+int msg_mapBusy(vm_map_t *map, void *vaddr);
+
+
+/* Drops cached message windows of the map being destroyed */
+void msg_mapDestroy(vm_map_t *map);
+#endif
+
+
 void _msg_init(vm_map_t *kmap, vm_object_t *kernel);
 
 
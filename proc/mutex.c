@@ -20,6 +20,11 @@
 #include "resource.h"
 
 
+static struct {
+	vm_kmemcache_t *cache;
+} mutex_common;
+
+
 mutex_t *mutex_get(int h)
 {
 	thread_t *t = proc_current();
@@ -43,7 +48,7 @@ void mutex_put(mutex_t *mutex)
 			t->process->path, process_getPid(t->process), proc_getTid(t));
 	if (rem == 0) {
 		(void)proc_lockDone(&mutex->lock);
-		vm_kfree(mutex);
+		vm_kmemCacheFree(mutex_common.cache, mutex);
 	}
 }
 
@@ -58,7 +63,7 @@ int proc_mutexCreate(const struct lockAttr *attr)
 		return -EINVAL;
 	}
 
-	mutex = vm_kmalloc(sizeof(*mutex));
+	mutex = vm_kmemCacheAlloc(mutex_common.cache);
 	if (mutex == NULL) {
 		return -ENOMEM;
 	}
@@ -68,7 +73,7 @@ int proc_mutexCreate(const struct lockAttr *attr)
 
 	id = resource_alloc(p, &mutex->resource);
 	if (id < 0) {
-		vm_kfree(mutex);
+		vm_kmemCacheFree(mutex_common.cache, mutex);
 		return -ENOMEM;
 	}
 
@@ -132,3 +137,9 @@ int proc_mutexUnlock(int h)
 
 	return err;
 }
+
+
+void _mutex_init(void)
+{
+	mutex_common.cache = vm_kmemCacheCreate("user.mutex", sizeof(mutex_t), 0, NULL);
+}
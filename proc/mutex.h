@@ -44,4 +44,7 @@ int proc_mutexUnlock(int h);
 int proc_mutexCreate(const struct lockAttr *attr);
 
 
+void _mutex_init(void);
+
+
 #endif
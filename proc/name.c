@@ -20,6 +20,12 @@
 
 #define HASH_LEN 5 /* Number of entries in dcache = 2 ^ HASH_LEN */
 
+#define NCACHE_MIN     (0x1U << HASH_LEN) /* Initial number of lookup cache buckets */
+#define NCACHE_MAX     1024U              /* Maximum number of lookup cache buckets */
+#define NCACHE_ENTRIES 1024U              /* Maximum number of cached lookups */
+#define NCACHE_NEG_TTL 200000U            /* Lifetime of negative entries (us) */
+#define NAME_LEGACY    8U                 /* Number of remembered servers without mtLookupOpen */
+
 
 typedef struct _dcache_entry_t {
 	struct _dcache_entry_t *next;
@@ -28,12 +34,44 @@ typedef struct _dcache_entry_t {
 } dcache_entry_t;
 
 
+/* Result of resolving path segment name by server dir (negative if err != 0).
+ * Entries are dropped when the server changes its namespace with a client message or its port
+ * is destroyed. Server can create a name on its own (e.g. a device appearing), so negative
+ * entries also expire after NCACHE_NEG_TTL */
+typedef struct _ncache_entry_t {
+	struct _ncache_entry_t *next;
+	struct _ncache_entry_t *lnext, *lprev;
+	unsigned int hash;
+	oid_t dir;
+	oid_t fil;
+	oid_t dev;
+	int err;
+	time_t expires;
+	size_t len;
+	char name[];
+} ncache_entry_t;
+
+
 static struct {
 	int rootRegistered;
 	oid_t rootOid;
 
 	dcache_entry_t *dcache[0x1U << HASH_LEN];
 
+	struct {
+		ncache_entry_t **buckets;
+		ncache_entry_t *lru;
+		unsigned int size;
+		unsigned int entries;
+		unsigned int gen;
+
+		unsigned int hits, misses;
+		unsigned int invalidations, evictions;
+	} ncache;
+
+	u32 legacy[NAME_LEGACY];
+	unsigned int nlegacy;
+
 	lock_t lock;
 } name_common;
 
@@ -71,11 +109,366 @@ static dcache_entry_t *_dcache_entryLookup(unsigned int hash, const char *name)
 }
 
 
+static unsigned int ncache_hash(const oid_t *dir, const char *name, size_t len)
+{
+	unsigned int hash = (unsigned int)dir->port * 31U + (unsigned int)dir->id + (unsigned int)((u64)dir->id >> 32) * 17U;
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		hash = hash * 31U + (unsigned char)name[i];
+	}
+
+	return hash;
+}
+
+
+static ncache_entry_t *_ncache_find(const oid_t *dir, const char *name, size_t len)
+{
+	unsigned int hash = ncache_hash(dir, name, len);
+	ncache_entry_t *e = name_common.ncache.buckets[hash & (name_common.ncache.size - 1U)];
+
+	while (e != NULL) {
+		if ((e->hash == hash) && (e->len == len) && (e->dir.port == dir->port) && (e->dir.id == dir->id) &&
+				(hal_strncmp(e->name, name, len) == 0)) {
+			break;
+		}
+		e = e->next;
+	}
+
+	return e;
+}
+
+
+static void _ncache_remove(ncache_entry_t *e)
+{
+	ncache_entry_t **pe = &name_common.ncache.buckets[e->hash & (name_common.ncache.size - 1U)];
+
+	while (*pe != e) {
+		pe = &(*pe)->next;
+	}
+	*pe = e->next;
+
+	LIST_REMOVE_EX(&name_common.ncache.lru, e, lnext, lprev);
+	name_common.ncache.entries--;
+}
+
+
+static void _ncache_rehash(ncache_entry_t **buckets, unsigned int size)
+{
+	ncache_entry_t *e = name_common.ncache.lru;
+	unsigned int b;
+
+	hal_memset(buckets, 0, size * sizeof(*buckets));
+
+	if (e != NULL) {
+		do {
+			b = e->hash & (size - 1U);
+			e->next = buckets[b];
+			buckets[b] = e;
+			e = e->lnext;
+		} while (e != name_common.ncache.lru);
+	}
+
+	name_common.ncache.buckets = buckets;
+	name_common.ncache.size = size;
+}
+
+
+/* Resolves longest cached prefix of path, returns its length, 0 on miss or cached error (negative) */
+static int ncache_lookup(const oid_t *dir, const char *path, oid_t *fil, oid_t *dev, unsigned int *gen)
+{
+	ncache_entry_t *e = NULL, *dead = NULL;
+	size_t len = hal_strlen(path), k = len;
+	time_t now = hal_timerGetUs();
+	int ret = 0;
+
+	(void)proc_lockSet(&name_common.lock);
+
+	*gen = name_common.ncache.gen;
+
+	if (name_common.ncache.buckets != NULL) {
+		while (k > 0U) {
+			if ((k == len) || (path[k] == '/')) {
+				e = _ncache_find(dir, path, k);
+				if ((e != NULL) && (e->err != 0) && (now >= e->expires)) {
+					/* Name could have been created by the server meanwhile */
+					_ncache_remove(e);
+					e->next = dead;
+					dead = e;
+					name_common.ncache.invalidations++;
+					e = NULL;
+				}
+				if (e != NULL) {
+					break;
+				}
+			}
+			k--;
+		}
+	}
+
+	if (e != NULL) {
+		/* Move to the most recently used end */
+		LIST_REMOVE_EX(&name_common.ncache.lru, e, lnext, lprev);
+		LIST_ADD_EX(&name_common.ncache.lru, e, lnext, lprev);
+
+		if (e->err != 0) {
+			ret = e->err;
+		}
+		else {
+			*fil = e->fil;
+			*dev = e->dev;
+			ret = (int)k;
+		}
+		name_common.ncache.hits++;
+	}
+	else {
+		name_common.ncache.misses++;
+	}
+
+	(void)proc_lockClear(&name_common.lock);
+
+	while (dead != NULL) {
+		e = dead;
+		dead = e->next;
+		vm_kfree(e);
+	}
+
+	return ret;
+}
+
+
+/* Caches server answer to lookup of path, err is consumed length or error */
+static void ncache_insert(const oid_t *dir, const char *path, int err, const oid_t *fil, const oid_t *dev, unsigned int gen)
+{
+	ncache_entry_t *e, *old;
+	ncache_entry_t **buckets = NULL, **obuckets = NULL;
+	size_t len = hal_strlen(path);
+	unsigned int size;
+
+	if (err == -ENOENT) {
+		/* Negative entry covers whole remaining path */
+	}
+	else if ((err > 0) && ((size_t)err <= len)) {
+		len = (size_t)err;
+	}
+	else {
+		return;
+	}
+
+	e = vm_kmalloc(sizeof(ncache_entry_t) + len + 1U);
+	if (e == NULL) {
+		return;
+	}
+
+	e->hash = ncache_hash(dir, path, len);
+	e->dir = *dir;
+	e->err = (err < 0) ? err : 0;
+	e->expires = hal_timerGetUs() + NCACHE_NEG_TTL;
+	if (err > 0) {
+		e->fil = *fil;
+		e->dev = *dev;
+	}
+	e->len = len;
+	hal_memcpy(e->name, path, len);
+	e->name[len] = '\0';
+
+	/* Grow table to keep chains short, allocation is done without the lock */
+	size = name_common.ncache.size;
+	if (size == 0U) {
+		size = NCACHE_MIN;
+		buckets = vm_kmalloc(size * sizeof(*buckets));
+	}
+	else if ((size < NCACHE_MAX) && (name_common.ncache.entries >= 2U * size)) {
+		size *= 2U;
+		buckets = vm_kmalloc(size * sizeof(*buckets));
+	}
+	else {
+		/* No action required */
+	}
+
+	(void)proc_lockSet(&name_common.lock);
+
+	if ((buckets != NULL) && (size > name_common.ncache.size)) {
+		obuckets = name_common.ncache.buckets;
+		_ncache_rehash(buckets, size);
+		buckets = NULL;
+	}
+
+	/* Namespace changed while the server was being queried */
+	if ((name_common.ncache.buckets == NULL) || (gen != name_common.ncache.gen) || (_ncache_find(dir, e->name, len) != NULL)) {
+		(void)proc_lockClear(&name_common.lock);
+		vm_kfree(e);
+		if (obuckets != NULL) {
+			vm_kfree(obuckets);
+		}
+		if (buckets != NULL) {
+			vm_kfree(buckets);
+		}
+		return;
+	}
+
+	old = NULL;
+	if (name_common.ncache.entries >= NCACHE_ENTRIES) {
+		old = name_common.ncache.lru;
+		_ncache_remove(old);
+		name_common.ncache.evictions++;
+	}
+
+	e->next = name_common.ncache.buckets[e->hash & (name_common.ncache.size - 1U)];
+	name_common.ncache.buckets[e->hash & (name_common.ncache.size - 1U)] = e;
+	LIST_ADD_EX(&name_common.ncache.lru, e, lnext, lprev);
+	name_common.ncache.entries++;
+
+	(void)proc_lockClear(&name_common.lock);
+
+	if (old != NULL) {
+		vm_kfree(old);
+	}
+	if (obuckets != NULL) {
+		vm_kfree(obuckets);
+	}
+	if (buckets != NULL) {
+		vm_kfree(buckets);
+	}
+}
+
+
+static int name_legacy(u32 port)
+{
+	unsigned int i;
+	int ret = 0;
+
+	(void)proc_lockSet(&name_common.lock);
+
+	for (i = 0; i < name_common.nlegacy; i++) {
+		if (name_common.legacy[i] == port) {
+			ret = 1;
+			break;
+		}
+	}
+
+	(void)proc_lockClear(&name_common.lock);
+
+	return ret;
+}
+
+
+/* Remembers server not supporting mtLookupOpen */
+static void name_legacyAdd(u32 port)
+{
+	(void)proc_lockSet(&name_common.lock);
+
+	if (name_common.nlegacy < NAME_LEGACY) {
+		name_common.legacy[name_common.nlegacy++] = port;
+	}
+	else {
+		name_common.legacy[port % NAME_LEGACY] = port;
+	}
+
+	(void)proc_lockClear(&name_common.lock);
+}
+
+
+static void ncache_invalidate(u32 port)
+{
+	ncache_entry_t *e, *n, *dead = NULL;
+	unsigned int i;
+
+	(void)proc_lockSet(&name_common.lock);
+
+	name_common.ncache.gen++;
+
+	e = name_common.ncache.lru;
+	for (i = name_common.ncache.entries; i > 0U; i--) {
+		n = e->lnext;
+		if ((e->dir.port == port) || ((e->err == 0) && ((e->fil.port == port) || (e->dev.port == port)))) {
+			_ncache_remove(e);
+			e->next = dead;
+			dead = e;
+			name_common.ncache.invalidations++;
+		}
+		e = n;
+	}
+
+	(void)proc_lockClear(&name_common.lock);
+
+	while (dead != NULL) {
+		e = dead;
+		dead = e->next;
+		vm_kfree(e);
+	}
+}
+
+
+void proc_nameInvalidate(u32 port)
+{
+	unsigned int i;
+
+	ncache_invalidate(port);
+
+	/* Port id can be reused by a different server */
+	(void)proc_lockSet(&name_common.lock);
+
+	for (i = 0; i < name_common.nlegacy; i++) {
+		if (name_common.legacy[i] == port) {
+			name_common.legacy[i] = name_common.legacy[--name_common.nlegacy];
+			break;
+		}
+	}
+
+	(void)proc_lockClear(&name_common.lock);
+}
+
+
+void proc_nameUpdate(u32 port, const msg_t *msg)
+{
+	switch (msg->type) {
+		case mtCreate:
+		case mtDestroy:
+		case mtLink:
+		case mtUnlink:
+		case mtSetAttr:
+			ncache_invalidate(port);
+			break;
+
+		case mtLookupOpen:
+			if (msg->o.lookupopen.opened == 2) {
+				ncache_invalidate(port);
+			}
+			break;
+
+		default:
+			/* Namespace not changed */
+			break;
+	}
+}
+
+
+void proc_nameInfo(msginfo_t *info)
+{
+	(void)proc_lockSet(&name_common.lock);
+
+	info->namecache.size = name_common.ncache.size;
+	info->namecache.entries = name_common.ncache.entries;
+	info->namecache.hits = name_common.ncache.hits;
+	info->namecache.misses = name_common.ncache.misses;
+	info->namecache.invalidations = name_common.ncache.invalidations;
+	info->namecache.evictions = name_common.ncache.evictions;
+
+	(void)proc_lockClear(&name_common.lock);
+}
+
+
 int proc_portRegister(u32 port, const char *name, oid_t *oid)
 {
 	dcache_entry_t *entry;
 	unsigned int hash;
 
+	/* Handles are process local, only global port ids can be registered */
+	if ((port & PORT_HANDLE) != 0U) {
+		return -EINVAL;
+	}
+
 	if (name[0] == '/' && name[1] == '\0') {
 		(void)proc_lockSet(&name_common.lock);
 
@@ -171,14 +564,16 @@ int proc_portUnregister(const char *name)
 }
 
 
-int proc_portLookup(const char *name, oid_t *file, oid_t *dev)
+/* Resolves name, req selects combined lookup and open of the final component */
+static int name_lookup(const char *name, oid_t *file, oid_t *dev, const msg_t *req, int *opened)
 {
-	int err;
+	int err, oerr = EOK;
 	dcache_entry_t *entry;
 	unsigned int hash;
 	msg_t *msg;
 	size_t len, i;
-	oid_t srv;
+	oid_t srv, rfil, rdev;
+	unsigned int gen;
 	char pstack[16], *pheap = NULL, *pptr;
 
 	if (name == NULL || (file == NULL && dev == NULL)) {
@@ -302,45 +697,111 @@ int proc_portLookup(const char *name, oid_t *file, oid_t *dev)
 	}
 
 	hal_memset(msg, 0, sizeof(msg_t));
-	msg->type = mtLookup;
+	hal_memset(&rfil, 0, sizeof(rfil));
+	hal_memset(&rdev, 0, sizeof(rdev));
+	if (req != NULL) {
+		hal_memcpy(&msg->i.lookupopen, &req->i.lookupopen, sizeof(msg->i.lookupopen));
+	}
 
-	/* Query servers */
+	/* Query servers, resolve already known path segments from cache */
 	do {
-		hal_memcpy(&msg->oid, &srv, sizeof(srv));
-		msg->i.size = len - i;
-		hal_memcpy(pptr, name + i + 1, len - i);
-		msg->i.data = pptr;
+		err = ncache_lookup(&srv, name + i + 1, &rfil, &rdev, &gen);
+		if (err == 0) {
+			hal_memcpy(&msg->oid, &srv, sizeof(srv));
+			msg->type = ((req != NULL) && (name_legacy(srv.port) == 0)) ? mtLookupOpen : mtLookup;
+			msg->i.size = len - i;
+			hal_memcpy(pptr, name + i + 1, len - i);
+			msg->i.data = pptr;
+
+			err = proc_send(srv.port, msg);
+			if ((err == EOK) && (msg->type == mtLookupOpen) && ((msg->o.err == -ENOSYS) || (msg->o.err == -EINVAL))) {
+				/* Server doesn't support combined lookup, fall back to plain lookup */
+				if (msg->o.err == -ENOSYS) {
+					name_legacyAdd(srv.port);
+				}
+				msg->type = mtLookup;
+				err = proc_send(srv.port, msg);
+			}
 
-		err = proc_send(srv.port, msg);
-		if (err < 0) {
-			break;
+			if (err < 0) {
+				break;
+			}
+
+			err = msg->o.err;
+			if (msg->type == mtLookupOpen) {
+				rfil = msg->o.lookupopen.fil;
+				rdev = msg->o.lookupopen.dev;
+				if (err >= 0) {
+					oerr = msg->o.lookupopen.open;
+					*opened = msg->o.lookupopen.opened;
+				}
+			}
+			else {
+				rfil = msg->o.lookup.fil;
+				rdev = msg->o.lookup.dev;
+			}
+
+			/* Not inserted if the file was created, proc_send() invalidated the port */
+			ncache_insert(&srv, name + i + 1, err, &rfil, &rdev, gen);
 		}
 
-		srv = msg->o.lookup.dev;
-		err = msg->o.err;
+		srv = rdev;
 		if (err < 0) {
 			break;
 		}
 
 		i += (size_t)err + 1U;
-		if (i > len) {
+		if ((i > len) || ((opened != NULL) && (*opened != 0) && (i != len))) {
+			if ((opened != NULL) && (*opened != 0) && (oerr >= 0)) {
+				/* Path wasn't fully resolved, drop reference taken by the server open */
+				(void)proc_close(rdev, req->i.lookupopen.flags);
+			}
 			err = -EINVAL;
 			break;
 		}
 	} while (i != len);
 
 	if (file != NULL) {
-		*file = msg->o.lookup.fil;
+		*file = rfil;
 	}
 	if (dev != NULL) {
-		*dev = msg->o.lookup.dev;
+		*dev = rdev;
 	}
 
 	vm_kfree(msg);
 	if (pheap != NULL) {
 		vm_kfree(pheap);
 	}
-	return err < 0 ? err : EOK;
+
+	if (err < 0) {
+		return err;
+	}
+
+	return ((opened != NULL) && (*opened != 0)) ? oerr : EOK;
+}
+
+
+int proc_portLookup(const char *name, oid_t *file, oid_t *dev)
+{
+	return name_lookup(name, file, dev, NULL, NULL);
+}
+
+
+int proc_lookupOpen(const char *name, unsigned int flags, int type, unsigned int mode, oid_t *file, oid_t *dev, int *opened)
+{
+	msg_t req;
+
+	req.i.lookupopen.flags = flags;
+	req.i.lookupopen.type = type;
+	req.i.lookupopen.mode = mode;
+
+	*opened = 0;
+
+	if (file != NULL) {
+		file->id = 0;
+	}
+
+	return name_lookup(name, file, dev, &req, opened);
 }
 
 
@@ -614,5 +1075,7 @@ void _name_init(void)
 	(void)proc_lockInit(&name_common.lock, &proc_lockAttrDefault, "name.common");
 
 	hal_memset(name_common.dcache, 0, sizeof(name_common.dcache));
+	hal_memset(&name_common.ncache, 0, sizeof(name_common.ncache));
+	name_common.nlegacy = 0;
 	name_common.rootRegistered = 0;
 }
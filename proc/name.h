@@ -17,6 +17,8 @@
 #define _PH_PROC_NAME_H_
 
 #include "hal/hal.h"
+#include "include/msg.h"
+#include "include/sysinfo.h"
 
 
 int proc_portRegister(u32 port, const char *name, oid_t *oid);
@@ -31,6 +33,22 @@ int proc_portLookup(const char *name, oid_t *file, oid_t *dev);
 int proc_lookup(const char *name, oid_t *file, oid_t *dev);
 
 
+/* Resolves name and opens it with mtLookupOpen if the final component is served by the same port,
+ * type >= 0 creates a missing file. Returns open result with *opened set (2 if created) or EOK if only resolved */
+int proc_lookupOpen(const char *name, unsigned int flags, int type, unsigned int mode, oid_t *file, oid_t *dev, int *opened);
+
+
+/* Drops cached lookups involving port */
+void proc_nameInvalidate(u32 port);
+
+
+/* Invalidates lookups after successful namespace changing message */
+void proc_nameUpdate(u32 port, const msg_t *msg);
+
+
+void proc_nameInfo(msginfo_t *info);
+
+
 int proc_read(oid_t oid, off_t offs, void *buf, size_t sz, unsigned int mode);
 
 
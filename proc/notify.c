@@ -0,0 +1,156 @@
+/*
+ * Phoenix-RTOS
+ *
+ * Operating system kernel
+ *
+ * Notifications
+ *
+ * Copyright 2026 Phoenix Systems
+ *
+ * This file is part of Phoenix-RTOS.
+ *
+ * %LICENSE%
+ */
+
+#include "include/errno.h"
+#include "include/threads.h"
+#include "lib/assert.h"
+#include "lib/lib.h"
+#include "threads.h"
+#include "process.h"
+#include "notify.h"
+
+
+notify_t *notify_get(process_t *process, int h)
+{
+	resource_t *r = resource_get(process, h);
+
+	return ((r != NULL) && (r->type == rtNotify)) ? r->payload.notify : NULL;
+}
+
+
+void notify_put(notify_t *n)
+{
+	thread_t *t = proc_current();
+	int rem;
+
+	LIB_ASSERT(n != NULL, "process: %s, pid: %d, tid: %d, n == NULL",
+			t->process->path, process_getPid(t->process), proc_getTid(t));
+
+	rem = resource_put(t->process, &n->resource);
+	LIB_ASSERT(rem >= 0, "process: %s, pid: %d, tid: %d, refcnt below zero",
+			t->process->path, process_getPid(t->process), proc_getTid(t));
+	if (rem == 0) {
+		hal_spinlockDestroy(&n->spinlock);
+		vm_kfree(n);
+	}
+}
+
+
+void notify_signal(notify_t *n, unsigned int bits)
+{
+	spinlock_ctx_t sc;
+
+	hal_spinlockSet(&n->spinlock, &sc);
+	n->bits |= bits;
+	(void)proc_threadWakeup(&n->queue);
+	hal_spinlockClear(&n->spinlock, &sc);
+}
+
+
+int proc_notifyCreate(unsigned int flags)
+{
+	process_t *p = proc_current()->process;
+	notify_t *n;
+	int id;
+
+	n = vm_kmalloc(sizeof(*n));
+	if (n == NULL) {
+		return -ENOMEM;
+	}
+
+	n->resource.payload.notify = n;
+	n->resource.type = rtNotify;
+
+	id = resource_alloc(p, &n->resource);
+	if (id < 0) {
+		vm_kfree(n);
+		return -ENOMEM;
+	}
+
+	hal_spinlockCreate(&n->spinlock, "notify");
+	n->queue = NULL;
+	n->bits = 0;
+	n->flags = flags & PH_NOTIFY_SHARED;
+
+	(void)resource_put(p, &n->resource);
+
+	return id;
+}
+
+
+int proc_notifySignal(int pid, int h, unsigned int bits)
+{
+	process_t *process;
+	notify_t *n;
+	int owner;
+
+	process = proc_find(pid);
+	if (process == NULL) {
+		return -EINVAL;
+	}
+
+	owner = (process == proc_current()->process) ? 1 : 0;
+	n = notify_get(process, h);
+	(void)proc_put(process);
+
+	if (n == NULL) {
+		return -EINVAL;
+	}
+
+	if ((owner == 0) && ((n->flags & PH_NOTIFY_SHARED) == 0U)) {
+		notify_put(n);
+		return -EPERM;
+	}
+
+	notify_signal(n, bits);
+	notify_put(n);
+
+	return EOK;
+}
+
+
+int proc_notifyWait(int h, unsigned int *bits, time_t timeout)
+{
+	notify_t *n;
+	time_t abstime = 0;
+	spinlock_ctx_t sc;
+	int err = EOK;
+
+	n = notify_get(proc_current()->process, h);
+	if (n == NULL) {
+		return -EINVAL;
+	}
+
+	if (timeout != 0) {
+		proc_gettime(&abstime, NULL);
+		abstime += timeout;
+	}
+
+	hal_spinlockSet(&n->spinlock, &sc);
+	while ((n->bits == 0U) && (err == EOK)) {
+		err = proc_threadWaitInterruptible(&n->queue, &n->spinlock, abstime, &sc);
+	}
+
+	/* Bits could have arrived together with the timeout */
+	if (n->bits != 0U) {
+		*bits = n->bits;
+		n->bits = 0;
+		err = EOK;
+	}
+	hal_spinlockClear(&n->spinlock, &sc);
+
+	notify_put(n);
+
+	return err;
+}
@@ -0,0 +1,53 @@
+/*
+ * Phoenix-RTOS
+ *
+ * Operating system kernel
+ *
+ * Notifications
+ *
+ * Copyright 2026 Phoenix Systems
+ *
+ * This file is part of Phoenix-RTOS.
+ *
+ * %LICENSE%
+ */
+
+#ifndef _PH_PROC_NOTIFY_H_
+#define _PH_PROC_NOTIFY_H_
+
+#include "hal/hal.h"
+#include "threads.h"
+#include "resource.h"
+
+
+typedef struct _notify_t {
+	resource_t resource;
+	spinlock_t spinlock;
+	thread_t *queue;
+	unsigned int bits;
+	unsigned int flags;
+} notify_t;
+
+
+notify_t *notify_get(process_t *process, int h);
+
+
+void notify_put(notify_t *n);
+
+
+/* ORs bits into the notification word and wakes one waiter, safe in interrupt context */
+void notify_signal(notify_t *n, unsigned int bits);
+
+
+int proc_notifyCreate(unsigned int flags);
+
+
+/* Only the owner may signal unless the notification was created with PH_NOTIFY_SHARED */
+int proc_notifySignal(int pid, int h, unsigned int bits);
+
+
+/* Waits until any bit is set and consumes the whole word, timeout in us (0 - infinite) */
+int proc_notifyWait(int h, unsigned int *bits, time_t timeout);
+
+
+#endif
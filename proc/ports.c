@@ -14,49 +14,182 @@
  */
 
 #include "ports.h"
+#include "portset.h"
+#include "name.h"
+#include "notify.h"
 #include "lib/lib.h"
 
 
+#define PORT_HANDLES_MAX 1024U
+
+/* Rid = generation << PORT_RID_BITS | slot index */
+#define PORT_RID_BITS 16U
+#define PORT_RID_MIN  8U
+#define PORT_RID_MAX  (1U << PORT_RID_BITS)
+#define PORT_RID_GENS (1U << (31U - PORT_RID_BITS))
+
+
 static struct {
 	idtree_t tree;
 	lock_t port_lock;
+	vm_kmemcache_t *cache;
 } port_common;
 
 
+/* Doubles rid slots array, new slots are put on the free list */
+static int port_ridGrow(port_t *p)
+{
+	port_rid_t *slots, *old;
+	unsigned int i, n, nslots;
+	spinlock_ctx_t sc;
+
+	hal_spinlockSet(&p->spinlock, &sc);
+	nslots = p->nrids;
+	hal_spinlockClear(&p->spinlock, &sc);
+
+	if (nslots >= PORT_RID_MAX) {
+		return -ENOMEM;
+	}
+
+	n = (nslots == 0U) ? PORT_RID_MIN : 2U * nslots;
+	slots = vm_kmalloc(n * sizeof(port_rid_t));
+	if (slots == NULL) {
+		return -ENOMEM;
+	}
+
+	hal_spinlockSet(&p->spinlock, &sc);
+
+	/* Somebody else grew the array in the meantime */
+	if (p->nrids != nslots) {
+		hal_spinlockClear(&p->spinlock, &sc);
+		vm_kfree(slots);
+		return EOK;
+	}
+
+	old = p->rids;
+	if (old != NULL) {
+		hal_memcpy(slots, old, nslots * sizeof(port_rid_t));
+	}
+
+	for (i = nslots; i < n; i++) {
+		slots[i].kmsg = NULL;
+		slots[i].gen = 0;
+		slots[i].next = (i + 1U < n) ? (int)i + 1 : p->ridfree;
+	}
+
+	p->ridfree = (int)nslots;
+	p->rids = slots;
+	p->nrids = n;
+
+	hal_spinlockClear(&p->spinlock, &sc);
+
+	if (old != NULL) {
+		vm_kfree(old);
+	}
+
+	return EOK;
+}
+
+
 msg_rid_t proc_portRidAlloc(port_t *p, kmsg_t *kmsg)
 {
-	msg_rid_t ret;
+	port_rid_t *slot;
+	spinlock_ctx_t sc;
+	msg_rid_t rid;
+	int idx;
 
-	(void)proc_lockSet(&p->lock);
-	ret = lib_idtreeAlloc(&p->rid, &kmsg->idlinkage, 0);
-	(void)proc_lockClear(&p->lock);
+	for (;;) {
+		/* Pop is a few stores under the port spinlock, which is already held by the receive path.
+		 * Slot array can be replaced by port_ridGrow(), so a lock-free pop would need its own reclamation */
+		hal_spinlockSet(&p->spinlock, &sc);
+
+		idx = p->ridfree;
+		if (idx >= 0) {
+			slot = &p->rids[idx];
+			p->ridfree = slot->next;
+			slot->kmsg = kmsg;
+			rid = (msg_rid_t)((slot->gen << PORT_RID_BITS) | (unsigned int)idx);
+			hal_spinlockClear(&p->spinlock, &sc);
+
+			return rid;
+		}
+
+		hal_spinlockClear(&p->spinlock, &sc);
 
-	return ret;
+		if (port_ridGrow(p) < 0) {
+			return -ENOMEM;
+		}
+	}
 }
 
 
 kmsg_t *proc_portRidGet(port_t *p, msg_rid_t rid)
 {
-	kmsg_t *kmsg;
+	kmsg_t *kmsg = NULL;
+	port_rid_t *slot;
+	spinlock_ctx_t sc;
+	unsigned int idx = (unsigned int)rid & (PORT_RID_MAX - 1U);
 
-	(void)proc_lockSet(&p->lock);
+	if (rid < 0) {
+		return NULL;
+	}
+
+	hal_spinlockSet(&p->spinlock, &sc);
 
-	kmsg = lib_idtreeof(kmsg_t, idlinkage, lib_idtreeFind(&p->rid, rid));
-	if (kmsg != NULL) {
-		lib_idtreeRemove(&p->rid, &kmsg->idlinkage);
+	/* Stale or repeated rid has different generation or points to a free slot */
+	if (idx < p->nrids) {
+		slot = &p->rids[idx];
+		if ((slot->kmsg != NULL) && (slot->gen == ((unsigned int)rid >> PORT_RID_BITS))) {
+			kmsg = slot->kmsg;
+			slot->kmsg = NULL;
+			slot->gen = (slot->gen + 1U) & (PORT_RID_GENS - 1U);
+			slot->next = p->ridfree;
+			p->ridfree = (int)idx;
+		}
 	}
 
-	(void)proc_lockClear(&p->lock);
+	hal_spinlockClear(&p->spinlock, &sc);
 
 	return kmsg;
 }
 
 
+static port_t *port_handleGet(u32 h)
+{
+	thread_t *curr = proc_current();
+	process_t *proc = (curr == NULL) ? NULL : curr->process;
+	port_t *port = NULL;
+	spinlock_ctx_t sc, psc;
+
+	if (proc == NULL) {
+		return NULL;
+	}
+
+	/* Handle holds a reference, so the port can't disappear under us */
+	hal_spinlockSet(&proc->phspinlock, &sc);
+	if (h < proc->phsz) {
+		port = proc->phandles[h];
+		if (port != NULL) {
+			hal_spinlockSet(&port->spinlock, &psc);
+			port->refs++;
+			hal_spinlockClear(&port->spinlock, &psc);
+		}
+	}
+	hal_spinlockClear(&proc->phspinlock, &sc);
+
+	return port;
+}
+
+
 port_t *proc_portGet(u32 id)
 {
 	port_t *port;
 	spinlock_ctx_t sc;
 
+	if ((id & PORT_HANDLE) != 0U) {
+		return port_handleGet(id & ~PORT_HANDLE);
+	}
+
 	if (id > MAX_ID) {
 		return NULL;
 	}
@@ -78,6 +211,11 @@ void port_put(port_t *p, int destroy)
 {
 	spinlock_ctx_t sc;
 
+	if (destroy != 0) {
+		portset_detach(p);
+		proc_nameInvalidate((u32)p->linkage.id);
+	}
+
 	(void)proc_lockSet(&port_common.port_lock);
 	hal_spinlockSet(&p->spinlock, &sc);
 	p->refs--;
@@ -107,9 +245,178 @@ void port_put(port_t *p, int destroy)
 	}
 	(void)proc_lockClear(&p->owner->lock);
 
-	(void)proc_lockDone(&p->lock);
+	if (p->rids != NULL) {
+		vm_kfree(p->rids);
+	}
+	if (p->pnotify != NULL) {
+		notify_put(p->pnotify);
+	}
 	hal_spinlockDestroy(&p->spinlock);
-	vm_kfree(p);
+	vm_kmemCacheFree(port_common.cache, p);
+}
+
+
+void _port_statQueue(port_t *p, kmsg_t *kmsg)
+{
+	kmsg->stamp = hal_timerGetUs();
+
+	p->stats.depth++;
+	if (p->stats.depth > p->stats.maxdepth) {
+		p->stats.maxdepth = p->stats.depth;
+	}
+}
+
+
+void _port_statDequeue(port_t *p, kmsg_t *kmsg, int received)
+{
+	time_t now;
+
+	p->stats.depth--;
+
+	if (received != 0) {
+		now = hal_timerGetUs();
+		kmsg->qtime = now - kmsg->stamp;
+		kmsg->stamp = now;
+		p->stats.received++;
+		p->stats.qtime += kmsg->qtime;
+	}
+}
+
+
+void _port_statRespond(port_t *p, kmsg_t *kmsg)
+{
+	p->stats.responded++;
+	p->stats.stime += hal_timerGetUs() - kmsg->stamp;
+}
+
+
+void _port_statReject(port_t *p, kmsg_t *kmsg)
+{
+	p->stats.received--;
+	p->stats.qtime -= kmsg->qtime;
+}
+
+
+int proc_portsList(int n, portinfo_t *info)
+{
+	int i = 0;
+	port_t *p;
+	portinfo_t pi;
+	spinlock_ctx_t sc;
+
+	(void)proc_lockSet(&port_common.port_lock);
+
+	p = lib_idtreeof(port_t, linkage, lib_idtreeMinimum(port_common.tree.root));
+
+	while ((i < n) && (p != NULL)) {
+		pi.id = (unsigned int)p->linkage.id;
+		pi.pid = (p->owner != NULL) ? process_getPid(p->owner) : 0;
+
+		hal_spinlockSet(&p->spinlock, &sc);
+		pi.received = p->stats.received;
+		pi.responded = p->stats.responded;
+		pi.depth = p->stats.depth;
+		pi.maxdepth = p->stats.maxdepth;
+		pi.qtime = p->stats.qtime;
+		pi.stime = p->stats.stime;
+		hal_spinlockClear(&p->spinlock, &sc);
+
+		/* User buffer may fault, it's written without the port spinlock */
+		hal_memcpy(&info[i], &pi, sizeof(pi));
+
+		i++;
+		p = lib_idtreeof(port_t, linkage, lib_idtreeNext(&p->linkage.linkage));
+	}
+
+	(void)proc_lockClear(&port_common.port_lock);
+
+	return i;
+}
+
+
+void _port_pressureCheck(port_t *p)
+{
+	unsigned int idle = p->idle;
+
+	/* Set counter is read without its lock, it's only a hint */
+	if (p->set != NULL) {
+		idle += p->set->idle;
+	}
+
+	if ((p->pnotify != NULL) && (idle == 0U) && (p->stats.depth > p->pthreshold)) {
+		notify_signal(p->pnotify, p->pbits);
+	}
+}
+
+
+int proc_portPressure(u32 port, port_pressure_t *pressure)
+{
+	port_t *p;
+	port_pressure_t pp;
+	spinlock_ctx_t sc;
+
+	p = proc_portGet(port);
+	if (p == NULL) {
+		return -EINVAL;
+	}
+
+	hal_spinlockSet(&p->spinlock, &sc);
+	pp.queued = p->stats.depth;
+	pp.idle = p->idle;
+	if (p->set != NULL) {
+		pp.idle += p->set->idle;
+	}
+	pp.inflight = p->stats.received - p->stats.responded;
+	hal_spinlockClear(&p->spinlock, &sc);
+
+	port_put(p, 0);
+
+	hal_memcpy(pressure, &pp, sizeof(pp));
+
+	return EOK;
+}
+
+
+int proc_portPressureNotify(u32 port, int h, unsigned int bits, unsigned int threshold)
+{
+	process_t *proc = proc_current()->process;
+	port_t *p;
+	notify_t *n = NULL, *old;
+	spinlock_ctx_t sc;
+
+	p = proc_portGet(port);
+	if (p == NULL) {
+		return -EINVAL;
+	}
+
+	/* Only the server may watch its port */
+	if ((proc == NULL) || (p->owner != proc)) {
+		port_put(p, 0);
+		return -EPERM;
+	}
+
+	if (h >= 0) {
+		n = notify_get(proc, h);
+		if (n == NULL) {
+			port_put(p, 0);
+			return -EINVAL;
+		}
+	}
+
+	hal_spinlockSet(&p->spinlock, &sc);
+	old = p->pnotify;
+	p->pnotify = n;
+	p->pbits = bits;
+	p->pthreshold = threshold;
+	hal_spinlockClear(&p->spinlock, &sc);
+
+	if (old != NULL) {
+		notify_put(old);
+	}
+
+	port_put(p, 0);
+
+	return EOK;
 }
 
 
@@ -119,7 +426,7 @@ int proc_portCreate(u32 *id)
 	thread_t *curr = proc_current();
 	process_t *proc = (curr == NULL) ? NULL : curr->process;
 
-	port = vm_kmalloc(sizeof(port_t));
+	port = vm_kmemCacheAlloc(port_common.cache);
 	if (port == NULL) {
 		return -ENOMEM;
 	}
@@ -127,20 +434,30 @@ int proc_portCreate(u32 *id)
 	(void)proc_lockSet(&port_common.port_lock);
 	if (lib_idtreeAlloc(&port_common.tree, &port->linkage, 0) < 0) {
 		(void)proc_lockClear(&port_common.port_lock);
-		vm_kfree(port);
+		vm_kmemCacheFree(port_common.cache, port);
 		return -ENOMEM;
 	}
 
 	port->kmessages = NULL;
 	hal_spinlockCreate(&port->spinlock, "port.spinlock");
 
-	lib_idtreeInit(&port->rid);
-	(void)proc_lockInit(&port->lock, &proc_lockAttrDefault, "port.rid");
+	port->rids = NULL;
+	port->nrids = 0;
+	port->ridfree = -1;
 
 	port->threads = NULL;
 	port->current = NULL;
+	port->set = NULL;
+	port->snext = NULL;
+	port->sprev = NULL;
+	port->spriority = 0;
 	port->refs = 1;
 	port->closed = 0;
+	port->idle = 0;
+	port->pnotify = NULL;
+	port->pbits = 0;
+	port->pthreshold = 0;
+	hal_memset(&port->stats, 0, sizeof(port->stats));
 
 	*id = (u32)port->linkage.id;
 	port->owner = proc;
@@ -194,8 +511,130 @@ void proc_portsDestroy(process_t *proc)
 }
 
 
+int proc_portHandleOpen(u32 port, u32 *handle)
+{
+	thread_t *curr = proc_current();
+	process_t *proc = (curr == NULL) ? NULL : curr->process;
+	port_t *p, **t = NULL, **old = NULL;
+	unsigned int i, sz = 0;
+	spinlock_ctx_t sc;
+
+	if (proc == NULL) {
+		return -EINVAL;
+	}
+
+	/* Reference is kept by the handle */
+	p = proc_portGet(port);
+	if (p == NULL) {
+		return -EINVAL;
+	}
+
+	/* Process lock serializes table growth */
+	(void)proc_lockSet(&proc->lock);
+
+	for (i = 0; i < proc->phsz; i++) {
+		if (proc->phandles[i] == NULL) {
+			break;
+		}
+	}
+
+	if (i == proc->phsz) {
+		sz = (proc->phsz == 0U) ? 16U : (proc->phsz * 2U);
+		if (sz <= PORT_HANDLES_MAX) {
+			t = vm_kmalloc(sz * sizeof(*t));
+		}
+
+		if (t == NULL) {
+			(void)proc_lockClear(&proc->lock);
+			port_put(p, 0);
+			return -ENOMEM;
+		}
+
+		hal_memset(t, 0, sz * sizeof(*t));
+	}
+
+	hal_spinlockSet(&proc->phspinlock, &sc);
+	if (t != NULL) {
+		if (proc->phsz != 0U) {
+			hal_memcpy(t, proc->phandles, proc->phsz * sizeof(*t));
+		}
+		old = proc->phandles;
+		proc->phandles = t;
+		proc->phsz = sz;
+	}
+	proc->phandles[i] = p;
+	hal_spinlockClear(&proc->phspinlock, &sc);
+
+	(void)proc_lockClear(&proc->lock);
+
+	if (old != NULL) {
+		vm_kfree(old);
+	}
+
+	*handle = i | PORT_HANDLE;
+
+	return EOK;
+}
+
+
+int proc_portHandleClose(u32 handle)
+{
+	thread_t *curr = proc_current();
+	process_t *proc = (curr == NULL) ? NULL : curr->process;
+	port_t *p = NULL;
+	spinlock_ctx_t sc;
+
+	if ((proc == NULL) || ((handle & PORT_HANDLE) == 0U)) {
+		return -EINVAL;
+	}
+
+	handle &= ~PORT_HANDLE;
+
+	hal_spinlockSet(&proc->phspinlock, &sc);
+	if (handle < proc->phsz) {
+		p = proc->phandles[handle];
+		proc->phandles[handle] = NULL;
+	}
+	hal_spinlockClear(&proc->phspinlock, &sc);
+
+	if (p == NULL) {
+		return -EINVAL;
+	}
+
+	port_put(p, 0);
+
+	return EOK;
+}
+
+
+void proc_portHandlesDestroy(process_t *proc)
+{
+	port_t **t;
+	unsigned int i, sz;
+	spinlock_ctx_t sc;
+
+	hal_spinlockSet(&proc->phspinlock, &sc);
+	t = proc->phandles;
+	sz = proc->phsz;
+	proc->phandles = NULL;
+	proc->phsz = 0;
+	hal_spinlockClear(&proc->phspinlock, &sc);
+
+	if (t != NULL) {
+		for (i = 0; i < sz; i++) {
+			if (t[i] != NULL) {
+				port_put(t[i], 0);
+			}
+		}
+
+		vm_kfree(t);
+	}
+}
+
+
 void _port_init(void)
 {
 	lib_idtreeInit(&port_common.tree);
 	(void)proc_lockInit(&port_common.port_lock, &proc_lockAttrDefault, "port.common");
+	port_common.cache = vm_kmemCacheCreate("port", sizeof(port_t), VM_KMEM_CACHELINE, NULL);
 }
@@ -23,21 +23,50 @@
 #include "threads.h"
 
 
+struct _portset_t;
+struct _notify_t;
+
+
+/* In-flight message slot, rid encodes slot index and generation */
+typedef struct _port_rid_t {
+	kmsg_t *kmsg;
+	unsigned int gen;
+	int next; /* Next free slot */
+} port_rid_t;
+
+
 typedef struct _port_t {
 	idnode_t linkage;
 	struct _port_t *next;
 	struct _port_t *prev;
 
-	idtree_t rid;
+	struct _portset_t *set;
+	struct _port_t *snext;
+	struct _port_t *sprev;
+	unsigned int spriority;
+
+	port_rid_t *rids;
+	unsigned int nrids;
+	int ridfree;
 
 	kmsg_t *kmessages;
 	process_t *owner;
 	int refs, closed;
 
 	spinlock_t spinlock;
-	lock_t lock;
 	thread_t *threads;
 	msg_t *current;
+
+	/* Protected by spinlock */
+	unsigned int idle;
+	struct _notify_t *pnotify; /* Signalled when queue exceeds pthreshold with no idle receiver */
+	unsigned int pbits, pthreshold;
+
+	struct {
+		unsigned int received, responded;
+		unsigned int depth, maxdepth;
+		time_t qtime, stime;
+	} stats;
 } port_t;
 
 /* FIXME - use int for port handle.
@@ -52,12 +81,51 @@ void proc_portDestroy(u32 port);
 void proc_portsDestroy(process_t *proc);
 
 
+/* Accepts both port id and PORT_HANDLE tagged handle of the current process */
 port_t *proc_portGet(u32 id);
 
 
+/* Opens process local handle to the port, resolved without global lookup */
+int proc_portHandleOpen(u32 port, u32 *handle);
+
+
+int proc_portHandleClose(u32 handle);
+
+
+void proc_portHandlesDestroy(process_t *proc);
+
+
 void port_put(port_t *p, int destroy);
 
 
+/* Statistics updates, port spinlock has to be held */
+void _port_statQueue(port_t *p, kmsg_t *kmsg);
+
+
+void _port_statDequeue(port_t *p, kmsg_t *kmsg, int received);
+
+
+void _port_statRespond(port_t *p, kmsg_t *kmsg);
+
+
+/* Reverts receive accounting of a message which couldn't be delivered */
+void _port_statReject(port_t *p, kmsg_t *kmsg);
+
+
+int proc_portsList(int n, portinfo_t *info);
+
+
+/* Signals pressure notification after message was queued, port spinlock has to be held */
+void _port_pressureCheck(port_t *p);
+
+
+int proc_portPressure(u32 port, port_pressure_t *pressure);
+
+
+/* Sets notification h of the current process signalled with bits when more than threshold messages wait, h < 0 disables */
+int proc_portPressureNotify(u32 port, int h, unsigned int bits, unsigned int threshold);
+
+
 msg_rid_t proc_portRidAlloc(port_t *p, kmsg_t *kmsg);
 
 
@@ -0,0 +1,293 @@
+/*
+ * Phoenix-RTOS
+ *
+ * Operating system kernel
+ *
+ * Port sets
+ *
+ * Copyright 2026 Phoenix Systems
+ *
+ * This file is part of Phoenix-RTOS.
+ *
+ * %LICENSE%
+ */
+
+#include "include/errno.h"
+#include "lib/assert.h"
+#include "lib/lib.h"
+#include "threads.h"
+#include "portset.h"
+
+
+static struct {
+	lock_t lock; /* Protects port set membership */
+} portset_common;
+
+
+portset_t *portset_get(int h)
+{
+	thread_t *t = proc_current();
+	resource_t *r = resource_get(t->process, h);
+	LIB_ASSERT((r == NULL) || (r->type == rtPortSet), "process: %s, pid: %d, tid: %d, handle: %d, resource type mismatch",
+			t->process->path, process_getPid(t->process), proc_getTid(t), h);
+	return ((r != NULL) && (r->type == rtPortSet)) ? r->payload.portset : NULL;
+}
+
+
+static void _portset_remove(portset_t *set, port_t *p)
+{
+	spinlock_ctx_t sc, psc;
+
+	hal_spinlockSet(&set->spinlock, &sc);
+	hal_spinlockSet(&p->spinlock, &psc);
+	LIST_REMOVE_EX(&set->members, p, snext, sprev);
+	p->set = NULL;
+	hal_spinlockClear(&p->spinlock, &psc);
+	hal_spinlockClear(&set->spinlock, &sc);
+}
+
+
+void portset_put(portset_t *set)
+{
+	thread_t *t = proc_current();
+	int rem;
+
+	LIB_ASSERT(set != NULL, "process: %s, pid: %d, tid: %d, set == NULL",
+			t->process->path, process_getPid(t->process), proc_getTid(t));
+
+	rem = resource_put(t->process, &set->resource);
+	LIB_ASSERT(rem >= 0, "process: %s, pid: %d, tid: %d, refcnt below zero",
+			t->process->path, process_getPid(t->process), proc_getTid(t));
+	if (rem == 0) {
+		(void)proc_lockSet(&portset_common.lock);
+		while (set->members != NULL) {
+			_portset_remove(set, set->members);
+		}
+		(void)proc_lockClear(&portset_common.lock);
+
+		hal_spinlockDestroy(&set->spinlock);
+		vm_kfree(set);
+	}
+}
+
+
+void portset_detach(port_t *p)
+{
+	(void)proc_lockSet(&portset_common.lock);
+	if (p->set != NULL) {
+		_portset_remove(p->set, p);
+	}
+	(void)proc_lockClear(&portset_common.lock);
+}
+
+
+int portset_wait(portset_t *set, port_t **port, kmsg_t **kmsg)
+{
+	port_t *p, *found = NULL;
+	kmsg_t *k = NULL;
+	spinlock_ctx_t sc, psc;
+	int err = EOK;
+
+	hal_spinlockSet(&set->spinlock, &sc);
+
+	for (;;) {
+		p = set->members;
+		if (p != NULL) {
+			do {
+				hal_spinlockSet(&p->spinlock, &psc);
+				k = p->kmessages;
+				if (k != NULL) {
+					LIST_REMOVE(&p->kmessages, k);
+					_port_statDequeue(p, k, 1);
+					k->state = msg_received;
+					/* Reference is held until the message is delivered, respond looks the port up again */
+					p->refs++;
+					found = p;
+				}
+				hal_spinlockClear(&p->spinlock, &psc);
+
+				if (found != NULL) {
+					break;
+				}
+
+				p = p->snext;
+			} while (p != set->members);
+		}
+
+		if (found != NULL) {
+			if (set->policy == PORTSET_ROUNDROBIN) {
+				/* Start next scan from the member following the served one */
+				set->members = found->snext;
+			}
+			break;
+		}
+
+		if (err != EOK) {
+			break;
+		}
+
+		set->idle++;
+		err = proc_threadWaitInterruptible(&set->threads, &set->spinlock, 0, &sc);
+		set->idle--;
+	}
+
+	hal_spinlockClear(&set->spinlock, &sc);
+
+	if (found == NULL) {
+		return err;
+	}
+
+	*port = found;
+	*kmsg = k;
+
+	return EOK;
+}
+
+
+int proc_portSetCreate(unsigned int policy)
+{
+	process_t *proc = proc_current()->process;
+	portset_t *set;
+	int id;
+
+	if ((policy != PORTSET_ROUNDROBIN) && (policy != PORTSET_PRIORITY)) {
+		return -EINVAL;
+	}
+
+	set = vm_kmalloc(sizeof(*set));
+	if (set == NULL) {
+		return -ENOMEM;
+	}
+
+	set->resource.payload.portset = set;
+	set->resource.type = rtPortSet;
+
+	id = resource_alloc(proc, &set->resource);
+	if (id < 0) {
+		vm_kfree(set);
+		return -ENOMEM;
+	}
+
+	hal_spinlockCreate(&set->spinlock, "portset.spinlock");
+	set->threads = NULL;
+	set->members = NULL;
+	set->policy = policy;
+	set->idle = 0;
+
+	(void)resource_put(proc, &set->resource);
+
+	return id;
+}
+
+
+int proc_portSetAdd(int h, u32 port, unsigned int priority)
+{
+	process_t *proc = proc_current()->process;
+	portset_t *set;
+	port_t *p, *q;
+	spinlock_ctx_t sc, psc;
+	int err = EOK;
+
+	set = portset_get(h);
+	if (set == NULL) {
+		return -EINVAL;
+	}
+
+	p = proc_portGet(port);
+	if (p == NULL) {
+		portset_put(set);
+		return -EINVAL;
+	}
+
+	(void)proc_lockSet(&portset_common.lock);
+
+	if (p->owner != proc) {
+		err = -EPERM;
+	}
+	else if (p->set != NULL) {
+		err = -EBUSY;
+	}
+	else {
+		hal_spinlockSet(&set->spinlock, &sc);
+		hal_spinlockSet(&p->spinlock, &psc);
+
+		if (p->closed != 0) {
+			err = -EINVAL;
+		}
+		else {
+			/* Keep members sorted by priority (FIFO within the same priority) */
+			q = set->members;
+			if ((q != NULL) && (set->policy == PORTSET_PRIORITY)) {
+				do {
+					if (q->spriority > priority) {
+						break;
+					}
+					q = q->snext;
+				} while (q != set->members);
+			}
+
+			/* Insert before q */
+			LIST_ADD_EX(&q, p, snext, sprev);
+			if ((set->members == NULL) || ((set->policy == PORTSET_PRIORITY) && (set->members->spriority > priority))) {
+				set->members = p;
+			}
+
+			p->spriority = priority;
+			p->set = set;
+
+			/* Messages might have been queued before the port joined the set */
+			if (p->kmessages != NULL) {
+				(void)proc_threadWakeup(&set->threads);
+			}
+		}
+
+		hal_spinlockClear(&p->spinlock, &psc);
+		hal_spinlockClear(&set->spinlock, &sc);
+	}
+
+	(void)proc_lockClear(&portset_common.lock);
+
+	port_put(p, 0);
+	portset_put(set);
+
+	return err;
+}
+
+
+int proc_portSetRemove(int h, u32 port)
+{
+	portset_t *set;
+	port_t *p;
+	int err = EOK;
+
+	set = portset_get(h);
+	if (set == NULL) {
+		return -EINVAL;
+	}
+
+	p = proc_portGet(port);
+	if (p == NULL) {
+		portset_put(set);
+		return -EINVAL;
+	}
+
+	(void)proc_lockSet(&portset_common.lock);
+	if (p->set != set) {
+		err = -ENOENT;
+	}
+	else {
+		_portset_remove(set, p);
+	}
+	(void)proc_lockClear(&portset_common.lock);
+
+	port_put(p, 0);
+	portset_put(set);
+
+	return err;
+}
+
+
+void _portset_init(void)
+{
+	(void)proc_lockInit(&portset_common.lock, &proc_lockAttrDefault, "portset.common");
+}
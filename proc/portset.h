@@ -0,0 +1,59 @@
+/*
+ * Phoenix-RTOS
+ *
+ * Operating system kernel
+ *
+ * Port sets
+ *
+ * Copyright 2026 Phoenix Systems
+ *
+ * This file is part of Phoenix-RTOS.
+ *
+ * %LICENSE%
+ */
+
+#ifndef _PH_PROC_PORTSET_H_
+#define _PH_PROC_PORTSET_H_
+
+#include "hal/hal.h"
+#include "resource.h"
+#include "ports.h"
+
+
+typedef struct _portset_t {
+	resource_t resource;
+	spinlock_t spinlock;
+	thread_t *threads;
+	port_t *members;
+	unsigned int policy;
+	unsigned int idle; /* Receivers waiting on the set */
+} portset_t;
+
+
+portset_t *portset_get(int h);
+
+
+void portset_put(portset_t *set);
+
+
+/* Removes port from its set (if any), called on port close */
+void portset_detach(port_t *p);
+
+
+/* Waits for a message on any member port, returns it dequeued with a reference held on its port */
+int portset_wait(portset_t *set, port_t **port, kmsg_t **kmsg);
+
+
+int proc_portSetCreate(unsigned int policy);
+
+
+int proc_portSetAdd(int h, u32 port, unsigned int priority);
+
+
+int proc_portSetRemove(int h, u32 port);
+
+
+void _portset_init(void);
+
+
+#endif
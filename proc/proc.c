@@ -24,6 +24,9 @@ int _proc_init(vm_map_t *kmap, vm_object_t *kernel)
 	(void)_threads_init(kmap, kernel);
 	(void)_process_init(kmap, kernel);
 	_port_init();
+	_portset_init();
+	_mutex_init();
+	_cond_init();
 	_msg_init(kmap, kernel);
 	_name_init();
 	_userintr_init();
@@ -28,6 +28,8 @@
 #include "cond.h"
 #include "userintr.h"
 #include "ports.h"
+#include "portset.h"
+#include "notify.h"
 
 
 int _proc_init(vm_map_t *kmap, vm_object_t *kernel);
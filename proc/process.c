@@ -105,12 +105,14 @@ static void process_destroy(process_t *p)
 		vm_mapDestroy(p, imapp);
 	}
 
+	proc_portHandlesDestroy(p);
 	proc_portsDestroy(p);
 	(void)proc_lockDone(&p->lock);
+	hal_spinlockDestroy(&p->phspinlock);
 
 	while ((ghost = p->ghosts) != NULL) {
 		LIST_REMOVE_EX(&p->ghosts, ghost, procnext, procprev);
-		vm_kfree(ghost);
+		threads_ghostFree(ghost);
 	}
 
 	vm_kfree(p->path);
@@ -209,6 +211,9 @@ int proc_start(startFn_t start, void *arg, const char *path)
 	(void)proc_lockInit(&process->lock, &proc_lockAttrDefault, "process");
 
 	process->ports = NULL;
+	process->phandles = NULL;
+	process->phsz = 0;
+	hal_spinlockCreate(&process->phspinlock, "process.phandles");
 
 	process->sigpend = 0;
 	process->sighandler = NULL;
@@ -1698,6 +1703,7 @@ static int process_execve(thread_t *current)
 		}
 
 		proc_resourcesDestroy(current->process);
+		proc_portHandlesDestroy(current->process);
 		proc_portsDestroy(current->process);
 	}
 
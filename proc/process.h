@@ -58,6 +58,9 @@ typedef struct _process_t {
 	/* TODO: Process shall keep information permissions (uid, euid, suid, gid, egid, sgid, umask) */
 
 	struct _port_t *ports;
+	struct _port_t **phandles;
+	unsigned int phsz;
+	spinlock_t phspinlock;
 
 	idtree_t resources;
 
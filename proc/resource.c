@@ -22,6 +22,8 @@
 #include "resource.h"
 #include "name.h"
 #include "userintr.h"
+#include "portset.h"
+#include "notify.h"
 
 #define RESOURCE_ID_MIN 1
 
@@ -91,6 +93,14 @@ static void proc_resourcePut(resource_t *r)
 			userintr_put(r->payload.userintr);
 			break;
 
+		case rtPortSet:
+			portset_put(r->payload.portset);
+			break;
+
+		case rtNotify:
+			notify_put(r->payload.notify);
+			break;
+
 		default:
 			LIB_ASSERT(0, "invalid resource type %d", (int)r->type);
 			break;
@@ -155,8 +165,13 @@ int proc_resourcesCopy(process_t *source)
 				err = proc_condCreate(&r->payload.cond->attr);
 				break;
 
+			case rtNotify:
+				/* Pending bits are not inherited */
+				err = proc_notifyCreate(r->payload.notify->flags);
+				break;
+
 			default:
-				/* Don't copy interrupt handlers */
+				/* Don't copy interrupt handlers and port sets */
 				skip = 1;
 				break;
 		}
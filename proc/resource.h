@@ -24,19 +24,23 @@
 struct _mutex_t;
 struct _cond_t;
 struct _usrintr_t;
+struct _portset_t;
+struct _notify_t;
 
 
 typedef struct _resource_t {
 	idnode_t linkage;
 	int refs;
 	/* clang-format off */
-	enum { rtLock = 0, rtCond, rtInth } type;
+	enum { rtLock = 0, rtCond, rtInth, rtPortSet, rtNotify } type;
 	/* clang-format on */
 
 	union {
 		struct _cond_t *cond;
 		struct _mutex_t *mutex;
 		struct _userintr_t *userintr;
+		struct _portset_t *portset;
+		struct _notify_t *notify;
 	} payload;
 } resource_t;
 
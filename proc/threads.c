@@ -35,6 +35,9 @@ enum { event_scheduling, event_enqueued, event_waking, event_preempted };
 #define UNLOCK_TRY        0
 #define UNLOCK_FORCE      1
 
+/* Signal context and handler arguments pushed below user stack pointer */
+#define THREADS_SIGFRAME (2U * sizeof(cpu_context_t))
+
 
 const struct lockAttr proc_lockAttrDefault = { .type = PH_LOCK_NORMAL };
 
@@ -43,6 +46,7 @@ static thread_t *const wakeupPending = (void *)-1;
 
 static struct {
 	vm_map_t *kmap;
+	vm_kmemcache_t *cache;
 	spinlock_t spinlock;
 	lock_t lock;
 	thread_t *ready[8];
@@ -274,7 +278,7 @@ static void thread_destroy(thread_t *thread)
 		(void)proc_put(process);
 	}
 	else {
-		vm_kfree(thread);
+		vm_kmemCacheFree(threads_common.cache, thread);
 	}
 }
 
@@ -294,6 +298,12 @@ thread_t *threads_findThread(int tid)
 }
 
 
+void threads_ghostFree(thread_t *ghost)
+{
+	vm_kmemCacheFree(threads_common.cache, ghost);
+}
+
+
 void threads_put(thread_t *thread)
 {
 	int refs;
@@ -376,6 +386,12 @@ int _threads_schedule(unsigned int n, cpu_context_t *context, void *arg)
 	i = 0;
 	while (i < sizeof(threads_common.ready) / sizeof(thread_t *)) {
 		selected = threads_common.ready[i];
+
+		/* Skip threads bound to other CPUs */
+		while ((selected != NULL) && (selected->cpu >= 0) && ((unsigned int)selected->cpu != hal_cpuGetID())) {
+			selected = (selected->next != threads_common.ready[i]) ? selected->next : NULL;
+		}
+
 		if (selected == NULL) {
 			i++;
 			continue;
@@ -545,7 +561,7 @@ int proc_threadCreate(process_t *process, startFn_t start, int *id, u8 priority,
 		return -EINVAL;
 	}
 
-	t = vm_kmalloc(sizeof(thread_t));
+	t = vm_kmemCacheAlloc(threads_common.cache);
 	if (t == NULL) {
 		return -ENOMEM;
 	}
@@ -553,7 +569,7 @@ int proc_threadCreate(process_t *process, startFn_t start, int *id, u8 priority,
 	t->kstacksz = kstacksz;
 	t->kstack = vm_kmalloc(t->kstacksz);
 	if (t->kstack == NULL) {
-		vm_kfree(t);
+		vm_kmemCacheFree(threads_common.cache, t);
 		return -ENOMEM;
 	}
 	hal_memset(t->kstack, 0xba, t->kstacksz);
@@ -574,6 +590,7 @@ int proc_threadCreate(process_t *process, startFn_t start, int *id, u8 priority,
 	t->utick = 0;
 	t->priorityBase = priority;
 	t->priority = priority;
+	t->cpu = -1;
 	t->cpuTime = 0;
 	t->maxWait = 0;
 	proc_gettime(&t->startTime, NULL);
@@ -582,7 +599,7 @@ int proc_threadCreate(process_t *process, startFn_t start, int *id, u8 priority,
 
 	if (thread_alloc(t) < 0) {
 		vm_kfree(t->kstack);
-		vm_kfree(t);
+		vm_kmemCacheFree(threads_common.cache, t);
 		return -ENOMEM;
 	}
 
@@ -591,7 +608,7 @@ int proc_threadCreate(process_t *process, startFn_t start, int *id, u8 priority,
 		if (err != EOK) {
 			lib_idtreeRemove(&threads_common.id, &t->idlinkage);
 			vm_kfree(t->kstack);
-			vm_kfree(t);
+			vm_kmemCacheFree(threads_common.cache, t);
 			return err;
 		}
 	}
@@ -764,6 +781,24 @@ int proc_threadPriority(int signedPriority)
 }
 
 
+int proc_threadAffinity(int cpu)
+{
+	spinlock_ctx_t sc;
+
+	if ((cpu < -1) || ((cpu >= 0) && ((unsigned int)cpu >= hal_cpuGetCount()))) {
+		return -EINVAL;
+	}
+
+	hal_spinlockSet(&threads_common.spinlock, &sc);
+	_proc_current()->cpu = cpu;
+
+	/* Move to the requested CPU */
+	(void)hal_cpuReschedule(&threads_common.spinlock, &sc);
+
+	return EOK;
+}
+
+
 static void _thread_interrupt(thread_t *t)
 {
 	_proc_threadDequeue(t);
@@ -1211,7 +1246,7 @@ int proc_join(int tid, time_t timeout)
 		(void)process_tlsDestroy(&ghost->tls, process->mapp);
 	}
 
-	vm_kfree(ghost);
+	vm_kmemCacheFree(threads_common.cache, ghost);
 	return err < 0 ? err : id;
 }
 
@@ -1353,24 +1388,52 @@ int threads_sigpost(process_t *process, thread_t *thread, int sig)
 
 static int _threads_checkSignal(thread_t *selected, process_t *proc, cpu_context_t *signalCtx, unsigned int oldmask, const int src)
 {
+	int ret = -1;
+
 #ifndef KERNEL_SIGNALS_DISABLE
 
 	unsigned int sig;
+#ifndef NOMMU
+	spinlock_ctx_t sc;
+#endif
 
 	sig = (selected->sigpend | proc->sigpend) & ~selected->sigmask;
 	if ((sig != 0U) && (proc->sighandler != NULL)) {
 		sig = hal_cpuGetLastBit(sig);
 
+#ifndef NOMMU
+		/* Frame can't be faulted in here, signal stays pending while the stack is write-protected (e.g. by fork) */
+		if (vm_mapWriteBegin(proc->mapp, (char *)signalCtx + sizeof(*signalCtx) - THREADS_SIGFRAME, THREADS_SIGFRAME, &sc) < 0) {
+			return -1;
+		}
+#endif
+
 		if (hal_cpuPushSignal(selected->kstack + selected->kstacksz, proc->sighandler, signalCtx, (int)sig, oldmask, src) == 0) {
 			selected->sigpend &= ~(0x1U << sig);
 			proc->sigpend &= ~(0x1U << sig);
-			return 0;
+			ret = 0;
 		}
+
+#ifndef NOMMU
+		vm_mapWriteEnd(proc->mapp, &sc);
+#endif
 	}
 
 #endif
 
-	return -1;
+	return ret;
+}
+
+
+/* Faults in signal frame before it's pushed under the scheduler lock */
+static void threads_sigframeFault(thread_t *thread, cpu_context_t *signalCtx)
+{
+#ifndef NOMMU
+	(void)vm_mapPopulate(thread->process->mapp, (char *)signalCtx + sizeof(*signalCtx) - THREADS_SIGFRAME, THREADS_SIGFRAME, PROT_READ | PROT_WRITE);
+#else
+	(void)thread;
+	(void)signalCtx;
+#endif
 }
 
 
@@ -1382,11 +1445,17 @@ void threads_setupUserReturn(void *retval, cpu_context_t *ctx)
 	void *kstackTop;
 	thread_t *thread;
 
+	thread = proc_current();
+	signalCtx = (void *)((char *)hal_cpuGetUserSP(ctx) - sizeof(*signalCtx));
+
+	/* Pending signal is read without the lock, missed one is pushed by the scheduler */
+	if (((thread->sigpend | thread->process->sigpend) & ~thread->sigmask) != 0U) {
+		threads_sigframeFault(thread, signalCtx);
+	}
+
 	hal_spinlockSet(&threads_common.spinlock, &sc);
-	thread = _proc_current();
 
 	kstackTop = thread->kstack + thread->kstacksz;
-	signalCtx = (void *)((char *)hal_cpuGetUserSP(ctx) - sizeof(*signalCtx));
 	hal_cpuSetReturnValue(ctx, retval);
 
 	if (_threads_checkSignal(thread, thread->process, signalCtx, thread->sigmask, SIG_SRC_SCALL) == 0) {
@@ -1409,15 +1478,18 @@ int threads_sigsuspend(unsigned int mask)
 	void *kstackTop, *f;
 	unsigned int oldmask;
 
+	thread = proc_current();
+	kstackTop = thread->kstack + thread->kstacksz;
+	ctx = kstackTop - sizeof(*ctx);
+	signalCtx = (void *)((char *)hal_cpuGetUserSP(ctx) - sizeof(*signalCtx));
+
+	/* Signal is expected, its frame is faulted in before taking the lock */
+	threads_sigframeFault(thread, signalCtx);
 
 	/* changing sigmask and sleep shall be atomic - do it under lock (sigpost is done also under threads_common.spinlock) */
 	hal_spinlockSet(&threads_common.spinlock, &sc);
-	thread = _proc_current();
 
 	/* setup syscall return value - sigsuspend always returns -EINTR */
-	kstackTop = thread->kstack + thread->kstacksz;
-	ctx = kstackTop - sizeof(*ctx);
-	signalCtx = (void *)((char *)hal_cpuGetUserSP(ctx) - sizeof(*signalCtx));
 	hal_cpuSetReturnValue(ctx, (void *)-EINTR);
 
 	oldmask = thread->sigmask;
@@ -1438,6 +1510,9 @@ int threads_sigsuspend(unsigned int mask)
 	(void)hal_cpuReschedule(&threads_common.spinlock, &sc);
 	/* after wakeup */
 
+	/* Stack could have been write-protected by fork while sleeping */
+	threads_sigframeFault(thread, signalCtx);
+
 	/* check for pending signals before restoring the old mask */
 	hal_spinlockSet(&threads_common.spinlock, &sc);
 	if (_threads_checkSignal(thread, thread->process, signalCtx, oldmask, SIG_SRC_SCALL) == 0) {
@@ -2071,6 +2146,11 @@ int _threads_init(vm_map_t *kmap, vm_object_t *kernel)
 
 	hal_spinlockCreate(&threads_common.spinlock, "threads.spinlock");
 
+	threads_common.cache = vm_kmemCacheCreate("thread", sizeof(thread_t), VM_KMEM_CACHELINE, NULL);
+	if (threads_common.cache == NULL) {
+		return -ENOMEM;
+	}
+
 	/* Allocate and initialize current threads array */
 	/* parasoft-suppress-next-line MISRAC2012-DIR_4_7 "return value of hal_cpuGetCount() is used, false positive" */
 	threads_common.current = (thread_t **)vm_kmalloc(sizeof(thread_t *) * hal_cpuGetCount());
@@ -57,6 +57,8 @@ typedef struct _thread_t {
 	unsigned int exit : 2;
 	unsigned interruptible : 1;
 
+	int cpu; /* CPU the thread is bound to, -1 for any */
+
 	unsigned int sigmask;
 	unsigned int sigpend;
 
@@ -103,6 +105,9 @@ int proc_threadCreate(process_t *process, startFn_t start, int *id, u8 priority,
 int proc_threadPriority(int signedPriority);
 
 
+int proc_threadAffinity(int cpu);
+
+
 __attribute__((noreturn)) void proc_threadEnd(void);
 
 
@@ -163,6 +168,10 @@ thread_t *threads_findThread(int tid);
 void threads_put(thread_t *thread);
 
 
+/* Frees reaped thread */
+void threads_ghostFree(thread_t *ghost);
+
+
 time_t proc_uptime(void);
 
 
@@ -43,6 +43,10 @@ void userintr_put(userintr_t *ui)
 			cond_put(ui->cond);
 		}
 
+		if (ui->notify != NULL) {
+			notify_put(ui->notify);
+		}
+
 		vm_kfree(ui);
 	}
 }
@@ -91,6 +95,11 @@ static int userintr_dispatch(unsigned int n, cpu_context_t *ctx, void *arg)
 		(void)proc_threadBroadcast(&ui->cond->queue);
 	}
 
+	if (ret >= 0 && ui->notify != NULL) {
+		reschedule = 1;
+		notify_signal(ui->notify, (ret > 0) ? (unsigned int)ret : 1U);
+	}
+
 	/* Restore process address space */
 	if ((p != NULL) && (p->pmapp != NULL)) {
 		pmap_switch(p->pmapp);
@@ -100,25 +109,48 @@ static int userintr_dispatch(unsigned int n, cpu_context_t *ctx, void *arg)
 }
 
 
+static void userintr_resourcePut(cond_t *cond, notify_t *notify)
+{
+	if (cond != NULL) {
+		cond_put(cond);
+	}
+
+	if (notify != NULL) {
+		notify_put(notify);
+	}
+}
+
+
 int userintr_setHandler(unsigned int n, userintrFn_t f, void *arg, handle_t c)
 {
 	process_t *process = proc_current()->process;
 	userintr_t *ui;
+	resource_t *r = NULL;
 	cond_t *cond = NULL;
+	notify_t *notify = NULL;
 	int id, res;
 
 	if (c > 0) {
-		cond = cond_get(c);
-		if (cond == NULL) {
+		r = resource_get(process, c);
+		if (r == NULL) {
+			return -EINVAL;
+		}
+
+		if (r->type == rtCond) {
+			cond = r->payload.cond;
+		}
+		else if (r->type == rtNotify) {
+			notify = r->payload.notify;
+		}
+		else {
+			(void)resource_put(process, r);
 			return -EINVAL;
 		}
 	}
 
 	ui = vm_kmalloc(sizeof(*ui));
 	if (ui == NULL) {
-		if (cond != NULL) {
-			cond_put(cond);
-		}
+		userintr_resourcePut(cond, notify);
 		return -ENOMEM;
 	}
 
@@ -135,6 +167,7 @@ int userintr_setHandler(unsigned int n, userintrFn_t f, void *arg, handle_t c)
 	ui->arg = arg;
 	ui->process = process;
 	ui->cond = cond;
+	ui->notify = notify;
 
 #ifdef __TARGET_RISCV64
 	/* Clear PGHD_USER attribute in interrupt handler code page (RISC-V specification forbids user code execution in kernel mode).
@@ -151,9 +184,7 @@ int userintr_setHandler(unsigned int n, userintrFn_t f, void *arg, handle_t c)
 
 	res = hal_interruptsSetHandler(&ui->handler);
 	if (res != EOK) {
-		if (cond != NULL) {
-			cond_put(cond);
-		}
+		userintr_resourcePut(cond, notify);
 		vm_kfree(ui);
 		return res;
 	}
@@ -161,9 +192,7 @@ int userintr_setHandler(unsigned int n, userintrFn_t f, void *arg, handle_t c)
 	id = resource_alloc(process, &ui->resource);
 	if (id < 0) {
 		(void)hal_interruptsDeleteHandler(&ui->handler);
-		if (cond != NULL) {
-			cond_put(cond);
-		}
+		userintr_resourcePut(cond, notify);
 		vm_kfree(ui);
 		return -ENOMEM;
 	}
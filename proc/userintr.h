@@ -18,6 +18,7 @@
 
 #include "hal/hal.h"
 #include "cond.h"
+#include "notify.h"
 #include "resource.h"
 
 
@@ -30,12 +31,14 @@ typedef struct _userintr_t {
 	userintrFn_t f;
 	void *arg;
 	cond_t *cond;
+	notify_t *notify;
 } userintr_t;
 
 
 void userintr_put(userintr_t *ui);
 
 
+/* Handle c may be a conditional or a notification, the latter gets handler's positive return value OR-ed (1 if zero) */
 int userintr_setHandler(unsigned int n, userintrFn_t f, void *arg, handle_t c);
 
 
@@ -94,6 +94,12 @@ int syscalls_sys_mmap(u8 *ustack)
 				return -ENOMEM;
 			}
 		}
+#ifdef SIZE_LARGEPAGE
+		else if (((flags & MAP_LARGEPAGE) != 0U) && (size >= SIZE_LARGEPAGE) && ((size & (size - 1U)) == 0U)) {
+			/* Naturally aligned block, small anonymous pages are used if it can't be allocated */
+			o = vm_objectLarge(size);
+		}
+#endif
 		else {
 			o = NULL;
 		}
@@ -451,6 +457,55 @@ void syscalls_meminfo(u8 *ustack)
 }
 
 
+int syscalls_msginfo(u8 *ustack)
+{
+	msginfo_t *info;
+
+	GETFROMSTACK(ustack, msginfo_t *, info, 0U);
+
+	if (vm_mapBelongs(proc_current()->process, info, sizeof(*info)) < 0) {
+		return -EFAULT;
+	}
+
+	proc_msgInfo(info);
+	proc_nameInfo(info);
+
+	return EOK;
+}
+
+
+int syscalls_portsinfo(u8 *ustack)
+{
+	int n;
+	portinfo_t *info;
+
+	GETFROMSTACK(ustack, int, n, 0U);
+	GETFROMSTACK(ustack, portinfo_t *, info, 1U);
+
+	if ((n < 0) || (vm_mapBelongs(proc_current()->process, info, sizeof(*info) * (size_t)n) < 0)) {
+		return -EFAULT;
+	}
+
+	return proc_portsList(n, info);
+}
+
+
+int syscalls_kcacheinfo(u8 *ustack)
+{
+	int n;
+	kcacheinfo_t *info;
+
+	GETFROMSTACK(ustack, int, n, 0U);
+	GETFROMSTACK(ustack, kcacheinfo_t *, info, 1U);
+
+	if ((n < 0) || (vm_mapBelongs(proc_current()->process, info, sizeof(*info) * (size_t)n) < 0)) {
+		return -EFAULT;
+	}
+
+	return (int)vm_kmallocCacheStats(info, (unsigned int)n);
+}
+
+
 int syscalls_syspageprog(u8 *ustack)
 {
 	process_t *proc = proc_current()->process;
@@ -706,6 +761,68 @@ int syscalls_condBroadcast(u8 *ustack)
 }
 
 
+/*
+ * Notifications
+ */
+
+
+int syscalls_notifyCreate(u8 *ustack)
+{
+	process_t *proc = proc_current()->process;
+	handle_t *h;
+	unsigned int flags;
+	int res;
+
+	GETFROMSTACK(ustack, handle_t *, h, 0U);
+	GETFROMSTACK(ustack, unsigned int, flags, 1U);
+
+	if (vm_mapBelongs(proc, h, sizeof(*h)) < 0) {
+		return -EFAULT;
+	}
+
+	res = proc_notifyCreate(flags);
+	if (res < 0) {
+		return res;
+	}
+
+	*h = res;
+	return EOK;
+}
+
+
+int syscalls_notifySignal(u8 *ustack)
+{
+	int pid;
+	handle_t h;
+	unsigned int bits;
+
+	GETFROMSTACK(ustack, int, pid, 0U);
+	GETFROMSTACK(ustack, handle_t, h, 1U);
+	GETFROMSTACK(ustack, unsigned int, bits, 2U);
+
+	return proc_notifySignal(pid, h, bits);
+}
+
+
+int syscalls_notifyWait(u8 *ustack)
+{
+	process_t *proc = proc_current()->process;
+	handle_t h;
+	unsigned int *bits;
+	time_t timeout;
+
+	GETFROMSTACK(ustack, handle_t, h, 0U);
+	GETFROMSTACK(ustack, unsigned int *, bits, 1U);
+	GETFROMSTACK(ustack, time_t, timeout, 2U);
+
+	if (vm_mapBelongs(proc, bits, sizeof(*bits)) < 0) {
+		return -EFAULT;
+	}
+
+	return proc_notifyWait(h, bits, timeout);
+}
+
+
 /*
  * Resources
  */
@@ -720,6 +837,61 @@ int syscalls_resourceDestroy(u8 *ustack)
 }
 
 
+/*
+ * Port sets
+ */
+
+
+int syscalls_portSetCreate(u8 *ustack)
+{
+	process_t *proc = proc_current()->process;
+	handle_t *h;
+	unsigned int policy;
+	int res;
+
+	GETFROMSTACK(ustack, handle_t *, h, 0U);
+	GETFROMSTACK(ustack, unsigned int, policy, 1U);
+
+	if (vm_mapBelongs(proc, h, sizeof(*h)) < 0) {
+		return -EFAULT;
+	}
+
+	res = proc_portSetCreate(policy);
+	if (res < 0) {
+		return res;
+	}
+
+	*h = res;
+	return EOK;
+}
+
+
+int syscalls_portSetAdd(u8 *ustack)
+{
+	handle_t h;
+	u32 port;
+	unsigned int priority;
+
+	GETFROMSTACK(ustack, handle_t, h, 0U);
+	GETFROMSTACK(ustack, u32, port, 1U);
+	GETFROMSTACK(ustack, unsigned int, priority, 2U);
+
+	return proc_portSetAdd(h, port, priority);
+}
+
+
+int syscalls_portSetRemove(u8 *ustack)
+{
+	handle_t h;
+	u32 port;
+
+	GETFROMSTACK(ustack, handle_t, h, 0U);
+	GETFROMSTACK(ustack, u32, port, 1U);
+
+	return proc_portSetRemove(h, port);
+}
+
+
 /*
  * Interrupt management
  */
@@ -782,6 +954,33 @@ int syscalls_portCreate(u8 *ustack)
 }
 
 
+int syscalls_portHandleOpen(u8 *ustack)
+{
+	process_t *proc = proc_current()->process;
+	u32 *handle;
+	u32 port;
+
+	GETFROMSTACK(ustack, u32 *, handle, 0U);
+	GETFROMSTACK(ustack, u32, port, 1U);
+
+	if (vm_mapBelongs(proc, handle, sizeof(*handle)) < 0) {
+		return -EFAULT;
+	}
+
+	return proc_portHandleOpen(port, handle);
+}
+
+
+int syscalls_portHandleClose(u8 *ustack)
+{
+	u32 handle;
+
+	GETFROMSTACK(ustack, u32, handle, 0U);
+
+	return proc_portHandleClose(handle);
+}
+
+
 void syscalls_portDestroy(u8 *ustack)
 {
 	u32 port;
@@ -889,6 +1088,110 @@ int syscalls_msgSend(u8 *ustack)
 }
 
 
+static int syscalls_iovCopy(process_t *proc, msg_iov_t *dst, const msg_iov_t *src, size_t n)
+{
+	size_t i, size = 0;
+
+	if (n > MSG_IOV_MAX) {
+		return -EINVAL;
+	}
+
+	if ((n != 0U) && (vm_mapBelongs(proc, src, sizeof(*src) * n) < 0)) {
+		return -EFAULT;
+	}
+
+	/* Validate kernel copy, so segments can't change after the check */
+	for (i = 0; i < n; i++) {
+		dst[i] = src[i];
+		if (vm_mapBelongs(proc, dst[i].base, dst[i].len) < 0) {
+			return -EFAULT;
+		}
+
+		/* Segments are gathered into one kernel buffer */
+		if (dst[i].len > MSG_IOV_SIZE - size) {
+			return -EINVAL;
+		}
+		size += dst[i].len;
+	}
+
+	return EOK;
+}
+
+
+int syscalls_msgSendv(u8 *ustack)
+{
+	process_t *proc = proc_current()->process;
+	u32 port;
+	msg_t *msg;
+	const msg_iov_t *uiiov, *uoiov;
+	size_t ni, no;
+	msg_iov_t iiov[MSG_IOV_MAX], oiov[MSG_IOV_MAX];
+	int err;
+
+	GETFROMSTACK(ustack, u32, port, 0U);
+	GETFROMSTACK(ustack, msg_t *, msg, 1U);
+	GETFROMSTACK(ustack, const msg_iov_t *, uiiov, 2U);
+	GETFROMSTACK(ustack, size_t, ni, 3U);
+	GETFROMSTACK(ustack, const msg_iov_t *, uoiov, 4U);
+	GETFROMSTACK(ustack, size_t, no, 5U);
+
+	if (vm_mapBelongs(proc, msg, sizeof(*msg)) < 0) {
+		return -EFAULT;
+	}
+
+	err = syscalls_iovCopy(proc, iiov, uiiov, ni);
+	if (err == EOK) {
+		err = syscalls_iovCopy(proc, oiov, uoiov, no);
+	}
+
+	if (err < 0) {
+		return err;
+	}
+
+	/* Buffers of msg itself are used for directions without segments */
+	if ((ni == 0U) && (msg->i.data != NULL) && (vm_mapBelongs(proc, msg->i.data, msg->i.size) < 0)) {
+		return -EFAULT;
+	}
+
+	if ((no == 0U) && (msg->o.data != NULL) && (vm_mapBelongs(proc, msg->o.data, msg->o.size) < 0)) {
+		return -EFAULT;
+	}
+
+	return proc_sendv(port, msg, iiov, ni, oiov, no);
+}
+
+
+int syscalls_portPressure(u8 *ustack)
+{
+	u32 port;
+	port_pressure_t *pressure;
+
+	GETFROMSTACK(ustack, u32, port, 0U);
+	GETFROMSTACK(ustack, port_pressure_t *, pressure, 1U);
+
+	if (vm_mapBelongs(proc_current()->process, pressure, sizeof(*pressure)) < 0) {
+		return -EFAULT;
+	}
+
+	return proc_portPressure(port, pressure);
+}
+
+
+int syscalls_portPressureNotify(u8 *ustack)
+{
+	u32 port;
+	handle_t h;
+	unsigned int bits, threshold;
+
+	GETFROMSTACK(ustack, u32, port, 0U);
+	GETFROMSTACK(ustack, handle_t, h, 1U);
+	GETFROMSTACK(ustack, unsigned int, bits, 2U);
+	GETFROMSTACK(ustack, unsigned int, threshold, 3U);
+
+	return proc_portPressureNotify(port, h, bits, threshold);
+}
+
+
 int syscalls_msgRecv(u8 *ustack)
 {
 	process_t *proc = proc_current()->process;
@@ -939,6 +1242,104 @@ int syscalls_msgRespond(u8 *ustack)
 }
 
 
+int syscalls_msgRecvSet(u8 *ustack)
+{
+	process_t *proc = proc_current()->process;
+	handle_t h;
+	msg_t *msg;
+	msg_rid_t *rid;
+	u32 *port;
+
+	GETFROMSTACK(ustack, handle_t, h, 0U);
+	GETFROMSTACK(ustack, msg_t *, msg, 1U);
+	GETFROMSTACK(ustack, msg_rid_t *, rid, 2U);
+	GETFROMSTACK(ustack, u32 *, port, 3U);
+
+	if (vm_mapBelongs(proc, msg, sizeof(*msg)) < 0) {
+		return -EFAULT;
+	}
+
+	if (vm_mapBelongs(proc, rid, sizeof(*rid)) < 0) {
+		return -EFAULT;
+	}
+
+	if (vm_mapBelongs(proc, port, sizeof(*port)) < 0) {
+		return -EFAULT;
+	}
+
+	return proc_recvSet(h, msg, rid, port);
+}
+
+
+int syscalls_msgRecvBatch(u8 *ustack)
+{
+	process_t *proc = proc_current()->process;
+	u32 port;
+	msg_t *msgs;
+	msg_rid_t *rids;
+	size_t n;
+
+	GETFROMSTACK(ustack, u32, port, 0U);
+	GETFROMSTACK(ustack, msg_t *, msgs, 1U);
+	GETFROMSTACK(ustack, msg_rid_t *, rids, 2U);
+	GETFROMSTACK(ustack, size_t, n, 3U);
+
+	if ((n == 0U) || (n > ((size_t)-1 / sizeof(*msgs)))) {
+		return -EINVAL;
+	}
+
+	if (vm_mapBelongs(proc, msgs, sizeof(*msgs) * n) < 0) {
+		return -EFAULT;
+	}
+
+	if (vm_mapBelongs(proc, rids, sizeof(*rids) * n) < 0) {
+		return -EFAULT;
+	}
+
+	return proc_recvBatch(port, msgs, rids, n);
+}
+
+
+int syscalls_msgRespondBatch(u8 *ustack)
+{
+	process_t *proc = proc_current()->process;
+	u32 port;
+	msg_t *msgs;
+	const msg_rid_t *rids;
+	size_t n;
+#ifndef NOMMU
+	size_t i;
+#endif
+
+	GETFROMSTACK(ustack, u32, port, 0U);
+	GETFROMSTACK(ustack, msg_t *, msgs, 1U);
+	GETFROMSTACK(ustack, const msg_rid_t *, rids, 2U);
+	GETFROMSTACK(ustack, size_t, n, 3U);
+
+	if ((n == 0U) || (n > ((size_t)-1 / sizeof(*msgs)))) {
+		return -EINVAL;
+	}
+
+	if (vm_mapBelongs(proc, msgs, sizeof(*msgs) * n) < 0) {
+		return -EFAULT;
+	}
+
+	if (vm_mapBelongs(proc, rids, sizeof(*rids) * n) < 0) {
+		return -EFAULT;
+	}
+
+#ifndef NOMMU /* o.data has client memory pointer on NOMMU */
+	for (i = 0; i < n; i++) {
+		if ((msgs[i].o.data != NULL) && (vm_mapBelongs(proc, msgs[i].o.data, msgs[i].o.size) < 0)) {
+			return -EFAULT;
+		}
+	}
+#endif
+
+	return proc_respondBatch(port, msgs, rids, n);
+}
+
+
 int syscalls_lookup(u8 *ustack)
 {
 	process_t *proc = proc_current()->process;
@@ -163,6 +163,360 @@ void test_pong(void *arg)
 }
 
 
+/* Compares receiver window mapping with bounce copy for medium payloads */
+void test_msgBounce(void)
+{
+#ifndef NOMMU
+	vm_map_t map;
+	page_t *p, *sp;
+	void *src, *w, *buf;
+	cycles_t b, e, tmap, tcopy;
+	size_t size, offs, n, i;
+	unsigned int k, rounds = 1000;
+
+	lib_printf("test: msg/bounce: starting\n");
+
+	if (vm_mapCreate(&map, (void *)(VADDR_MIN + SIZE_PAGE), (void *)VADDR_USR_MAX) < 0) {
+		lib_printf("test: msg/bounce: could not create map\n");
+		return;
+	}
+
+	p = vm_pageAlloc(2 * SIZE_PAGE, PAGE_OWNER_KERNEL | PAGE_KERNEL_HEAP);
+	src = (p != NULL) ? vm_mmap(NULL, NULL, p, 2 * SIZE_PAGE, PROT_READ | PROT_WRITE, NULL, -1, MAP_NONE) : NULL;
+	buf = vm_kmalloc(2 * SIZE_PAGE);
+
+	if ((src == NULL) || (buf == NULL)) {
+		lib_printf("test: msg/bounce: could not allocate buffers\n");
+		return;
+	}
+
+	for (size = 128; size <= SIZE_PAGE; size *= 2U) {
+		for (offs = 0; offs < SIZE_PAGE; offs += SIZE_PAGE / 2U - 8U) {
+			n = (round_page(offs + size) - (offs & ~(SIZE_PAGE - 1U))) / SIZE_PAGE;
+			tmap = 0;
+			tcopy = 0;
+
+			for (k = 0; k < rounds; k++) {
+				/* Window, shadow page for unaligned data and page table updates as in msg_map() */
+				hal_cpuGetCycles(&b);
+				w = vm_mapFind(&map, NULL, n * SIZE_PAGE, MAP_NOINHERIT, PROT_READ | PROT_USER);
+				sp = (((offs | size) & (SIZE_PAGE - 1U)) != 0U) ? vm_pageAlloc(SIZE_PAGE, PAGE_OWNER_APP) : NULL;
+				for (i = 0; i < n; i++) {
+					(void)page_map(&map.pmap, w + i * SIZE_PAGE, (i == 0U && sp != NULL) ? sp->addr : p[i].addr, PGHD_READ | PGHD_USER | PGHD_PRESENT);
+				}
+				if (sp != NULL) {
+					vm_pageFree(sp);
+				}
+				(void)vm_munmap(&map, w, n * SIZE_PAGE);
+				hal_cpuGetCycles(&e);
+				tmap += e - b;
+
+				/* Copy to bounce buffer in sender and to receiver slot */
+				hal_cpuGetCycles(&b);
+				hal_memcpy(buf, src + offs, size);
+				hal_memcpy(buf + SIZE_PAGE, buf, size);
+				hal_cpuGetCycles(&e);
+				tcopy += e - b;
+			}
+
+			lib_printf("test: msg/bounce size=%zu offs=%zu map=%llu copy=%llu\n", size, offs,
+				(unsigned long long)(tmap / rounds), (unsigned long long)(tcopy / rounds));
+		}
+	}
+
+	(void)vm_munmap(NULL, src, 2 * SIZE_PAGE);
+	vm_pageFree(p);
+	vm_kfree(buf);
+	vm_mapDestroy(NULL, &map);
+#else
+	lib_printf("test: msg/bounce: payloads are not mapped on NOMMU\n");
+#endif
+}
+
+
+#define TEST_MSG_ROUNDS  1000U
+#define TEST_MSG_CLIENTS 4U
+
+
+static struct {
+	unsigned int port;
+	spinlock_t spinlock;
+	thread_t *queue;
+	volatile unsigned int running;
+	volatile int server;
+	size_t size;
+	size_t offs;
+	int cpu;
+
+	/* Round trip times of messages served on the same and on other CPU */
+	cycles_t *samples[2];
+	unsigned int nsamples[2];
+} test_msg_bench;
+
+
+/* Gives the benchmark process its own address space, so payloads are really mapped between processes */
+static void *test_msgBenchSpace(size_t size)
+{
+	process_t *process = proc_current()->process;
+
+#ifndef NOMMU
+	if (vm_mapCreate(&process->map, (void *)(VADDR_MIN + SIZE_PAGE), (void *)VADDR_USR_MAX) < 0) {
+		return NULL;
+	}
+	proc_changeMap(process, &process->map, NULL, &process->map.pmap);
+	pmap_switch(process->pmapp);
+#endif
+
+	/* Non-lazy process, pages are populated by mmap */
+	return vm_mmap(process->mapp, NULL, NULL, size, PROT_READ | PROT_WRITE | PROT_USER, NULL, -1, MAP_NONE);
+}
+
+
+static void test_msgBenchExit(volatile unsigned int *running)
+{
+	spinlock_ctx_t sc;
+
+	hal_spinlockSet(&test_msg_bench.spinlock, &sc);
+	(*running)--;
+	(void)proc_threadWakeup(&test_msg_bench.queue);
+	hal_spinlockClear(&test_msg_bench.spinlock, &sc);
+
+	proc_threadEnd();
+}
+
+
+static void test_msgBenchServer(void *arg)
+{
+	msg_t msg;
+	msg_rid_t rid;
+	spinlock_ctx_t sc;
+	int err, server;
+
+	(void)proc_threadPriority(3);
+
+	/* Server stays on the first CPU, clients are placed relative to it */
+	(void)proc_threadAffinity(0);
+
+	server = (test_msgBenchSpace(SIZE_PAGE) != NULL) ? 1 : -1;
+
+	hal_spinlockSet(&test_msg_bench.spinlock, &sc);
+	test_msg_bench.server = server;
+	(void)proc_threadWakeup(&test_msg_bench.queue);
+	hal_spinlockClear(&test_msg_bench.spinlock, &sc);
+
+	if (server < 0) {
+		proc_threadEnd();
+	}
+
+	for (;;) {
+		err = proc_recv(test_msg_bench.port, &msg, &rid);
+		if (err == -EINVAL) {
+			/* Port has been destroyed */
+			break;
+		}
+		else if (err < 0) {
+			continue;
+		}
+
+		if ((msg.o.data != NULL) && (msg.i.data != NULL)) {
+			hal_memcpy(msg.o.data, msg.i.data, min(msg.i.size, msg.o.size));
+		}
+
+		/* Tell client where the message has been served */
+		msg.o.err = (int)hal_cpuGetID();
+
+		(void)proc_respond(test_msg_bench.port, &msg, rid);
+	}
+
+	test_msgBenchExit(&test_msg_bench.running);
+}
+
+
+static void test_msgBenchClient(void *arg)
+{
+	msg_t msg;
+	void *buf;
+	cycles_t b, e;
+	unsigned int k, cpu, remote;
+	spinlock_ctx_t sc;
+
+	(void)proc_threadPriority((int)(long)arg);
+	(void)proc_threadAffinity(test_msg_bench.cpu);
+
+	buf = test_msgBenchSpace(8U * SIZE_PAGE);
+
+	for (k = 0; (buf != NULL) && (k < TEST_MSG_ROUNDS); k++) {
+		hal_memset(&msg, 0, sizeof(msg));
+		msg.type = mtWrite;
+		msg.i.data = buf + test_msg_bench.offs;
+		msg.i.size = test_msg_bench.size;
+		msg.o.data = buf + 4U * SIZE_PAGE + test_msg_bench.offs;
+		msg.o.size = test_msg_bench.size;
+
+		cpu = hal_cpuGetID();
+		hal_cpuGetCycles(&b);
+		if (proc_send(test_msg_bench.port, &msg) < 0) {
+			break;
+		}
+		hal_cpuGetCycles(&e);
+
+		remote = ((unsigned int)msg.o.err != cpu) ? 1U : 0U;
+
+		hal_spinlockSet(&test_msg_bench.spinlock, &sc);
+		test_msg_bench.samples[remote][test_msg_bench.nsamples[remote]++] = e - b;
+		hal_spinlockClear(&test_msg_bench.spinlock, &sc);
+	}
+
+	/* Buffer is released together with the process map */
+	test_msgBenchExit(&test_msg_bench.running);
+}
+
+
+static void test_msgBenchSort(cycles_t *t, unsigned int n)
+{
+	unsigned int gap, i, j;
+	cycles_t v;
+
+	for (gap = n / 2U; gap > 0U; gap /= 2U) {
+		for (i = gap; i < n; i++) {
+			v = t[i];
+			for (j = i; (j >= gap) && (t[j - gap] > v); j -= gap) {
+				t[j] = t[j - gap];
+			}
+			t[j] = v;
+		}
+	}
+}
+
+
+static void test_msgBenchRun(const char *name, size_t size, size_t offs, unsigned int clients, int mixed, int cpu)
+{
+	static const char *place[] = { "local", "remote" };
+	unsigned int i, n;
+	time_t start, stop;
+	spinlock_ctx_t sc;
+	cycles_t *t;
+
+	test_msg_bench.size = size;
+	test_msg_bench.offs = offs;
+	test_msg_bench.cpu = cpu;
+	test_msg_bench.nsamples[0] = 0;
+	test_msg_bench.nsamples[1] = 0;
+	test_msg_bench.running = clients;
+
+	proc_gettime(&start, NULL);
+
+	for (i = 0; i < clients; i++) {
+		/* Mixed run alternates clients above and below server priority */
+		if (proc_start(test_msgBenchClient, (void *)(long)((mixed != 0) ? (((i & 1U) != 0U) ? 5 : 2) : 4), "test.msg.client") < 0) {
+			hal_spinlockSet(&test_msg_bench.spinlock, &sc);
+			test_msg_bench.running--;
+			hal_spinlockClear(&test_msg_bench.spinlock, &sc);
+		}
+	}
+
+	hal_spinlockSet(&test_msg_bench.spinlock, &sc);
+	while (test_msg_bench.running != 0U) {
+		(void)proc_threadWait(&test_msg_bench.queue, &test_msg_bench.spinlock, 0, &sc);
+	}
+	hal_spinlockClear(&test_msg_bench.spinlock, &sc);
+
+	proc_gettime(&stop, NULL);
+
+	n = test_msg_bench.nsamples[0] + test_msg_bench.nsamples[1];
+	lib_printf("test: msg/bench case=%s size=%zu offs=%zu clients=%u prio=%s cpu=%s msgs=%u us=%llu rate=%llu\n",
+		name, size, offs, clients, (mixed != 0) ? "mixed" : "equal", place[(cpu != 0) ? 1 : 0], n, (unsigned long long)(stop - start),
+		(stop > start) ? (unsigned long long)n * 1000000ULL / (unsigned long long)(stop - start) : 0ULL);
+
+	for (i = 0; i < 2U; i++) {
+		n = test_msg_bench.nsamples[i];
+		t = test_msg_bench.samples[i];
+		if (n == 0U) {
+			continue;
+		}
+
+		test_msgBenchSort(t, n);
+		lib_printf("test: msg/bench case=%s size=%zu offs=%zu clients=%u prio=%s place=%s n=%u p50=%llu p90=%llu p99=%llu max=%llu\n",
+			name, size, offs, clients, (mixed != 0) ? "mixed" : "equal", place[i], n,
+			(unsigned long long)t[n / 2U], (unsigned long long)t[(n * 90U) / 100U], (unsigned long long)t[(n * 99U) / 100U], (unsigned long long)t[n - 1U]);
+	}
+}
+
+
+/* Measures round trip latency (cycles) and throughput of send/recv/respond */
+void test_msgBench(void)
+{
+	static const struct {
+		const char *name;
+		size_t size;
+		size_t offs;
+	} cases[] = {
+		{ "raw", 32, 0 },
+		{ "subpage", 512, 0 },
+		{ "multipage", 3U * SIZE_PAGE, 0 },
+		{ "unaligned", SIZE_PAGE + 100U, 13 },
+	};
+	unsigned int i, clients;
+	int mixed, cpu;
+	spinlock_ctx_t sc;
+
+	lib_printf("test: msg/bench: starting, rounds=%u cpus=%u\n", TEST_MSG_ROUNDS, hal_cpuGetCount());
+
+	hal_spinlockCreate(&test_msg_bench.spinlock, "test.msg.bench");
+	test_msg_bench.queue = NULL;
+	test_msg_bench.server = 0;
+	test_msg_bench.running = 0;
+	test_msg_bench.samples[0] = vm_kmalloc(TEST_MSG_ROUNDS * TEST_MSG_CLIENTS * sizeof(cycles_t));
+	test_msg_bench.samples[1] = vm_kmalloc(TEST_MSG_ROUNDS * TEST_MSG_CLIENTS * sizeof(cycles_t));
+
+	if ((test_msg_bench.samples[0] == NULL) || (test_msg_bench.samples[1] == NULL) || (proc_portCreate(&test_msg_bench.port) != EOK)) {
+		lib_printf("test: msg/bench: initialization failed\n");
+		return;
+	}
+
+	/* Server is a separate process, so payloads are mapped into its address space */
+	if (proc_start(test_msgBenchServer, NULL, "test.msg.server") < 0) {
+		test_msg_bench.server = -1;
+	}
+
+	hal_spinlockSet(&test_msg_bench.spinlock, &sc);
+	while (test_msg_bench.server == 0) {
+		(void)proc_threadWait(&test_msg_bench.queue, &test_msg_bench.spinlock, 0, &sc);
+	}
+	hal_spinlockClear(&test_msg_bench.spinlock, &sc);
+
+	for (i = 0; (test_msg_bench.server > 0) && (i < sizeof(cases) / sizeof(cases[0])); i++) {
+		for (clients = 1; clients <= TEST_MSG_CLIENTS; clients *= 2U) {
+			for (mixed = 0; mixed < ((clients > 1U) ? 2 : 1); mixed++) {
+				/* Clients on the server CPU, then on the next one */
+				for (cpu = 0; cpu < ((hal_cpuGetCount() > 1U) ? 2 : 1); cpu++) {
+					test_msgBenchRun(cases[i].name, cases[i].size, cases[i].offs, clients, mixed, cpu);
+				}
+			}
+		}
+	}
+
+	/* Destroying the port stops the server */
+	hal_spinlockSet(&test_msg_bench.spinlock, &sc);
+	test_msg_bench.running = (test_msg_bench.server > 0) ? 1U : 0U;
+	hal_spinlockClear(&test_msg_bench.spinlock, &sc);
+
+	proc_portDestroy(test_msg_bench.port);
+
+	hal_spinlockSet(&test_msg_bench.spinlock, &sc);
+	while (test_msg_bench.running != 0U) {
+		(void)proc_threadWait(&test_msg_bench.queue, &test_msg_bench.spinlock, 0, &sc);
+	}
+	hal_spinlockClear(&test_msg_bench.spinlock, &sc);
+
+	vm_kfree(test_msg_bench.samples[0]);
+	vm_kfree(test_msg_bench.samples[1]);
+	hal_spinlockDestroy(&test_msg_bench.spinlock);
+
+	lib_printf("test: msg/bench: done\n");
+}
+
+
 void test_msg(void)
 {
 	unsigned int port;
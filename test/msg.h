@@ -20,4 +20,10 @@
 void test_msg(void);
 
 
+void test_msgBounce(void);
+
+
+void test_msgBench(void);
+
+
 #endif
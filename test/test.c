@@ -27,9 +27,14 @@ void test_run(void)
 {
 	test_proc_threads1();
 	//	test_vm_alloc();
+	//	test_vm_pageBench();
+	//	test_vm_faultAround();
+	//	test_vm_forkBench();
 	//	test_vm_kmalloc();
 	//	test_rb();
 	//	test_msg();
+	//	test_msgBounce();
+	//	test_msgBench();
 }
 
 /* parasoft-end-suppress ALL "tests don't need to comply with MISRA" */
@@ -71,6 +71,253 @@ void test_vm_alloc(void)
 }
 
 
+#define TEST_PAGE_BENCH_N     100000U
+#define TEST_PAGE_BENCH_BATCH 64U
+#define TEST_PAGE_BENCH_THR   4U
+
+
+static struct {
+	volatile unsigned int done;
+	cycles_t cycles[TEST_PAGE_BENCH_THR];
+} test_pageBench;
+
+
+static cycles_t _test_vm_pageBenchRun(void)
+{
+	page_t *batch[TEST_PAGE_BENCH_BATCH];
+	cycles_t b = 0, e = 0;
+	unsigned int n, i;
+
+	hal_cpuGetCycles(&b);
+
+	/* Alloc/free pairs, served from CPU cache */
+	for (n = 0; n < TEST_PAGE_BENCH_N; n++) {
+		batch[0] = vm_pageAlloc(SIZE_PAGE, PAGE_OWNER_KERNEL | PAGE_KERNEL_HEAP);
+		if (batch[0] == NULL) {
+			lib_printf("test: Out of memory!\n");
+			return 0;
+		}
+		vm_pageFree(batch[0]);
+	}
+
+	/* Bursts exceeding CPU cache, forcing refills and drains */
+	for (n = 0; n < TEST_PAGE_BENCH_N / TEST_PAGE_BENCH_BATCH; n++) {
+		for (i = 0; i < TEST_PAGE_BENCH_BATCH; i++) {
+			batch[i] = vm_pageAlloc(SIZE_PAGE, PAGE_OWNER_KERNEL | PAGE_KERNEL_HEAP);
+		}
+		for (i = 0; i < TEST_PAGE_BENCH_BATCH; i++) {
+			vm_pageFree(batch[i]);
+		}
+	}
+
+	hal_cpuGetCycles(&e);
+
+	return e - b;
+}
+
+
+static void _test_vm_pageBenchThr(void *arg)
+{
+	unsigned int id = (unsigned int)(addr_t)arg;
+
+	test_pageBench.cycles[id] = _test_vm_pageBenchRun();
+	(void)__atomic_add_fetch(&test_pageBench.done, 1U, __ATOMIC_RELEASE);
+
+	proc_threadEnd();
+}
+
+
+void test_vm_pageBench(void)
+{
+	cycles_t c;
+	size_t freesz;
+	unsigned int i;
+
+	lib_printf("test: Page allocator throughput test\n");
+
+	vm_pageGetStats(&freesz);
+	lib_printf("test: free=%u\n", (u32)freesz);
+
+	c = _test_vm_pageBenchRun();
+	lib_printf("test: 1 thread, %u ops, cycles/op=%u\n", 4U * TEST_PAGE_BENCH_N, (u32)(c / (4U * TEST_PAGE_BENCH_N)));
+
+	test_pageBench.done = 0;
+	for (i = 0; i < TEST_PAGE_BENCH_THR; i++) {
+		proc_threadCreate(NULL, _test_vm_pageBenchThr, NULL, 4, 2048, NULL, 0, 0, (void *)(addr_t)i);
+	}
+
+	while (__atomic_load_n(&test_pageBench.done, __ATOMIC_ACQUIRE) != TEST_PAGE_BENCH_THR) {
+		proc_threadSleep(10000);
+	}
+
+	for (i = 0; i < TEST_PAGE_BENCH_THR; i++) {
+		lib_printf("test: thread %u, cycles/op=%u\n", i, (u32)(test_pageBench.cycles[i] / (4U * TEST_PAGE_BENCH_N)));
+	}
+
+	vm_pageGetStats(&freesz);
+	lib_printf("test: free=%u\n", (u32)freesz);
+}
+
+
+#ifndef NOMMU
+
+#define TEST_FAULT_PAGES 256U
+
+
+static void _test_vm_faultRun(vm_map_t *map, void *vaddr, size_t window)
+{
+	cycles_t b = 0, e = 0;
+	unsigned int faults = 0;
+	void *v;
+
+	vm_mapFaultAround(window);
+	(void)pmap_remove(&map->pmap, vaddr, vaddr + TEST_FAULT_PAGES * SIZE_PAGE);
+
+	/* Sequential read of resident pages, as when a shared binary is run again */
+	hal_cpuGetCycles(&b);
+	for (v = vaddr; v < vaddr + TEST_FAULT_PAGES * SIZE_PAGE; v += SIZE_PAGE) {
+		if (pmap_resolve(&map->pmap, v) == 0U) {
+			faults++;
+			if (vm_mapForce(map, v, PROT_READ | PROT_USER) != EOK) {
+				lib_printf("test: Fault at %p failed\n", v);
+				break;
+			}
+		}
+	}
+	hal_cpuGetCycles(&e);
+
+	lib_printf("test: window=%u, pages=%u, faults=%u, cycles/page=%u\n", (u32)window, TEST_FAULT_PAGES, faults, (u32)((e - b) / TEST_FAULT_PAGES));
+}
+
+
+void test_vm_faultAround(void)
+{
+	vm_map_t map;
+	vm_object_t *o;
+	void *vaddr;
+
+	lib_printf("test: Fault-around benchmark\n");
+
+	if (vm_mapCreate(&map, (void *)SIZE_PAGE, (void *)VADDR_USR_MAX) < 0) {
+		lib_printf("test: Out of memory!\n");
+		return;
+	}
+
+	o = vm_objectContiguous(TEST_FAULT_PAGES * SIZE_PAGE);
+	vaddr = (o == NULL) ? NULL : vm_mmap(&map, NULL, NULL, TEST_FAULT_PAGES * SIZE_PAGE, PROT_READ | PROT_USER, o, 0, MAP_NONE);
+	if (vaddr == NULL) {
+		lib_printf("test: Out of memory!\n");
+	}
+	else {
+		_test_vm_faultRun(&map, vaddr, 0);
+		_test_vm_faultRun(&map, vaddr, 16);
+	}
+
+	vm_mapDestroy(NULL, &map);
+	(void)vm_objectPut(o);
+	vm_mapFaultAround(16);
+}
+
+
+static const size_t test_forkHeap[] = { 16, 256, 2048 };
+
+
+static struct {
+	spinlock_t spinlock;
+	thread_t *queue;
+	volatile int done;
+} test_vm_fork;
+
+
+/* Runs in its own process, so parent map is write protected as on a real fork */
+static void test_vm_forkProcess(void *arg)
+{
+	process_t *process = proc_current()->process;
+	vm_map_t dst;
+	cycles_t b = 0, c = 0, e = 0;
+	size_t i, pages;
+	spinlock_ctx_t sc;
+	void *heap, *v;
+	int err = EOK;
+
+	if (vm_mapCreate(&process->map, (void *)(VADDR_MIN + SIZE_PAGE), (void *)VADDR_USR_MAX) < 0) {
+		err = -ENOMEM;
+	}
+	else {
+		proc_changeMap(process, &process->map, NULL, &process->map.pmap);
+		pmap_switch(process->pmapp);
+	}
+
+	for (i = 0; (err == EOK) && (i < sizeof(test_forkHeap) / sizeof(test_forkHeap[0])); i++) {
+		pages = test_forkHeap[i];
+
+		/* Non-lazy process, heap is populated by mmap */
+		heap = vm_mmap(process->mapp, NULL, NULL, pages * SIZE_PAGE, PROT_READ | PROT_WRITE | PROT_USER, NULL, -1, MAP_NONE);
+		if ((heap == NULL) || (vm_mapCreate(&dst, (void *)(VADDR_MIN + SIZE_PAGE), (void *)VADDR_USR_MAX) < 0)) {
+			lib_printf("test: Out of memory!\n");
+			break;
+		}
+
+		hal_cpuGetCycles(&b);
+		err = vm_mapCopy(process, &dst, process->mapp);
+		hal_cpuGetCycles(&c);
+
+		if (err < 0) {
+			lib_printf("test: Copy failed (%d)\n", err);
+			break;
+		}
+
+		/* Parent writes its whole heap after fork, each page is copied once */
+		for (v = heap; v < heap + pages * SIZE_PAGE; v += SIZE_PAGE) {
+			if (vm_mapForce(process->mapp, v, PROT_WRITE | PROT_USER) != EOK) {
+				lib_printf("test: Fault at %p failed\n", v);
+				break;
+			}
+		}
+		hal_cpuGetCycles(&e);
+
+		lib_printf("test: heap=%u pages, fork cycles=%u, copy cycles/page=%u\n", (u32)pages, (u32)(c - b), (u32)((e - c) / pages));
+
+		vm_mapDestroy(process, &dst);
+		(void)vm_munmap(process->mapp, heap, pages * SIZE_PAGE);
+	}
+
+	hal_spinlockSet(&test_vm_fork.spinlock, &sc);
+	test_vm_fork.done = 1;
+	(void)proc_threadWakeup(&test_vm_fork.queue);
+	hal_spinlockClear(&test_vm_fork.spinlock, &sc);
+
+	proc_threadEnd();
+}
+
+
+void test_vm_forkBench(void)
+{
+	spinlock_ctx_t sc;
+
+	lib_printf("test: Fork latency benchmark\n");
+
+	hal_spinlockCreate(&test_vm_fork.spinlock, "test.vm.fork");
+	test_vm_fork.queue = NULL;
+	test_vm_fork.done = 0;
+
+	if (proc_start(test_vm_forkProcess, NULL, "test.vm.fork") < 0) {
+		lib_printf("test: Process start failed\n");
+		test_vm_fork.done = 1;
+	}
+
+	hal_spinlockSet(&test_vm_fork.spinlock, &sc);
+	while (test_vm_fork.done == 0) {
+		(void)proc_threadWait(&test_vm_fork.queue, &test_vm_fork.spinlock, 0, &sc);
+	}
+	hal_spinlockClear(&test_vm_fork.spinlock, &sc);
+
+	hal_spinlockDestroy(&test_vm_fork.spinlock);
+}
+
+#endif
+
+
 void test_vm_mmap(void)
 {
 	vm_map_t map;
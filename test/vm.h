@@ -28,6 +28,15 @@ struct _vm_object_t;
 void test_vm_alloc(void);
 
 
+void test_vm_pageBench(void);
+
+
+void test_vm_faultAround(void);
+
+
+void test_vm_forkBench(void);
+
+
 void test_vm_mmap(void);
 
 
@@ -22,9 +22,23 @@
 #include "map.h"
 
 
+#define AMAP_ZERO_HIGH  64U    /* Pre-zeroed pages kept for anonymous faults */
+#define AMAP_ZERO_LOW   16U    /* Zeroing thread is woken below */
+#define AMAP_ZERO_SLEEP 20000U /* Zeroing thread backoff when out of memory (us) */
+
+
 static struct {
 	vm_object_t *kernel;
 	vm_map_t *kmap;
+	vm_kmemcache_t *anons;
+
+#ifndef NOMMU
+	spinlock_t zerosl;
+	page_t *zeroed;
+	size_t nzeroed;
+	thread_t *zeroq;
+	int zeroer;
+#endif
 } amap_common;
 
 
@@ -42,7 +56,7 @@ static anon_t *amap_putanon(anon_t *a)
 	vm_pageFree(a->page);
 	(void)proc_lockClear(&a->lock);
 	(void)proc_lockDone(&a->lock);
-	vm_kfree(a);
+	vm_kmemCacheFree(amap_common.anons, a);
 	return NULL;
 }
 
@@ -192,7 +206,7 @@ static anon_t *anon_new(page_t *p)
 {
 	anon_t *a;
 
-	a = vm_kmalloc(sizeof(anon_t));
+	a = vm_kmemCacheAlloc(amap_common.anons);
 	if (a == NULL) {
 		return NULL;
 	}
@@ -225,6 +239,49 @@ static int amap_unmap(vm_map_t *map, void *v)
 }
 
 
+static page_t *amap_zeroPage(vm_map_t *map)
+{
+	page_t *p;
+	void *v;
+#ifndef NOMMU
+	spinlock_ctx_t sc;
+
+	hal_spinlockSet(&amap_common.zerosl, &sc);
+	p = amap_common.zeroed;
+	if (p != NULL) {
+		LIST_REMOVE(&amap_common.zeroed, p);
+		amap_common.nzeroed--;
+	}
+
+	if ((amap_common.zeroer != 0) && (amap_common.nzeroed < AMAP_ZERO_LOW)) {
+		(void)proc_threadWakeup(&amap_common.zeroq);
+	}
+	hal_spinlockClear(&amap_common.zerosl, &sc);
+
+	if (p != NULL) {
+		return p;
+	}
+#endif
+
+	/* Pool is empty, zero in faulting thread */
+	p = vm_pageAlloc(SIZE_PAGE, PAGE_OWNER_APP);
+	if (p == NULL) {
+		return NULL;
+	}
+
+	v = amap_map(map, p);
+	if (v == NULL) {
+		vm_pageFree(p);
+		return NULL;
+	}
+
+	hal_memset(v, 0, SIZE_PAGE);
+	(void)amap_unmap(map, v);
+
+	return p;
+}
+
+
 int amap_page(vm_map_t *map, amap_t *amap, vm_object_t *o, void *vaddr, size_t aoffs, u64 offs, vm_prot_t prot, page_t **page)
 {
 	int err = EOK;
@@ -243,6 +300,14 @@ int amap_page(vm_map_t *map, amap_t *amap, vm_object_t *o, void *vaddr, size_t a
 			return EOK;
 		}
 	}
+	else if (o == NULL) {
+		/* Fresh anonymous page */
+		*page = amap_zeroPage(map);
+		if (*page == NULL) {
+			(void)proc_lockClear(&amap->lock);
+			return -ENOMEM;
+		}
+	}
 	else {
 		err = vm_objectPage(map, &amap, o, vaddr, offs, page);
 		if ((err != EOK) || (*page == NULL)) {
@@ -252,7 +317,7 @@ int amap_page(vm_map_t *map, amap_t *amap, vm_object_t *o, void *vaddr, size_t a
 			}
 			return err;
 		}
-		else if (o != NULL && (prot & PROT_WRITE) == 0U) {
+		else if ((prot & PROT_WRITE) == 0U) {
 			(void)proc_lockClear(&amap->lock);
 			return EOK;
 		}
@@ -261,16 +326,16 @@ int amap_page(vm_map_t *map, amap_t *amap, vm_object_t *o, void *vaddr, size_t a
 		}
 	}
 
-	v = amap_map(map, *page);
-	if (v == NULL) {
-		if (a != NULL) {
-			(void)proc_lockClear(&a->lock);
+	if (a != NULL || o != NULL) {
+		v = amap_map(map, *page);
+		if (v == NULL) {
+			if (a != NULL) {
+				(void)proc_lockClear(&a->lock);
+			}
+			(void)proc_lockClear(&amap->lock);
+			return -ENOMEM;
 		}
-		(void)proc_lockClear(&amap->lock);
-		return -ENOMEM;
-	}
 
-	if (a != NULL || o != NULL) {
 		/* Copy from object or shared anon */
 		*page = vm_pageAlloc(SIZE_PAGE, PAGE_OWNER_APP);
 		if (*page == NULL) {
@@ -294,12 +359,8 @@ int amap_page(vm_map_t *map, amap_t *amap, vm_object_t *o, void *vaddr, size_t a
 		}
 		hal_memcpy(w, v, SIZE_PAGE);
 		(void)amap_unmap(map, w);
+		(void)amap_unmap(map, v);
 	}
-	else {
-		hal_memset(v, 0, SIZE_PAGE);
-	}
-
-	(void)amap_unmap(map, v);
 
 	if (a != NULL) {
 		a->refs--;
@@ -318,8 +379,112 @@ int amap_page(vm_map_t *map, amap_t *amap, vm_object_t *o, void *vaddr, size_t a
 }
 
 
+#ifndef NOMMU
+static void amap_zerothr(void *arg)
+{
+	spinlock_ctx_t sc;
+	page_t *p;
+	void *v;
+	size_t n;
+
+	(void)arg;
+
+	/* Kernel window remapped for each zeroed page */
+	v = vm_mapFind(amap_common.kmap, NULL, SIZE_PAGE, MAP_NONE, PROT_READ | PROT_WRITE);
+	if (v == NULL) {
+		proc_threadEnd();
+	}
+
+	for (;;) {
+		hal_spinlockSet(&amap_common.zerosl, &sc);
+		amap_common.zeroer = 1;
+		while (amap_common.nzeroed >= AMAP_ZERO_LOW) {
+			(void)proc_threadWait(&amap_common.zeroq, &amap_common.zerosl, 0, &sc);
+		}
+		n = AMAP_ZERO_HIGH - amap_common.nzeroed;
+		hal_spinlockClear(&amap_common.zerosl, &sc);
+
+		for (; n != 0U; n--) {
+			/* Pool must not take memory the reclaimer is trying to free */
+			if (vm_pageLow() != 0) {
+				break;
+			}
+
+			p = vm_pageAlloc(SIZE_PAGE, PAGE_OWNER_APP);
+			if (p == NULL) {
+				break;
+			}
+
+			if (page_map(&amap_common.kmap->pmap, v, p->addr, PGHD_READ | PGHD_WRITE | PGHD_PRESENT) < 0) {
+				vm_pageFree(p);
+				break;
+			}
+			hal_memset(v, 0, SIZE_PAGE);
+
+			hal_spinlockSet(&amap_common.zerosl, &sc);
+			LIST_ADD(&amap_common.zeroed, p);
+			amap_common.nzeroed++;
+			hal_spinlockClear(&amap_common.zerosl, &sc);
+		}
+
+		(void)pmap_remove(&amap_common.kmap->pmap, v, v + SIZE_PAGE);
+
+		if (n != 0U) {
+			/* Low on memory, faulting threads zero their pages meanwhile */
+			(void)proc_threadSleep(AMAP_ZERO_SLEEP);
+		}
+	}
+}
+
+
+size_t amap_zeroRelease(void)
+{
+	spinlock_ctx_t sc;
+	page_t *p, *pool;
+	size_t n;
+
+	/* Pool is filled only by the zeroing thread */
+	if (amap_common.zeroer == 0) {
+		return 0;
+	}
+
+	hal_spinlockSet(&amap_common.zerosl, &sc);
+	pool = amap_common.zeroed;
+	n = amap_common.nzeroed;
+	amap_common.zeroed = NULL;
+	amap_common.nzeroed = 0;
+	hal_spinlockClear(&amap_common.zerosl, &sc);
+
+	while (pool != NULL) {
+		p = pool;
+		LIST_REMOVE(&pool, p);
+		vm_pageFree(p);
+	}
+
+	return n;
+}
+#endif
+
+
 void _amap_init(vm_map_t *kmap, vm_object_t *kernel)
 {
 	amap_common.kmap = kmap;
 	amap_common.kernel = kernel;
+	amap_common.anons = vm_kmemCacheCreate("anon", sizeof(anon_t), 0, NULL);
+
+#ifndef NOMMU
+	hal_spinlockCreate(&amap_common.zerosl, "amap_common.zerosl");
+	amap_common.zeroed = NULL;
+	amap_common.nzeroed = 0;
+	amap_common.zeroq = NULL;
+	amap_common.zeroer = 0;
+#endif
+}
+
+
+void _amap_start(void)
+{
+#ifndef NOMMU
+	(void)proc_threadCreate(NULL, amap_zerothr, NULL, 6, (size_t)SIZE_KSTACK, NULL, 0, 0, NULL);
+#endif
 }
@@ -59,7 +59,17 @@ void amap_put(amap_t *amap);
 amap_t *amap_ref(amap_t *amap);
 
 
+#ifndef NOMMU
+/* Frees pre-zeroed pages back to the allocator, returns number of pages freed */
+size_t amap_zeroRelease(void);
+#endif
+
+
 void _amap_init(struct _vm_map_t *kmap, struct _vm_object_t *kernel);
 
 
+/* Starts background page zeroing */
+void _amap_start(void);
+
+
 #endif
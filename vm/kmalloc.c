@@ -17,306 +17,777 @@
 #include "hal/hal.h"
 #include "lib/lib.h"
 #include "map.h"
-#include "zone.h"
+#include "page.h"
+#include "kmalloc.h"
 #include "include/errno.h"
 #include "proc/proc.h"
 
 
+#define KMALLOC_MAGSZ   16U /* Objects held per CPU magazine */
+#define KMALLOC_CACHES  18U
+#define KMALLOC_MAXSZ   2048U
+#define KMALLOC_ALIGN   8U
+#define KMALLOC_NOCACHE 0xffU
+
+#define KMALLOC_SLABORDER  2U    /* Sizes not fitting a page twice use slabs of 1 << order pages */
+#define KMALLOC_ARENASLOTS 2048U /* Max multi-page slabs */
+#define KMALLOC_ARENADIV   16U   /* Arena spans at most 1/16 of memory */
+
+
+/* Slab descriptor, placed at the beginning of a slab, objects never start at page boundary */
+typedef struct _kmalloc_slab_t {
+	struct _kmalloc_slab_t *next;
+	struct _kmalloc_slab_t *prev;
+
+	struct _vm_kmemcache_t *cache;
+	page_t *pages;
+	void *first;
+	unsigned int used;
+} kmalloc_slab_t;
+
+
+/* Page aligned allocation above the largest cache size */
+typedef struct {
+	rbnode_t linkage;
+	void *vaddr;
+	page_t *pages;
+	size_t size;
+} kmalloc_large_t;
+
+
+typedef struct {
+	spinlock_t spinlock;
+	unsigned int count;
+	void *objs[KMALLOC_MAGSZ];
+} kmalloc_mag_t;
+
+
+struct _vm_kmemcache_t {
+	struct _vm_kmemcache_t *next;
+	struct _vm_kmemcache_t *prev;
+
+	kmalloc_slab_t *partial;
+	kmalloc_slab_t *full;
+	kmalloc_mag_t *mags;
+
+	size_t objsz;
+	size_t offs; /* First object offset in slab */
+	unsigned int order;
+	unsigned int perslab;
+	unsigned int slabs;
+	unsigned int used;
+	void (*ctor)(void *);
+
+	char name[16];
+	lock_t lock;
+};
+
+
+static const u16 kmalloc_sizes[KMALLOC_CACHES] = {
+	16, 24, 32, 48, 64, 80, 96, 128, 160, 192, 256, 320, 384, 512, 680, 1024, 1360, 2048
+};
+
+
 static struct {
-	vm_zone_t *sizes[24];
-	vm_zone_t *used;
-	vm_zone_t firstzone;
+	vm_map_t *kmap;
+	vm_object_t *kernel;
 
-	rbtree_t tree;
+	vm_kmemcache_t caches[KMALLOC_CACHES];
+	unsigned int ncaches;
+	u8 index[KMALLOC_MAXSZ / KMALLOC_ALIGN + 1U]; /* Size (in KMALLOC_ALIGN units) to cache */
 
-	unsigned int hdrblocks;
-	size_t allocsz;
+	vm_kmemcache_t *list; /* All caches, including kmalloc ones */
+	unsigned int nlist;
+	unsigned int ncpus;
 
-	unsigned int zonehdrs;
+	rbtree_t large;
+	size_t largesz;
 	lock_t lock;
+
+	/* Kernel space reserved for multi-page slabs, aligned slab is found by address */
+	void *arena;
+	unsigned int nslots;
+	u32 slots[KMALLOC_ARENASLOTS / 32U];
 } kmalloc_common;
 
 
-static int kmalloc_zone_cmp(rbnode_t *n1, rbnode_t *n2)
+static int kmalloc_large_cmp(rbnode_t *n1, rbnode_t *n2)
 {
-	vm_zone_t *z1 = lib_treeof(vm_zone_t, linkage, n1);
-	vm_zone_t *z2 = lib_treeof(vm_zone_t, linkage, n2);
+	kmalloc_large_t *l1 = lib_treeof(kmalloc_large_t, linkage, n1);
+	kmalloc_large_t *l2 = lib_treeof(kmalloc_large_t, linkage, n2);
 
-	/* parasoft-suppress-next-line MISRAC2012-DIR_4_1 "Variable pass to lib_treeof will not be NULL, so lib_treeof will not be NULL either" */
-	if ((ptr_t)z1->vaddr > (ptr_t)z2->vaddr) {
+	if ((ptr_t)l1->vaddr > (ptr_t)l2->vaddr) {
 		return 1;
 	}
+	if ((ptr_t)l1->vaddr < (ptr_t)l2->vaddr) {
+		return -1;
+	}
 
-	if (((ptr_t)z2->vaddr >= (ptr_t)z1->vaddr) && ((ptr_t)z2->vaddr < (ptr_t)z1->vaddr + z1->blocks * z1->blocksz)) {
-		return 0;
+	return 0;
+}
+
+
+static kmalloc_slab_t *kmalloc_slabOf(void *p)
+{
+	ptr_t a = (ptr_t)kmalloc_common.arena;
+	size_t slabsz = (size_t)SIZE_PAGE << KMALLOC_SLABORDER;
+
+	if ((a != 0U) && ((ptr_t)p >= a) && ((ptr_t)p < (a + kmalloc_common.nslots * slabsz))) {
+		return (kmalloc_slab_t *)(a + (((ptr_t)p - a) & ~((ptr_t)slabsz - 1U)));
 	}
-	if (((ptr_t)z1->vaddr >= (ptr_t)z2->vaddr) && ((ptr_t)z1->vaddr < (ptr_t)z2->vaddr + z2->blocks * z2->blocksz)) {
-		return 0;
+
+	return (kmalloc_slab_t *)((ptr_t)p & ~((ptr_t)SIZE_PAGE - 1U));
+}
+
+
+static void *kmalloc_pagesMap(size_t size, page_t **pages)
+{
+	void *v;
+
+	*pages = vm_pageAlloc(size, PAGE_OWNER_KERNEL | PAGE_KERNEL_HEAP);
+	if (*pages == NULL) {
+		return NULL;
 	}
 
-	return -1;
+	v = vm_mmap(kmalloc_common.kmap, kmalloc_common.kmap->start, *pages, (size_t)1U << (*pages)->idx, PROT_READ | PROT_WRITE, kmalloc_common.kernel, -1, MAP_NONE);
+	if (v == NULL) {
+		vm_pageFree(*pages);
+	}
+
+	return v;
 }
 
 
-static void *_kmalloc_alloc(u8 hdridx, u8 idx)
+static int kmalloc_pagesUnmap(void *v, page_t *pages)
 {
-	void *b;
-	vm_zone_t *z = kmalloc_common.sizes[idx];
+	int err;
 
-	b = _vm_zalloc(z, NULL);
-	if (b != NULL) {
-		kmalloc_common.allocsz += (1UL << idx);
+	/* Pages are freed only once they are no longer mapped */
+	err = vm_munmap(kmalloc_common.kmap, v, (size_t)1U << pages->idx);
+	if (err == EOK) {
+		vm_pageFree(pages);
+	}
 
-		if (idx == hdridx) {
-			kmalloc_common.hdrblocks--;
+	return err;
+}
+
+
+static void *kmalloc_arenaMap(page_t **pages)
+{
+	size_t slabsz = (size_t)SIZE_PAGE << KMALLOC_SLABORDER, k;
+	unsigned int i, n = kmalloc_common.nslots;
+	void *v;
+
+	*pages = vm_pageAlloc(slabsz, PAGE_OWNER_KERNEL | PAGE_KERNEL_HEAP);
+	if (*pages == NULL) {
+		return NULL;
+	}
+
+	(void)proc_lockSet(&kmalloc_common.lock);
+	for (i = 0; i < n; i += 32U) {
+		if (kmalloc_common.slots[i / 32U] != 0xffffffffU) {
+			i += hal_cpuGetFirstBit(~kmalloc_common.slots[i / 32U]);
+			break;
 		}
+	}
+	if (i < n) {
+		kmalloc_common.slots[i / 32U] |= 1UL << (i % 32U);
+	}
+	(void)proc_lockClear(&kmalloc_common.lock);
+
+	if (i >= n) {
+		vm_pageFree(*pages);
+		return NULL;
+	}
 
-		if (z->used == z->blocks) {
-			LIST_REMOVE(&kmalloc_common.sizes[idx], z);
-			LIST_ADD(&kmalloc_common.used, z);
+	v = kmalloc_common.arena + i * slabsz;
+	for (k = 0; k < slabsz / SIZE_PAGE; k++) {
+		if (page_map(&kmalloc_common.kmap->pmap, v + k * SIZE_PAGE, (*pages)[k].addr, PGHD_READ | PGHD_WRITE | PGHD_PRESENT) < 0) {
+			break;
 		}
 	}
 
-	return b;
+	if (k < slabsz / SIZE_PAGE) {
+		(void)pmap_remove(&kmalloc_common.kmap->pmap, v, v + k * SIZE_PAGE);
+		vm_pageFree(*pages);
+
+		(void)proc_lockSet(&kmalloc_common.lock);
+		kmalloc_common.slots[i / 32U] &= ~(1UL << (i % 32U));
+		(void)proc_lockClear(&kmalloc_common.lock);
+
+		return NULL;
+	}
+
+	return v;
 }
 
 
-static vm_zone_t *_kmalloc_free(u8 hdridx, void *p)
+static void kmalloc_arenaUnmap(void *v, page_t *pages)
 {
-	vm_zone_t t;
-	vm_zone_t *z;
-	u8 idx;
+	size_t slabsz = (size_t)SIZE_PAGE << KMALLOC_SLABORDER;
+	unsigned int i = (unsigned int)(((ptr_t)v - (ptr_t)kmalloc_common.arena) / slabsz);
 
-	/* Free block */
-	t.vaddr = p;
-	t.blocks = 1;
-	t.blocksz = 16;
+	(void)pmap_remove(&kmalloc_common.kmap->pmap, v, v + slabsz);
+	vm_pageFree(pages);
 
-	z = lib_treeof(vm_zone_t, linkage, lib_rbFind(&kmalloc_common.tree, &t.linkage));
-	if (z == NULL) {
-		return NULL;
-	}
+	(void)proc_lockSet(&kmalloc_common.lock);
+	kmalloc_common.slots[i / 32U] &= ~(1UL << (i % 32U));
+	(void)proc_lockClear(&kmalloc_common.lock);
+}
 
-	_vm_zfree(z, p);
-	kmalloc_common.allocsz -= z->blocksz;
 
-	idx = (u8)hal_cpuGetLastBit(z->blocksz);
-	if (idx == hdridx) {
-		kmalloc_common.hdrblocks++;
+static int _kmalloc_slabAdd(vm_kmemcache_t *cache)
+{
+	kmalloc_slab_t *slab;
+	page_t *pages;
+	unsigned int i;
+	void *b;
+
+	slab = (cache->order != 0U) ? kmalloc_arenaMap(&pages) : kmalloc_pagesMap(SIZE_PAGE, &pages);
+	if (slab == NULL) {
+		return -ENOMEM;
 	}
 
-	/* Remove zone from used list */
-	if (z->used == z->blocks - 1U) {
-		LIST_REMOVE(&kmalloc_common.used, z);
-		LIST_ADD(&kmalloc_common.sizes[idx], z);
+	slab->cache = cache;
+	slab->pages = pages;
+	slab->used = 0;
+
+	/* Prepare slab for allocations */
+	b = (void *)slab + cache->offs;
+	slab->first = b;
+	for (i = 1; i < cache->perslab; i++) {
+		*((void **)b) = b + cache->objsz;
+		b += cache->objsz;
 	}
+	*((void **)b) = NULL;
+
+	LIST_ADD(&cache->partial, slab);
+	cache->slabs++;
 
-	return z;
+	return EOK;
 }
 
 
-static int _kmalloc_addZone(u8 hdridx, u8 idx)
+static void *_kmalloc_slabAlloc(vm_kmemcache_t *cache)
 {
-	vm_zone_t *nz;
-	size_t blocksz;
-	unsigned int blocks;
+	kmalloc_slab_t *slab;
+	void *b;
 
-	nz = _kmalloc_alloc(hdridx, hdridx);
-	if (nz == NULL) {
-		return -ENOMEM;
+	if ((cache->partial == NULL) && (_kmalloc_slabAdd(cache) < 0)) {
+		return NULL;
 	}
 
-	/* Add new zone */
-	blocksz = 0x1UL << idx;
-	blocks = (unsigned int)max(((idx == hdridx) ? kmalloc_common.zonehdrs : 1UL), SIZE_PAGE / blocksz);
-	if (_vm_zoneCreate(nz, blocksz, blocks) < 0) {
-		(void)_kmalloc_free(hdridx, nz);
-		return -ENOMEM;
+	slab = cache->partial;
+	b = slab->first;
+	slab->first = *((void **)b);
+	slab->used++;
+	cache->used++;
+
+	if (slab->used == cache->perslab) {
+		LIST_REMOVE(&cache->partial, slab);
+		LIST_ADD(&cache->full, slab);
 	}
 
-	LIST_ADD(&kmalloc_common.sizes[idx], nz);
-	(void)lib_rbInsert(&kmalloc_common.tree, &nz->linkage);
+	return b;
+}
+
 
-	if (idx == hdridx) {
-		kmalloc_common.hdrblocks += nz->blocks;
+static void _kmalloc_slabFree(vm_kmemcache_t *cache, void *b)
+{
+	kmalloc_slab_t *slab = kmalloc_slabOf(b);
+
+	if (slab->used == cache->perslab) {
+		LIST_REMOVE(&cache->full, slab);
+		LIST_ADD(&cache->partial, slab);
 	}
 
-	return EOK;
+	*((void **)b) = slab->first;
+	slab->first = b;
+	slab->used--;
+	cache->used--;
+
+	/* Keep the last slab to avoid thrashing */
+	if ((slab->used == 0U) && (cache->slabs > 1U)) {
+		LIST_REMOVE(&cache->partial, slab);
+		cache->slabs--;
+		if (cache->order != 0U) {
+			kmalloc_arenaUnmap(slab, slab->pages);
+		}
+		else if (kmalloc_pagesUnmap(slab, slab->pages) < 0) {
+			/* Keep the empty slab if the kernel map can't be changed */
+			LIST_ADD(&cache->partial, slab);
+			cache->slabs++;
+		}
+		else {
+			/* No action required */
+		}
+	}
 }
 
 
-void *vm_kmalloc(size_t size)
+static void *kmalloc_cacheAlloc(vm_kmemcache_t *cache)
 {
-	u8 idx, hdridx;
+	kmalloc_mag_t *mag = NULL;
+	void *objs[KMALLOC_MAGSZ / 2U];
+	spinlock_ctx_t sc;
+	unsigned int i, n = 0;
 	void *b = NULL;
-	vm_zone_t *z;
-	int err = EOK;
 
-	/* Establish minimal size */
-	size = size < 16U ? 16U : size;
+	if (cache->mags != NULL) {
+		mag = &cache->mags[hal_cpuGetID() % kmalloc_common.ncpus];
+
+		hal_spinlockSet(&mag->spinlock, &sc);
+		if (mag->count != 0U) {
+			b = mag->objs[--mag->count];
+		}
+		hal_spinlockClear(&mag->spinlock, &sc);
 
-	idx = (u8)hal_cpuGetLastBit(size);
-	/* parasoft-begin-suppress MISRAC2012-RULE_14_3 "conditional compilation" */
-	if ((u8)hal_cpuGetFirstBit(size) < idx) {
-		idx++;
+		if (b != NULL) {
+			return b;
+		}
 	}
-	if (idx >= sizeof(kmalloc_common.sizes) / sizeof(vm_zone_t *)) {
+
+	/* Refill magazine with a batch, one of the objects is returned */
+	(void)proc_lockSet(&cache->lock);
+	do {
+		objs[n] = _kmalloc_slabAlloc(cache);
+		if (objs[n] == NULL) {
+			break;
+		}
+		n++;
+	} while ((mag != NULL) && (n < KMALLOC_MAGSZ / 2U));
+	(void)proc_lockClear(&cache->lock);
+
+	if (n == 0U) {
 		return NULL;
 	}
-	/* parasoft-end-suppress MISRAC2012-RULE_14_3 */
 
-	hdridx = (u8)hal_cpuGetLastBit(sizeof(vm_zone_t));
-	if ((u8)hal_cpuGetFirstBit(sizeof(vm_zone_t)) < hdridx) {
-		hdridx++;
+	b = objs[--n];
+
+	if (n != 0U) {
+		hal_spinlockSet(&mag->spinlock, &sc);
+		while ((n != 0U) && (mag->count < KMALLOC_MAGSZ)) {
+			mag->objs[mag->count++] = objs[--n];
+		}
+		hal_spinlockClear(&mag->spinlock, &sc);
+
+		/* Magazine filled up in the meantime */
+		if (n != 0U) {
+			(void)proc_lockSet(&cache->lock);
+			for (i = 0; i < n; i++) {
+				_kmalloc_slabFree(cache, objs[i]);
+			}
+			(void)proc_lockClear(&cache->lock);
+		}
+	}
+
+	return b;
+}
+
+
+static void kmalloc_cacheFree(vm_kmemcache_t *cache, void *b)
+{
+	kmalloc_mag_t *mag;
+	void *objs[KMALLOC_MAGSZ / 2U];
+	spinlock_ctx_t sc;
+	unsigned int i, n = 0;
+
+	if (cache->mags != NULL) {
+		mag = &cache->mags[hal_cpuGetID() % kmalloc_common.ncpus];
+
+		hal_spinlockSet(&mag->spinlock, &sc);
+		if (mag->count == KMALLOC_MAGSZ) {
+			/* Flush the older half of the magazine */
+			for (n = 0; n < KMALLOC_MAGSZ / 2U; n++) {
+				objs[n] = mag->objs[n];
+				mag->objs[n] = mag->objs[n + KMALLOC_MAGSZ / 2U];
+			}
+			mag->count -= n;
+		}
+		mag->objs[mag->count++] = b;
+		hal_spinlockClear(&mag->spinlock, &sc);
+
+		if (n == 0U) {
+			return;
+		}
+	}
+	else {
+		objs[n++] = b;
+	}
+
+	(void)proc_lockSet(&cache->lock);
+	for (i = 0; i < n; i++) {
+		_kmalloc_slabFree(cache, objs[i]);
+	}
+	(void)proc_lockClear(&cache->lock);
+}
+
+
+static void *kmalloc_large(size_t size)
+{
+	kmalloc_large_t *l;
+
+	l = vm_kmalloc(sizeof(*l));
+	if (l == NULL) {
+		return NULL;
 	}
-	if (hdridx >= sizeof(kmalloc_common.sizes) / sizeof(vm_zone_t *)) {
+
+	l->vaddr = kmalloc_pagesMap(size, &l->pages);
+	if (l->vaddr == NULL) {
+		vm_kfree(l);
 		return NULL;
 	}
+	l->size = (size_t)1U << l->pages->idx;
 
 	(void)proc_lockSet(&kmalloc_common.lock);
+	(void)lib_rbInsert(&kmalloc_common.large, &l->linkage);
+	kmalloc_common.largesz += l->size;
+	(void)proc_lockClear(&kmalloc_common.lock);
 
-	if (kmalloc_common.hdrblocks == 1U) {
-		err = _kmalloc_addZone(hdridx, hdridx);
+	return l->vaddr;
+}
+
+
+static void kmalloc_largeFree(void *p)
+{
+	kmalloc_large_t t, *l;
+
+	t.vaddr = p;
+
+	(void)proc_lockSet(&kmalloc_common.lock);
+	l = lib_treeof(kmalloc_large_t, linkage, lib_rbFind(&kmalloc_common.large, &t.linkage));
+	if (l != NULL) {
+		lib_rbRemove(&kmalloc_common.large, &l->linkage);
+		kmalloc_common.largesz -= l->size;
 	}
+	(void)proc_lockClear(&kmalloc_common.lock);
 
-	if (err == 0) {
-		z = kmalloc_common.sizes[idx];
-		if (z == NULL) {
-			err = _kmalloc_addZone(hdridx, idx);
+	if (l != NULL) {
+		if (kmalloc_pagesUnmap(l->vaddr, l->pages) < 0) {
+			/* Pages stay mapped and are lost, freeing them would leave them accessible */
+			lib_printf("kmalloc: can't unmap %p (%zu bytes)\n", l->vaddr, l->size);
 		}
+		vm_kfree(l);
+	}
+}
+
+
+void *vm_kmalloc(size_t size)
+{
+	u8 idx;
+	void *b;
+
+	/* Establish minimal size */
+	size = (size < 16U) ? 16U : size;
+
+	if (size > KMALLOC_MAXSZ) {
+		return kmalloc_large(size);
 	}
 
-	/* Alloc new fragment */
-	if (err == 0) {
-		b = _kmalloc_alloc(hdridx, idx);
+	idx = kmalloc_common.index[(size + KMALLOC_ALIGN - 1U) / KMALLOC_ALIGN];
+	if (idx == KMALLOC_NOCACHE) {
+		return kmalloc_large(size);
 	}
 
-	(void)proc_lockClear(&kmalloc_common.lock);
+	b = kmalloc_cacheAlloc(&kmalloc_common.caches[idx]);
+
+	/* Arena is full or multi-page blocks are fragmented */
+	if ((b == NULL) && (kmalloc_common.caches[idx].order != 0U)) {
+		b = kmalloc_large(size);
+	}
 
 	return b;
 }
 
 
-static void *_kmalloc_freeAtom(u8 hdridx, void *p)
+void vm_kfree(void *p)
 {
-	vm_zone_t *z;
-	u8 idx;
+	if (p == NULL) {
+		return;
+	}
+
+	/* Only large allocations are page aligned */
+	if (((ptr_t)p & ((ptr_t)SIZE_PAGE - 1U)) == 0U) {
+		kmalloc_largeFree(p);
+		return;
+	}
+
+	kmalloc_cacheFree(kmalloc_slabOf(p)->cache, p);
+}
+
+
+static void kmalloc_cacheInit(vm_kmemcache_t *cache, const char *name, size_t size, size_t align, unsigned int order, void (*ctor)(void *))
+{
+	align = (align < sizeof(void *)) ? sizeof(void *) : align;
+
+	cache->partial = NULL;
+	cache->full = NULL;
+	cache->mags = NULL;
+	cache->objsz = (size + align - 1U) & ~(align - 1U);
+	cache->offs = (sizeof(kmalloc_slab_t) + align - 1U) & ~(align - 1U);
+	cache->order = order;
+	cache->perslab = 0;
+	if (cache->offs < SIZE_PAGE) {
+		cache->perslab = (unsigned int)((((size_t)SIZE_PAGE << order) - cache->offs) / cache->objsz);
+	}
+	cache->slabs = 0;
+	cache->used = 0;
+	cache->ctor = ctor;
+
+	hal_strncpy(cache->name, name, sizeof(cache->name));
+	cache->name[sizeof(cache->name) - 1U] = '\0';
+	(void)proc_lockInit(&cache->lock, &proc_lockAttrDefault, "kmalloc.cache");
+}
+
+
+static void kmalloc_cacheMags(vm_kmemcache_t *cache)
+{
+	kmalloc_mag_t *mags;
+	unsigned int i;
+
+	mags = vm_kmalloc(sizeof(kmalloc_mag_t) * kmalloc_common.ncpus);
+	if (mags == NULL) {
+		return;
+	}
+
+	for (i = 0; i < kmalloc_common.ncpus; i++) {
+		hal_spinlockCreate(&mags[i].spinlock, "kmalloc.mag");
+		mags[i].count = 0;
+	}
+
+	cache->mags = mags;
+}
+
+
+static void kmalloc_cacheRegister(vm_kmemcache_t *cache)
+{
+	(void)proc_lockSet(&kmalloc_common.lock);
+	LIST_ADD(&kmalloc_common.list, cache);
+	kmalloc_common.nlist++;
+	(void)proc_lockClear(&kmalloc_common.lock);
+}
 
-	z = _kmalloc_free(hdridx, p);
-	if (z == NULL) {
+
+vm_kmemcache_t *vm_kmemCacheCreate(const char *name, size_t size, size_t align, void (*ctor)(void *))
+{
+	vm_kmemcache_t *cache;
+
+	/* Alignment has to be a power of 2 */
+	if ((size == 0U) || ((align & (align - 1U)) != 0U)) {
 		return NULL;
 	}
 
-	idx = (u8)hal_cpuGetLastBit(z->blocksz);
+	cache = vm_kmalloc(sizeof(*cache));
+	if (cache == NULL) {
+		return NULL;
+	}
 
-	/* Remove zone if free */
-	if ((z->used == 0U) && (z != &kmalloc_common.firstzone)) {
-		LIST_REMOVE(&kmalloc_common.sizes[idx], z);
-		(void)_vm_zoneDestroy(z);
-		lib_rbRemove(&kmalloc_common.tree, &z->linkage);
+	kmalloc_cacheInit(cache, name, size, align, 0, ctor);
 
-		if (idx == hdridx) {
-			kmalloc_common.hdrblocks -= z->blocks;
-		}
-		return z;
+	/* Objects not fitting twice in a slab are served by vm_kmalloc() */
+	if (cache->perslab < 2U) {
+		cache->perslab = 0;
 	}
+	else {
+		kmalloc_cacheMags(cache);
+	}
+
+	kmalloc_cacheRegister(cache);
 
-	return NULL;
+	return cache;
 }
 
 
-void vm_kfree(void *p)
+void *vm_kmemCacheAlloc(vm_kmemcache_t *cache)
 {
-	u8 hdridx;
+	void *b;
 
-	hdridx = (u8)hal_cpuGetLastBit(sizeof(vm_zone_t));
-	/* parasoft-begin-suppress MISRAC2012-RULE_14_3 "conditional compilation" */
-	if ((u8)hal_cpuGetFirstBit(sizeof(vm_zone_t)) < hdridx) {
-		hdridx++;
+	if (cache->perslab == 0U) {
+		b = vm_kmalloc(cache->objsz);
 	}
-	if (hdridx >= sizeof(kmalloc_common.sizes) / sizeof(vm_zone_t *)) {
+	else {
+		b = kmalloc_cacheAlloc(cache);
+	}
+
+	if ((b != NULL) && (cache->ctor != NULL)) {
+		cache->ctor(b);
+	}
+
+	return b;
+}
+
+
+void vm_kmemCacheFree(vm_kmemcache_t *cache, void *p)
+{
+	if ((p == NULL) || (cache->perslab == 0U)) {
+		vm_kfree(p);
 		return;
 	}
-	/* parasoft-end-suppress MISRAC2012-RULE_14_3 */
 
-	(void)proc_lockSet(&kmalloc_common.lock);
+	kmalloc_cacheFree(cache, p);
+}
 
-	while (p != NULL) {
-		p = _kmalloc_freeAtom(hdridx, p);
+
+static void kmalloc_cacheStats(vm_kmemcache_t *cache, kcacheinfo_t *info)
+{
+	unsigned int i;
+
+	hal_strncpy(info->name, cache->name, sizeof(info->name));
+	info->name[sizeof(info->name) - 1U] = '\0';
+	info->objsz = (unsigned int)cache->objsz;
+	info->slabs = cache->slabs;
+	info->total = cache->slabs * cache->perslab;
+	info->used = cache->used;
+	info->cached = 0;
+
+	/* Read without locks, used for statistics only */
+	if (cache->mags != NULL) {
+		for (i = 0; i < kmalloc_common.ncpus; i++) {
+			info->cached += cache->mags[i].count;
+		}
 	}
+}
+
+
+unsigned int vm_kmallocCacheStats(kcacheinfo_t *info, unsigned int n)
+{
+	vm_kmemcache_t *cache;
+	unsigned int i = 0;
 
+	(void)proc_lockSet(&kmalloc_common.lock);
+	cache = kmalloc_common.list;
+	while ((cache != NULL) && (i < n)) {
+		kmalloc_cacheStats(cache, &info[i++]);
+		cache = (cache->next == kmalloc_common.list) ? NULL : cache->next;
+	}
+	n = kmalloc_common.nlist;
 	(void)proc_lockClear(&kmalloc_common.lock);
+
+	return n;
 }
 
 
 void vm_kmallocGetStats(size_t *allocsz)
 {
-	*allocsz = kmalloc_common.allocsz;
+	vm_kmemcache_t *cache;
+	kcacheinfo_t info;
+
+	(void)proc_lockSet(&kmalloc_common.lock);
+	*allocsz = kmalloc_common.largesz;
+
+	cache = kmalloc_common.list;
+	while (cache != NULL) {
+		kmalloc_cacheStats(cache, &info);
+		*allocsz += (size_t)(info.used - info.cached) * info.objsz;
+		cache = (cache->next == kmalloc_common.list) ? NULL : cache->next;
+	}
+	(void)proc_lockClear(&kmalloc_common.lock);
 }
 
 
 void vm_kmallocDump(void)
 {
-	unsigned int i;
-	vm_zone_t *z;
+	vm_kmemcache_t *cache;
+	kcacheinfo_t info;
 
-	for (i = 0; i < sizeof(kmalloc_common.sizes) / sizeof(vm_zone_t *); i++) {
-		lib_printf("sizes[%d]=", i);
-		z = kmalloc_common.sizes[i];
+	(void)proc_lockSet(&kmalloc_common.lock);
+	cache = kmalloc_common.list;
+	while (cache != NULL) {
+		kmalloc_cacheStats(cache, &info);
+		lib_printf("%s: slabs=%u used=%u/%u cached=%u\n", info.name, info.slabs, info.used, info.total, info.cached);
+		cache = (cache->next == kmalloc_common.list) ? NULL : cache->next;
+	}
+
+	lib_printf("kmalloc-large: %u\n", kmalloc_common.largesz);
+	(void)proc_lockClear(&kmalloc_common.lock);
+}
 
-		if (z != NULL) {
-			do {
-				lib_printf("%p(%d/%d) ", z, z->used, z->blocks);
-				z = z->next;
-			} while (z != kmalloc_common.sizes[i]);
-		}
 
-		lib_printf("\n");
+static void kmalloc_arenaInit(void)
+{
+#ifndef NOMMU
+	size_t slabsz = (size_t)SIZE_PAGE << KMALLOC_SLABORDER, freesz;
+	unsigned int n;
+
+	vm_pageGetStats(&freesz);
+	n = (unsigned int)min(freesz / KMALLOC_ARENADIV / slabsz, (size_t)KMALLOC_ARENASLOTS);
+
+	/* Only reserved, slab pages are mapped on demand */
+	if (n != 0U) {
+		kmalloc_common.arena = vm_mapFind(kmalloc_common.kmap, kmalloc_common.kmap->start, n * slabsz, MAP_NONE, PROT_READ | PROT_WRITE);
+	}
+	if (kmalloc_common.arena != NULL) {
+		kmalloc_common.nslots = n;
 	}
+#endif
 }
 
 
-int _kmalloc_init(void)
+int _kmalloc_init(vm_map_t *kmap, vm_object_t *kernel)
 {
-	unsigned int hdridx, i;
-	size_t blocksz;
-	unsigned int blocks;
+	unsigned int i, j;
+	vm_kmemcache_t *cache;
+	char name[16];
 
 	lib_printf("vm: Initializing kernel memory allocator: ");
 
 	(void)proc_lockInit(&kmalloc_common.lock, &proc_lockAttrDefault, "kmalloc.common");
 
-	hdridx = hal_cpuGetLastBit(sizeof(vm_zone_t));
-	if (hal_cpuGetFirstBit(sizeof(vm_zone_t)) < hdridx) {
-		hdridx++;
-	}
-	if (hdridx >= sizeof(kmalloc_common.sizes) / sizeof(vm_zone_t *)) {
-		lib_printf("BAD HDRIDX!\n");
-		return -1;
-	}
+	kmalloc_common.kmap = kmap;
+	kmalloc_common.kernel = kernel;
+	kmalloc_common.largesz = 0;
+	lib_rbInit(&kmalloc_common.large, kmalloc_large_cmp, NULL);
+	kmalloc_common.list = NULL;
+	kmalloc_common.nlist = 0;
+	kmalloc_common.ncaches = 0;
+	kmalloc_common.ncpus = hal_cpuGetCount();
+	kmalloc_common.arena = NULL;
+	kmalloc_common.nslots = 0;
+	hal_memset(kmalloc_common.slots, 0, sizeof(kmalloc_common.slots));
+
+	/* Initialize caches, sizes holding less than two objects per page need multi-page slabs */
+	for (i = 0; i < KMALLOC_CACHES; i++) {
+		cache = &kmalloc_common.caches[i];
+
+		(void)lib_sprintf(name, "kmalloc-%u", kmalloc_sizes[i]);
+		kmalloc_cacheInit(cache, name, kmalloc_sizes[i], KMALLOC_ALIGN, 0, NULL);
+		if (cache->perslab < 2U) {
+			break;
+		}
 
-	/* Initialize sizes */
-	for (i = 0; i < sizeof(kmalloc_common.sizes) / sizeof(vm_zone_t *); i++) {
-		kmalloc_common.sizes[i] = NULL;
+		kmalloc_cacheRegister(cache);
+		kmalloc_common.ncaches++;
 	}
-	kmalloc_common.used = NULL;
 
-	/* Initialize allocated zone tree */
-	lib_rbInit(&kmalloc_common.tree, kmalloc_zone_cmp, NULL);
+	/* Remaining sizes use multi-page slabs, offset of slab header keeps objects off page boundaries */
+	kmalloc_arenaInit();
+	for (; (kmalloc_common.arena != NULL) && (i < KMALLOC_CACHES); i++) {
+		cache = &kmalloc_common.caches[i];
 
-	kmalloc_common.zonehdrs = 16;
+		(void)lib_sprintf(name, "kmalloc-%u", kmalloc_sizes[i]);
+		kmalloc_cacheInit(cache, name, kmalloc_sizes[i], KMALLOC_ALIGN, KMALLOC_SLABORDER, NULL);
+		if (cache->perslab < 2U) {
+			break;
+		}
 
-	/* Add first zone_t zone */
-	blocksz = 0x1UL << hdridx;
-	blocks = (unsigned int)max(kmalloc_common.zonehdrs, SIZE_PAGE / blocksz);
-	(void)_vm_zoneCreate(&kmalloc_common.firstzone, blocksz, blocks);
-	LIST_ADD(&kmalloc_common.sizes[hdridx], &kmalloc_common.firstzone);
-	(void)lib_rbInsert(&kmalloc_common.tree, &kmalloc_common.firstzone.linkage);
+		kmalloc_cacheRegister(cache);
+		kmalloc_common.ncaches++;
+	}
 
-	kmalloc_common.allocsz = 0;
-	kmalloc_common.hdrblocks = kmalloc_common.firstzone.blocks;
+	/* Build size to cache index */
+	for (i = 0, j = 0; i < sizeof(kmalloc_common.index); i++) {
+		while ((j < kmalloc_common.ncaches) && (kmalloc_sizes[j] < i * KMALLOC_ALIGN)) {
+			j++;
+		}
+		kmalloc_common.index[i] = (j < kmalloc_common.ncaches) ? (u8)j : KMALLOC_NOCACHE;
+	}
+
+	/* Enable per CPU magazines, allocated from the caches themselves */
+	for (i = 0; i < kmalloc_common.ncaches; i++) {
+		kmalloc_cacheMags(&kmalloc_common.caches[i]);
+	}
 
-	lib_printf("(%d*%d) %d\n", kmalloc_common.hdrblocks, sizeof(vm_zone_t), kmalloc_common.hdrblocks * sizeof(vm_zone_t));
+	lib_printf("%d caches, (%d*%d)\n", kmalloc_common.ncaches, kmalloc_common.ncpus, KMALLOC_MAGSZ);
 
 	return 0;
 }
@@ -17,6 +17,15 @@
 #define _PH_VM_KMALLOC_H_
 
 #include "hal/hal.h"
+#include "include/sysinfo.h"
+#include "map.h"
+
+
+/* Alignment for objects accessed on hot paths */
+#define VM_KMEM_CACHELINE 64U
+
+
+typedef struct _vm_kmemcache_t vm_kmemcache_t;
 
 
 void *vm_kmalloc(size_t size);
@@ -25,13 +34,27 @@ void *vm_kmalloc(size_t size);
 void vm_kfree(void *p);
 
 
+/* Creates cache of objects with fixed size and alignment, ctor (if not NULL) initializes every allocated object */
+vm_kmemcache_t *vm_kmemCacheCreate(const char *name, size_t size, size_t align, void (*ctor)(void *));
+
+
+void *vm_kmemCacheAlloc(vm_kmemcache_t *cache);
+
+
+void vm_kmemCacheFree(vm_kmemcache_t *cache, void *p);
+
+
 void vm_kmallocGetStats(size_t *allocsz);
 
 
+/* Fills up to n entries with per cache statistics, returns number of caches */
+unsigned int vm_kmallocCacheStats(kcacheinfo_t *info, unsigned int n);
+
+
 void vm_kmallocDump(void);
 
 
-int _kmalloc_init(void);
+int _kmalloc_init(vm_map_t *kmap, vm_object_t *kernel);
 
 
 #endif
@@ -24,6 +24,16 @@
 #include "vm/types.h"
 
 
+#define MAP_POOL_BOOT    128U /* Max entries taken from kernel heap before caches are available */
+#define MAP_POOL_RESERVE 16U  /* Free entries usable only by kernel map */
+#define MAP_POOL_LOW     32U
+#define MAP_POOL_HIGH    128U
+#define MAP_POOL_BATCH   32U
+
+#define MAP_FAULT_AROUND 16U /* Max resident object pages mapped around a read fault, power of 2 */
+#define MAP_INFO_BATCH   8U  /* Entry records gathered under map lock at once */
+
+
 /* parasoft-suppress-next-line MISRAC2012-RULE_8_6 "Definition in assembly code" */
 extern unsigned int __bss_start;
 
@@ -34,18 +44,32 @@ static struct {
 	lock_t lock;
 
 	size_t ntotal, nfree;
-	map_entry_t *free;
+	map_entry_t *free;    /* Entries from cache */
+	map_entry_t *reserve; /* Entries from boot pool */
 	map_entry_t *entries;
+	size_t nentries;
+
+	vm_kmemcache_t *cache;
+	int busy; /* Pool is being filled or trimmed */
+	thread_t *fillq;
 
 	vm_map_t **maps;
 	size_t mapssz;
+
+	size_t faultAround;
 } map_common;
 
 
-static map_entry_t *map_alloc(void);
+static map_entry_t *map_alloc(vm_map_t *map);
+
 
+static map_entry_t *map_allocN(vm_map_t *map, size_t n);
 
-static map_entry_t *map_allocN(size_t n);
+
+static void map_poolFill(size_t n, int wait);
+
+
+static void map_poolTrim(void);
 
 
 void map_free(map_entry_t *entry);
@@ -54,6 +78,11 @@ void map_free(map_entry_t *entry);
 static int _map_force(vm_map_t *map, map_entry_t *e, void *paddr, vm_prot_t prot);
 
 
+#ifdef SIZE_LARGEPAGE
+static int _map_large(vm_map_t *map, map_entry_t *e, void *vaddr, addr_t *pa);
+#endif
+
+
 static int map_cmp(rbnode_t *n1, rbnode_t *n2)
 {
 	map_entry_t *e1 = lib_treeof(map_entry_t, linkage, n1);
@@ -144,6 +173,8 @@ static int _map_add(process_t *p, vm_map_t *map, map_entry_t *entry)
 #endif
 
 	entry->map = map;
+	vm_objectLink(entry->object, entry);
+
 	return lib_rbInsert(&map->tree, &entry->linkage);
 }
 
@@ -160,6 +191,7 @@ static void _map_remove(vm_map_t *map, map_entry_t *entry)
 	entry->process = NULL;
 #endif
 
+	vm_objectUnlink(entry->object, entry);
 	lib_rbRemove(&map->tree, &entry->linkage);
 	entry->map = NULL;
 }
@@ -167,13 +199,89 @@ static void _map_remove(vm_map_t *map, map_entry_t *entry)
 
 static void _entry_put(vm_map_t *map, map_entry_t *e)
 {
+	/* Unlink from object before it can be released */
+	_map_remove(map, e);
 	amap_put(e->amap);
 	(void)vm_objectPut(e->object);
-	_map_remove(map, e);
 	map_free(e);
 }
 
 
+/* Checks if r directly follows l and both can be described by a single entry */
+static int _map_mergeable(const map_entry_t *l, const map_entry_t *r)
+{
+	if ((l->vaddr + l->size != r->vaddr) || (l->object != r->object) || (l->flags != r->flags) ||
+			(l->prot != r->prot) || (l->protOrig != r->protOrig)) {
+		return 0;
+	}
+
+#ifdef NOMMU
+	if (l->process != r->process) {
+		return 0;
+	}
+#endif
+
+	if (l->offs == VM_OFFS_MAX) {
+		if (r->offs != VM_OFFS_MAX) {
+			return 0;
+		}
+	}
+	else if (l->offs + l->size != r->offs) {
+		return 0;
+	}
+
+	/* Anons must stay at the same amap slots */
+	if (l->amap != r->amap) {
+		return 0;
+	}
+	if ((l->amap != NULL) && (l->aoffs + l->size != r->aoffs)) {
+		return 0;
+	}
+
+	return 1;
+}
+
+
+/* Merges entry with its neighbours if possible, returns resulting entry */
+static map_entry_t *_map_merge(vm_map_t *map, map_entry_t *e)
+{
+	map_entry_t *prev, *next;
+	size_t size;
+	int merged = 0;
+
+	prev = lib_treeof(map_entry_t, linkage, lib_rbPrev(&e->linkage));
+	if ((prev != NULL) && (_map_mergeable(prev, e) != 0)) {
+		size = e->size;
+		_entry_put(map, e);
+
+		e = prev;
+		e->size += size;
+		map_augment(&e->linkage);
+		merged = 1;
+	}
+
+	next = lib_treeof(map_entry_t, linkage, lib_rbNext(&e->linkage));
+	if ((next != NULL) && (_map_mergeable(e, next) != 0)) {
+		size = next->size;
+		_entry_put(map, next);
+
+		e->size += size;
+		map_augment(&e->linkage);
+		merged = 1;
+	}
+
+	/* Gap of the following entry was computed from the old end of e */
+	if (merged != 0) {
+		next = lib_treeof(map_entry_t, linkage, lib_rbNext(&e->linkage));
+		if (next != NULL) {
+			map_augment(&next->linkage);
+		}
+	}
+
+	return e;
+}
+
+
 static void *_map_find(vm_map_t *map, void *vaddr, size_t size, map_entry_t **prev, map_entry_t **next)
 {
 	map_entry_t *e = lib_treeof(map_entry_t, linkage, map->tree.root);
@@ -259,7 +367,21 @@ static void *_map_map(vm_map_t *map, void *vaddr, process_t *proc, size_t size,
 	}
 #endif
 
+#ifdef SIZE_LARGEPAGE
+	/* Place large page mapping so that virtual and physical addresses are aligned alike */
+	v = NULL;
+	if (((flags & (MAP_LARGEPAGE | MAP_FIXED)) == MAP_LARGEPAGE) && (o != NULL) && (size >= SIZE_LARGEPAGE) && (map != map_common.kmap)) {
+		v = _map_find(map, vaddr, size + SIZE_LARGEPAGE - SIZE_PAGE, &prev, &next);
+		if (v != NULL) {
+			v += ((ptr_t)((offs == VM_OFFS_MAX) ? 0U : offs) - (ptr_t)v) & (SIZE_LARGEPAGE - 1U);
+		}
+	}
+	if (v == NULL) {
+		v = _map_find(map, vaddr, size, &prev, &next);
+	}
+#else
 	v = _map_find(map, vaddr, size, &prev, &next);
+#endif
 	if (v == NULL) {
 		return NULL;
 	}
@@ -351,7 +473,7 @@ static void *_map_map(vm_map_t *map, void *vaddr, process_t *proc, size_t size,
 		map_augment(&e->linkage);
 	}
 	else {
-		e = map_alloc();
+		e = map_alloc(map);
 		if (e == NULL) {
 			return NULL;
 		}
@@ -399,6 +521,10 @@ static void *_map_map(vm_map_t *map, void *vaddr, process_t *proc, size_t size,
 
 void *vm_mapFind(vm_map_t *map, void *vaddr, size_t size, vm_flags_t flags, vm_prot_t prot)
 {
+	if (map == map_common.kmap) {
+		map_poolFill(0, 0);
+	}
+
 	(void)proc_lockSet(&map->lock);
 	vaddr = _map_map(map, vaddr, NULL, size, prot, map_common.kernel, VM_OFFS_MAX, flags, NULL);
 	(void)proc_lockClear(&map->lock);
@@ -508,7 +634,7 @@ int _vm_munmap(vm_map_t *map, void *vaddr, size_t size)
 			map_augment(&e->linkage);
 		}
 		else {
-			s = map_alloc();
+			s = map_alloc(map);
 			/* This case if only possible if an unmapped region is in the middle of a single entry,
 			 * so there is no possibility of partially unmapping. */
 			if (s == NULL) {
@@ -521,11 +647,16 @@ int _vm_munmap(vm_map_t *map, void *vaddr, size_t size)
 
 		/* Perform amap and pmap changes only when we are sure we have enough space to perform corresponding map changes. */
 
+		(void)pmap_remove(&map->pmap, (void *)overlapStart, (void *)overlapEnd);
+
+#ifndef NOMMU
+		/* Cached message windows must not outlive source pages */
+		msg_mapInvalidate(map, (void *)overlapStart, overlapSize);
+#endif
+
 		/* Note: what if NEEDS_COPY? */
 		amap_putanons(e->amap, eAoffs + overlapEOffset, overlapSize);
 
-		(void)pmap_remove(&map->pmap, (void *)overlapStart, (void *)overlapEnd);
-
 		if (putEntry != 0) {
 			_entry_put(map, e);
 		}
@@ -577,6 +708,9 @@ void *_vm_mmap(vm_map_t *map, void *vaddr, page_t *p, size_t size, vm_prot_t pro
 	process_t *process = NULL;
 	thread_t *current;
 	map_entry_t *e;
+#ifdef SIZE_LARGEPAGE
+	addr_t pa;
+#endif
 
 	if ((size == 0U) || ((size & (SIZE_PAGE - 1U)) != 0U)) {
 		return NULL;
@@ -627,6 +761,12 @@ void *_vm_mmap(vm_map_t *map, void *vaddr, page_t *p, size_t size, vm_prot_t pro
 			(void)_vm_munmap(map, vaddr, size);
 			return NULL;
 		}
+#ifdef SIZE_LARGEPAGE
+		/* Rest of the large page is mapped (or faulted in if small pages were used) */
+		if (_map_large(map, e, w, &pa) != 0) {
+			w = (void *)(((ptr_t)w | (SIZE_LARGEPAGE - 1U)) + 1U - SIZE_PAGE);
+		}
+#endif
 	}
 
 	return vaddr;
@@ -639,6 +779,11 @@ void *vm_mmap(vm_map_t *map, void *vaddr, page_t *p, size_t size, vm_prot_t prot
 		map = map_common.kmap;
 	}
 
+	/* Kernel map can't grow the pool under its lock, refill reserve in advance */
+	if (map == map_common.kmap) {
+		map_poolFill(0, 0);
+	}
+
 	(void)proc_lockSet(&map->lock);
 	vaddr = _vm_mmap(map, vaddr, p, size, prot, o, (offs < 0) ? VM_OFFS_MAX : (u64)offs, flags);
 	(void)proc_lockClear(&map->lock);
@@ -701,6 +846,54 @@ int vm_mapFlags(vm_map_t *map, void *vaddr)
 }
 
 
+#ifndef NOMMU
+/* Maps resident object pages neighbouring faulting page in window aligned to its size */
+static void _map_faultAround(vm_map_t *map, map_entry_t *e, void *vaddr)
+{
+	page_t *pages[MAP_FAULT_AROUND];
+	ptr_t start, end, v;
+	size_t i, n, window = map_common.faultAround * SIZE_PAGE;
+	vm_attr_t attr;
+
+	/* Private copies and anonymous memory aren't shared resident pages */
+	if ((window == 0U) || (e->amap != NULL) || (e->offs == VM_OFFS_MAX) || (map == map_common.kmap)) {
+		return;
+	}
+
+	start = max((ptr_t)vaddr & ~(window - 1U), (ptr_t)e->vaddr);
+	end = min(((ptr_t)vaddr & ~(window - 1U)) + window, (ptr_t)e->vaddr + e->size);
+	n = (end - start) / SIZE_PAGE;
+
+	if (vm_objectResident(e->object, e->offs + (start - (ptr_t)e->vaddr), n, pages) == 0U) {
+		return;
+	}
+
+	/* Writes still fault, copy-on-write and dirty tracking stay intact */
+	attr = vm_protToAttr(e->prot & ~PROT_WRITE) | vm_flagsToAttr(e->flags);
+
+	for (i = 0; i < n; i++) {
+		v = start + i * SIZE_PAGE;
+		if ((pages[i] != NULL) && (v != (ptr_t)vaddr) && (pmap_resolve(&map->pmap, (void *)v) == 0U)) {
+			if (page_map(&map->pmap, (void *)v, pages[i]->addr, attr) < 0) {
+				break;
+			}
+		}
+	}
+}
+#endif
+
+
+void vm_mapFaultAround(size_t pages)
+{
+	/* Window is rounded down to power of 2 */
+	while ((pages & (pages - 1U)) != 0U) {
+		pages &= pages - 1U;
+	}
+
+	map_common.faultAround = min(pages, MAP_FAULT_AROUND);
+}
+
+
 int vm_mapForce(vm_map_t *map, void *paddr, vm_prot_t prot)
 {
 	map_entry_t t, *e;
@@ -719,17 +912,125 @@ int vm_mapForce(vm_map_t *map, void *paddr, vm_prot_t prot)
 	}
 
 	err = _map_force(map, e, paddr, prot);
+#ifndef NOMMU
+	if ((err == EOK) && ((prot & PROT_WRITE) == 0U)) {
+		/* Look entry up again, map lock could have been dropped while fetching the page */
+		e = lib_treeof(map_entry_t, linkage, lib_rbFind(&map->tree, &t.linkage));
+		if (e != NULL) {
+			_map_faultAround(map, e, paddr);
+		}
+	}
+#endif
 	(void)proc_lockClear(&map->lock);
 	return err;
 }
 
 
+int vm_mapPopulate(vm_map_t *map, void *vaddr, size_t size, vm_prot_t prot)
+{
+	ptr_t v, end = ((ptr_t)vaddr + size + SIZE_PAGE - 1U) & ~(SIZE_PAGE - 1U);
+	int err;
+
+	for (v = (ptr_t)vaddr & ~(SIZE_PAGE - 1U); v < end; v += SIZE_PAGE) {
+		/* Write access goes through the fault path to break copy-on-write sharing */
+		if (((prot & PROT_WRITE) != 0U) || (pmap_resolve(&map->pmap, (void *)v) == 0U)) {
+			err = vm_mapForce(map, (void *)v, prot);
+			if (err != EOK) {
+				return err;
+			}
+		}
+	}
+
+	return EOK;
+}
+
+
+#ifndef NOMMU
+/* Holds off kernel writes done without faulting (see vm_mapWriteBegin()) while write access is revoked */
+static void map_wprot(vm_map_t *map, int on)
+{
+	spinlock_ctx_t sc;
+
+	hal_spinlockSet(&map->uwspinlock, &sc);
+	if (on != 0) {
+		map->wprot++;
+	}
+	else {
+		map->wprot--;
+	}
+	hal_spinlockClear(&map->uwspinlock, &sc);
+}
+
+
+int vm_mapWriteBegin(vm_map_t *map, void *vaddr, size_t size, spinlock_ctx_t *sc)
+{
+	ptr_t v, end = (ptr_t)vaddr + size;
+
+	hal_spinlockSet(&map->uwspinlock, sc);
+
+	if (map->wprot == 0U) {
+		for (v = (ptr_t)vaddr & ~(SIZE_PAGE - 1U); v < end; v += SIZE_PAGE) {
+			if (pmap_isWritable(&map->pmap, (void *)v) == 0) {
+				break;
+			}
+		}
+
+		if (v >= end) {
+			return EOK;
+		}
+	}
+
+	hal_spinlockClear(&map->uwspinlock, sc);
+
+	return -EFAULT;
+}
+
+
+void vm_mapWriteEnd(vm_map_t *map, spinlock_ctx_t *sc)
+{
+	hal_spinlockClear(&map->uwspinlock, sc);
+}
+#endif
+
+
 static vm_prot_t map_checkProt(vm_prot_t baseProt, vm_prot_t newProt)
 {
 	return (baseProt | newProt) ^ baseProt;
 }
 
 
+#ifdef SIZE_LARGEPAGE
+/* Returns 1 and physical address of large page covering vaddr if the entry can be mapped with it */
+static int _map_large(vm_map_t *map, map_entry_t *e, void *vaddr, addr_t *pa)
+{
+	ptr_t v = (ptr_t)vaddr & ~((ptr_t)SIZE_LARGEPAGE - 1U);
+	u64 offs;
+
+	/* Only unshared contiguous memory, private copies are made per page */
+	if (((e->flags & MAP_LARGEPAGE) == 0U) || (e->amap != NULL) || (e->offs == VM_OFFS_MAX) || (map == map_common.kmap)) {
+		return 0;
+	}
+
+	if ((v < (ptr_t)e->vaddr) || ((v + SIZE_LARGEPAGE) > ((ptr_t)e->vaddr + e->size))) {
+		return 0;
+	}
+
+	offs = e->offs + (v - (ptr_t)e->vaddr);
+	if (e->object == VM_OBJ_PHYSMEM) {
+		*pa = (addr_t)offs;
+	}
+	else if ((e->object != NULL) && (e->object->extent != NULL) && ((offs + SIZE_LARGEPAGE) <= e->object->size)) {
+		*pa = e->object->extent[offs / SIZE_PAGE].addr;
+	}
+	else {
+		return 0;
+	}
+
+	return ((*pa & (SIZE_LARGEPAGE - 1U)) == 0U) ? 1 : 0;
+}
+#endif
+
+
 static int _map_force(vm_map_t *map, map_entry_t *e, void *paddr, vm_prot_t prot)
 {
 	vm_attr_t attr;
@@ -739,6 +1040,10 @@ static int _map_force(vm_map_t *map, map_entry_t *e, void *paddr, vm_prot_t prot
 	vm_prot_t flagsCheck = map_checkProt(e->prot, prot);
 	amap_t *amapNew;
 	int err;
+#ifdef SIZE_LARGEPAGE
+	addr_t pa;
+	void *v;
+#endif
 
 	if (flagsCheck != 0U) {
 		return -EINVAL;
@@ -753,6 +1058,20 @@ static int _map_force(vm_map_t *map, map_entry_t *e, void *paddr, vm_prot_t prot
 		e->flags &= ~MAP_NEEDSCOPY;
 	}
 
+#ifdef SIZE_LARGEPAGE
+	if (_map_large(map, e, paddr, &pa) != 0) {
+		v = (void *)((ptr_t)paddr & ~((ptr_t)SIZE_LARGEPAGE - 1U));
+		if (pmap_resolve(&map->pmap, paddr) != 0U) {
+			msg_mapInvalidate(map, v, SIZE_LARGEPAGE);
+		}
+
+		if (page_mapLarge(&map->pmap, v, pa, vm_protToAttr(prot) | vm_flagsToAttr(e->flags)) == EOK) {
+			return EOK;
+		}
+		/* Small pages already mapped in the range, continue with them */
+	}
+#endif
+
 	offs = (ptr_t)paddr - (ptr_t)e->vaddr;
 	eoffs = ((e->offs == VM_OFFS_MAX) ? VM_OFFS_MAX : (e->offs + offs));
 
@@ -767,6 +1086,13 @@ static int _map_force(vm_map_t *map, map_entry_t *e, void *paddr, vm_prot_t prot
 		return err;
 	}
 
+#ifndef NOMMU
+	/* Page is being replaced (e.g. copy-on-write) */
+	if (pmap_resolve(&map->pmap, paddr) != 0U) {
+		msg_mapInvalidate(map, paddr, SIZE_PAGE);
+	}
+#endif
+
 	attr = vm_protToAttr(prot) | vm_flagsToAttr(e->flags);
 
 	if ((p == NULL) && (e->object == VM_OBJ_PHYSMEM)) {
@@ -808,7 +1134,8 @@ static void map_pageFault(unsigned int n, exc_context_t *ctx)
 	/* clang-format on */
 #endif
 
-	if (hal_exceptionsPC(ctx) >= VADDR_KERNEL) {
+	/* Kernel accesses to user memory fault on pages left unpopulated or write-protected by fork */
+	if ((hal_exceptionsPC(ctx) >= VADDR_KERNEL) && (pmap_belongs(&map_common.kmap->pmap, vaddr) != 0)) {
 		/* output exception ASAP to avoid being deadlocked on spinlock */
 		process_dumpException(n, ctx);
 	}
@@ -842,10 +1169,17 @@ int vm_munmap(vm_map_t *map, void *vaddr, size_t size)
 {
 	int result;
 
+	/* Splitting a kernel map entry takes one from the reserve */
+	if (map == map_common.kmap) {
+		map_poolFill(0, 0);
+	}
+
 	(void)proc_lockSet(&map->lock);
 	result = _vm_munmap(map, vaddr, size);
 	(void)proc_lockClear(&map->lock);
 
+	map_poolTrim();
+
 	return result;
 }
 
@@ -858,7 +1192,6 @@ int vm_mprotect(vm_map_t *map, void *vaddr, size_t len, vm_prot_t prot)
 	process_t *p = proc_current()->process;
 	addr_t pa;
 	vm_attr_t attr;
-	int needscopyNonLazy;
 	map_entry_t *e, *buf = NULL, *prev;
 	map_entry_t t;
 
@@ -900,7 +1233,7 @@ int vm_mprotect(vm_map_t *map, void *vaddr, size_t len, vm_prot_t prot)
 	} while (lenLeft != 0U);
 
 	if ((result == EOK) && (needed != 0U)) {
-		buf = map_allocN(needed);
+		buf = map_allocN(map, needed);
 		if (buf == NULL) {
 			result = -ENOMEM;
 		}
@@ -910,6 +1243,9 @@ int vm_mprotect(vm_map_t *map, void *vaddr, size_t len, vm_prot_t prot)
 		t.vaddr = vaddr;
 		prev = NULL;
 		lenLeft = len;
+#ifndef NOMMU
+		map_wprot(map, 1);
+#endif
 		do {
 			e = lib_treeof(map_entry_t, linkage, lib_rbFind(&map->tree, &t.linkage));
 
@@ -925,16 +1261,6 @@ int vm_mprotect(vm_map_t *map, void *vaddr, size_t len, vm_prot_t prot)
 					_vm_mapEntrySplit(p, map, prev, e, (ptr_t)t.vaddr - (ptr_t)prev->vaddr);
 				}
 			}
-			else if ((prev->protOrig == e->protOrig) && (prev->object == e->object) && (prev->flags == e->flags)) {
-				/* Merge */
-				prev->rmaxgap = e->rmaxgap;
-				prev->size += e->size;
-
-				_entry_put(map, e);
-
-				map_augment(&prev->linkage);
-				e = prev;
-			}
 			else {
 				/* No action required */
 			}
@@ -947,33 +1273,44 @@ int vm_mprotect(vm_map_t *map, void *vaddr, size_t len, vm_prot_t prot)
 			e->prot = prot;
 
 			attr = (vm_protToAttr(e->prot) | vm_flagsToAttr(e->flags));
-			needscopyNonLazy = 0;
 			/* If an entry needs copy, enter it as a readonly to copy it on first access. */
 			if ((e->flags & MAP_NEEDSCOPY) != 0U) {
-				if ((p == NULL) || (p->lazy == 0U)) {
-					needscopyNonLazy = 1;
-				}
-				else {
-					attr &= ~PGHD_WRITE;
-				}
+				attr &= ~PGHD_WRITE;
 			}
+#ifdef SIZE_LARGEPAGE
+			/* Large pages are dropped and faulted in again with the new protection */
+			if ((e->flags & MAP_LARGEPAGE) != 0U) {
+				(void)pmap_remove(&map->pmap, e->vaddr, e->vaddr + e->size);
+			}
+#endif
 			for (currVaddr = e->vaddr; currVaddr < (e->vaddr + e->size); currVaddr += SIZE_PAGE) {
-				if (needscopyNonLazy == 0) {
-					pa = pmap_resolve(&map->pmap, currVaddr);
-					if (pa != 0U) {
-						result = pmap_enter(&map->pmap, pa, currVaddr, attr, NULL);
-					}
-				}
-				else {
-					result = _map_force(map, e, currVaddr, prot);
+				pa = pmap_resolve(&map->pmap, currVaddr);
+				if (pa != 0U) {
+					result = pmap_enter(&map->pmap, pa, currVaddr, attr, NULL);
 				}
 			}
 
 			lenLeft -= e->size;
+			t.vaddr = e->vaddr + e->size;
 			prev = e;
 		} while ((lenLeft != 0U) && (result == EOK));
+#ifndef NOMMU
+		map_wprot(map, 0);
+#endif
+
+		/* Coalesce entries split above or made equal to their neighbours */
+		t.vaddr = vaddr;
+		e = lib_treeof(map_entry_t, linkage, lib_rbFind(&map->tree, &t.linkage));
+		while ((e != NULL) && ((ptr_t)e->vaddr <= (ptr_t)vaddr + len)) {
+			e = _map_merge(map, e);
+			e = lib_treeof(map_entry_t, linkage, lib_rbNext(&e->linkage));
+		}
 	}
 
+#ifndef NOMMU
+	msg_mapInvalidate(map, vaddr, len);
+#endif
+
 	(void)proc_lockClear(&map->lock);
 
 	return result;
@@ -1000,6 +1337,11 @@ int vm_mapCreate(vm_map_t *map, void *start, void *stop)
 	map->pmap.end = stop;
 
 #ifndef NOMMU
+	map->msgarea = NULL;
+	map->msgcache = NULL;
+	map->msgrefs = 0;
+	map->msggen = 0;
+
 	map->pmap.pmapp = vm_pageAlloc(SIZE_PDIR, PAGE_OWNER_KERNEL | PAGE_KERNEL_PTABLE);
 	if (map->pmap.pmapp == NULL) {
 		return -ENOMEM;
@@ -1012,6 +1354,11 @@ int vm_mapCreate(vm_map_t *map, void *start, void *stop)
 	}
 
 	(void)pmap_create(&map->pmap, &map_common.kmap->pmap, map->pmap.pmapp, map->pmap.pmapv);
+
+	map->msgpins = NULL;
+	hal_spinlockCreate(&map->msgspinlock, "map.msg");
+	map->wprot = 0;
+	hal_spinlockCreate(&map->uwspinlock, "map.uwrite");
 #else
 	(void)pmap_create(&map->pmap, &map_common.kmap->pmap, NULL, NULL);
 #endif
@@ -1025,8 +1372,16 @@ int vm_mapCreate(vm_map_t *map, void *start, void *stop)
 static void _map_free(map_entry_t *entry)
 {
 	map_common.nfree++;
-	entry->next = map_common.free;
-	map_common.free = entry;
+
+	/* Entries are returned to cache only by map_poolTrim(), never under map locks */
+	if ((entry >= map_common.entries) && (entry < map_common.entries + map_common.nentries)) {
+		entry->next = map_common.reserve;
+		map_common.reserve = entry;
+	}
+	else {
+		entry->next = map_common.free;
+		map_common.free = entry;
+	}
 }
 
 
@@ -1047,6 +1402,15 @@ void vm_mapDestroy(process_t *p, vm_map_t *map)
 	rbnode_t *n;
 	unsigned int i = 0;
 
+	msg_mapDestroy(map);
+
+	/* Entries go first, page reclaim may reach pmap through them */
+	for (n = map->tree.root; n != NULL; n = map->tree.root) {
+		e = lib_treeof(map_entry_t, linkage, n);
+		amap_putanons(e->amap, e->aoffs, e->size);
+		_entry_put(map, e);
+	}
+
 	for (;;) {
 		a = pmap_destroy(&map->pmap, &i);
 		if (a == 0U) {
@@ -1058,12 +1422,8 @@ void vm_mapDestroy(process_t *p, vm_map_t *map)
 	(void)vm_munmap(map_common.kmap, map->pmap.pmapv, SIZE_PDIR);
 	vm_pageFree(map->pmap.pmapp);
 
-	for (n = map->tree.root; n != NULL; n = map->tree.root) {
-		e = lib_treeof(map_entry_t, linkage, n);
-		amap_putanons(e->amap, e->aoffs, e->size);
-		_entry_put(map, e);
-	}
-
+	hal_spinlockDestroy(&map->uwspinlock);
+	hal_spinlockDestroy(&map->msgspinlock);
 	(void)proc_lockDone(&map->lock);
 #else
 	map_entry_t *temp = NULL;
@@ -1079,6 +1439,7 @@ void vm_mapDestroy(process_t *p, vm_map_t *map)
 			LIST_ADD(&temp, e);
 		}
 		else {
+			vm_objectUnlink(e->object, e);
 			amap_put(e->amap);
 			(void)vm_objectPut(e->object);
 			lib_rbRemove(&map->tree, &e->linkage);
@@ -1098,22 +1459,8 @@ void vm_mapDestroy(process_t *p, vm_map_t *map)
 	(void)proc_lockClear(&p->lock);
 	(void)proc_lockClear(&map->lock);
 #endif
-}
 
-
-static void remap_readonly(vm_map_t *map, map_entry_t *e, u64 offs)
-{
-	addr_t a;
-	vm_attr_t attr = PGHD_PRESENT;
-
-	if ((e->prot & PROT_USER) != 0U) {
-		attr |= PGHD_USER;
-	}
-
-	a = pmap_resolve(&map->pmap, e->vaddr + offs);
-	if (a != 0U) {
-		(void)page_map(&map->pmap, e->vaddr + offs, a, attr);
-	}
+	map_poolTrim();
 }
 
 
@@ -1121,11 +1468,13 @@ int vm_mapCopy(process_t *proc, vm_map_t *dst, vm_map_t *src)
 {
 	rbnode_t *n;
 	map_entry_t *e, *f;
-	size_t offs;
-	int err = EOK;
 
 	(void)proc_lockSet2(&src->lock, &dst->lock);
 
+#ifndef NOMMU
+	map_wprot(src, 1);
+#endif
+
 	for (n = lib_rbMinimum(src->tree.root); n != NULL; n = lib_rbNext(n)) {
 		e = lib_treeof(map_entry_t, linkage, n);
 
@@ -1133,8 +1482,11 @@ int vm_mapCopy(process_t *proc, vm_map_t *dst, vm_map_t *src)
 			continue;
 		}
 
-		f = map_alloc();
+		f = map_alloc(dst);
 		if (f == NULL) {
+#ifndef NOMMU
+			map_wprot(src, 0);
+#endif
 			(void)proc_lockClear(&dst->lock);
 			(void)proc_lockClear(&src->lock);
 			vm_mapDestroy(proc, dst);
@@ -1144,31 +1496,22 @@ int vm_mapCopy(process_t *proc, vm_map_t *dst, vm_map_t *src)
 		_vm_mapEntryCopy(f, e, 1);
 		(void)_map_add(proc, dst, f);
 
+		/* Child page tables are left empty and populated on faults */
 		if (((e->protOrig & PROT_WRITE) != 0U) && ((e->flags & MAP_DEVICE) == 0U)) {
 			e->flags |= MAP_NEEDSCOPY;
 			f->flags |= MAP_NEEDSCOPY;
 
-			if ((proc != NULL) && (proc->lazy != 0U)) {
-				for (offs = 0; offs < f->size; offs += SIZE_PAGE) {
-					remap_readonly(src, e, offs);
-					remap_readonly(dst, f, offs);
-				}
-			}
-		}
-
-		if ((proc == NULL) || (proc->lazy == 0U)) {
-			for (offs = 0; offs < f->size; offs += SIZE_PAGE) {
-				err = _map_force(dst, f, (void *)((ptr_t)f->vaddr + offs), f->prot);
-				if (err != EOK) {
-					(void)proc_lockClear(&dst->lock);
-					(void)proc_lockClear(&src->lock);
-					vm_mapDestroy(proc, dst);
-					return err;
-				}
-			}
+#ifndef NOMMU
+			(void)pmap_writeProtect(&src->pmap, e->vaddr, e->vaddr + e->size);
+			msg_mapInvalidate(src, e->vaddr, e->size);
+#endif
 		}
 	}
 
+#ifndef NOMMU
+	map_wprot(src, 0);
+#endif
+
 	(void)proc_lockClear(&dst->lock);
 	(void)proc_lockClear(&src->lock);
 
@@ -1225,25 +1568,122 @@ int vm_mapBelongs(const struct _process_t *proc, const void *ptr, size_t size)
 }
 
 
-void vm_mapinfo(meminfo_t *info)
+static void map_entryInfo(entryinfo_t *ei, map_entry_t *e)
 {
+	size_t i;
+
+	ei->vaddr = e->vaddr;
+	ei->size = e->size;
+	ei->flags = (unsigned char)e->flags;
+	ei->prot = e->prot;
+	ei->protOrig = e->protOrig;
+	ei->anonsz = ~0U;
+
+	if (e->amap != NULL) {
+		ei->anonsz = 0;
+		for (i = 0; i < e->amap->size; ++i) {
+			if (e->amap->anons[i] != NULL) {
+				ei->anonsz += SIZE_PAGE;
+			}
+		}
+	}
+
+	ei->offs = e->offs;
+
+	if (e->object == NULL) {
+		ei->object = OBJECT_ANONYMOUS;
+	}
+	else if (e->object == VM_OBJ_PHYSMEM) {
+		ei->object = OBJECT_MEMORY;
+	}
+	else {
+		ei->object = OBJECT_OID;
+		ei->oid = e->object->oid;
+	}
+}
+
+
+/* Returns first entry starting at or above vaddr */
+static rbnode_t *_map_infoFrom(vm_map_t *map, void *vaddr)
+{
+	rbnode_t *n = map->tree.root, *r = NULL;
+
+	while (n != NULL) {
+		if ((ptr_t)lib_treeof(map_entry_t, linkage, n)->vaddr >= (ptr_t)vaddr) {
+			r = n;
+			n = n->left;
+		}
+		else {
+			n = n->right;
+		}
+	}
+
+	return r;
+}
+
+
+/* User buffer can fault (e.g. pages write-protected by fork), it's written in batches without the map lock */
+static int map_entriesInfo(vm_map_t *map, entryinfo_t *out, int outsz)
+{
+	entryinfo_t buf[MAP_INFO_BATCH];
 	rbnode_t *n;
+	map_entry_t *e;
+	void *next = NULL;
+	unsigned int k;
+	int size, copied = 0, more;
+
+	do {
+		k = 0;
+		more = 0;
+		size = copied;
+
+		(void)proc_lockSet(&map->lock);
+
+		for (n = _map_infoFrom(map, next); n != NULL; n = lib_rbNext(n)) {
+			if ((out != NULL) && (outsz > size)) {
+				if (k == MAP_INFO_BATCH) {
+					more = 1;
+					break;
+				}
+				e = lib_treeof(map_entry_t, linkage, n);
+				map_entryInfo(&buf[k++], e);
+				next = e->vaddr + e->size;
+			}
+			++size;
+		}
+
+		(void)proc_lockClear(&map->lock);
+
+		if (k != 0U) {
+			hal_memcpy(out + copied, buf, k * sizeof(buf[0]));
+			copied += (int)k;
+		}
+	} while (more != 0);
+
+	return size;
+}
+
+
+void vm_mapinfo(meminfo_t *info)
+{
 	map_entry_t *e;
 	vm_map_t *map;
 	const syspage_map_t *spMap;
 	int size;
 	process_t *process;
-	size_t i;
 	size_t total, free;
-
+	unsigned int ntotal, nfree;
 
 	(void)proc_lockSet(&map_common.lock);
 	/* FIXME: potentially lossy downcasts on 64-bit targets - make total, free, sz size_t */
-	info->entry.total = (unsigned int)map_common.ntotal;
-	info->entry.free = (unsigned int)map_common.nfree;
-	info->entry.sz = (unsigned int)sizeof(map_entry_t);
+	ntotal = (unsigned int)map_common.ntotal;
+	nfree = (unsigned int)map_common.nfree;
 	(void)proc_lockClear(&map_common.lock);
 
+	info->entry.total = ntotal;
+	info->entry.free = nfree;
+	info->entry.sz = (unsigned int)sizeof(map_entry_t);
+
 	if (info->entry.mapsz != -1) {
 		process = proc_find((int)info->entry.pid);
 
@@ -1254,87 +1694,25 @@ void vm_mapinfo(meminfo_t *info)
 
 		map = process->mapp;
 		if (map != NULL) {
-			(void)proc_lockSet(&map->lock);
-
 #ifndef NOMMU
-			size = 0;
-			for (n = lib_rbMinimum(map->tree.root); n != NULL; n = lib_rbNext(n)) {
-				if (info->entry.map != NULL && info->entry.mapsz > size) {
-					e = lib_treeof(map_entry_t, linkage, n);
-
-					info->entry.map[size].vaddr = e->vaddr;
-					info->entry.map[size].size = e->size;
-					info->entry.map[size].flags = e->flags;
-					info->entry.map[size].prot = e->prot;
-					info->entry.map[size].protOrig = e->protOrig;
-					info->entry.map[size].anonsz = ~0U;
-
-					if (e->amap != NULL) {
-						info->entry.map[size].anonsz = 0;
-						for (i = 0; (unsigned int)i < e->amap->size; ++i) {
-							if (e->amap->anons[i] != NULL) {
-								info->entry.map[size].anonsz += SIZE_PAGE;
-							}
-						}
-					}
-
-					info->entry.map[size].offs = e->offs;
-
-					if (e->object == NULL) {
-						info->entry.map[size].object = OBJECT_ANONYMOUS;
-					}
-					else if (e->object == VM_OBJ_PHYSMEM) {
-						info->entry.map[size].object = OBJECT_MEMORY;
-					}
-					else {
-						info->entry.map[size].object = OBJECT_OID;
-						info->entry.map[size].oid = e->object->oid;
-					}
-				}
-				++size;
-			}
+			size = map_entriesInfo(map, info->entry.map, info->entry.mapsz);
 #else
+			(void)proc_lockSet(&map->lock);
+
 			size = 0;
 			e = process->entries;
 
 			do {
 				if (info->entry.map != NULL && info->entry.mapsz > size) {
-					info->entry.map[size].vaddr = e->vaddr;
-					info->entry.map[size].size = e->size;
-					info->entry.map[size].flags = e->flags;
-					info->entry.map[size].prot = e->prot;
-					info->entry.map[size].protOrig = e->protOrig;
-					info->entry.map[size].anonsz = ~0x0U;
-
-					if (e->amap != NULL) {
-						info->entry.map[size].anonsz = 0;
-						for (i = 0; i < e->amap->size; ++i) {
-							if (e->amap->anons[i] != NULL) {
-								info->entry.map[size].anonsz += SIZE_PAGE;
-							}
-						}
-					}
-
-					info->entry.map[size].offs = e->offs;
-
-					if (e->object == NULL) {
-						info->entry.map[size].object = OBJECT_ANONYMOUS;
-					}
-					else if (e->object == VM_OBJ_PHYSMEM) {
-						info->entry.map[size].object = OBJECT_MEMORY;
-					}
-					else {
-						info->entry.map[size].object = OBJECT_OID;
-						info->entry.map[size].oid = e->object->oid;
-					}
+					map_entryInfo(&info->entry.map[size], e);
 				}
 
 				++size;
 				e = e->next;
 			} while (e != process->entries);
-#endif
 
 			(void)proc_lockClear(&map->lock);
+#endif
 		}
 		else {
 			size = 0;
@@ -1345,48 +1723,7 @@ void vm_mapinfo(meminfo_t *info)
 	}
 
 	if (info->entry.kmapsz != -1) {
-		(void)proc_lockSet(&map_common.kmap->lock);
-
-		size = 0;
-
-		for (n = lib_rbMinimum(map_common.kmap->tree.root); n != NULL; n = lib_rbNext(n)) {
-			if (info->entry.kmap != NULL && info->entry.kmapsz > size) {
-				e = lib_treeof(map_entry_t, linkage, n);
-
-				info->entry.kmap[size].vaddr = e->vaddr;
-				info->entry.kmap[size].size = e->size;
-				info->entry.kmap[size].flags = e->flags;
-				info->entry.kmap[size].prot = e->prot;
-				info->entry.kmap[size].protOrig = e->protOrig;
-				info->entry.kmap[size].anonsz = ~0x0U;
-
-				if (e->amap != NULL) {
-					info->entry.kmap[size].anonsz = 0x0U;
-					for (i = 0; i < e->amap->size; ++i) {
-						if (e->amap->anons[i] != NULL) {
-							info->entry.kmap[size].anonsz += SIZE_PAGE;
-						}
-					}
-				}
-
-				info->entry.kmap[size].offs = e->offs;
-
-				if (e->object == NULL) {
-					info->entry.kmap[size].object = OBJECT_ANONYMOUS;
-				}
-				else if (e->object == VM_OBJ_PHYSMEM) {
-					info->entry.kmap[size].object = OBJECT_MEMORY;
-				}
-				else {
-					info->entry.kmap[size].object = OBJECT_OID;
-					info->entry.kmap[size].oid = e->object->oid;
-				}
-			}
-			++size;
-		}
-
-		(void)proc_lockClear(&map_common.kmap->lock);
-		info->entry.kmapsz = size;
+		info->entry.kmapsz = map_entriesInfo(map_common.kmap, info->entry.kmap, info->entry.kmapsz);
 	}
 
 	if (info->maps.mapsz != -1) {
@@ -1455,14 +1792,98 @@ void vm_mapinfo(meminfo_t *info)
  */
 
 
-static map_entry_t *map_allocN(size_t n)
+static void map_poolFill(size_t n, int wait)
 {
-	map_entry_t *e, *tmp;
+	map_entry_t *e, *list = NULL;
 	size_t i;
 
 	(void)proc_lockSet(&map_common.lock);
 
-	if (map_common.nfree < n) {
+	/* Kernel map refills don't wait, they may be nested in a fill mapping a new slab */
+	while ((wait != 0) && (map_common.busy != 0) && (map_common.nfree < n + MAP_POOL_LOW)) {
+		(void)proc_lockWait(&map_common.fillq, &map_common.lock, 0);
+	}
+
+	if ((map_common.cache == NULL) || (map_common.busy != 0) || (map_common.nfree >= n + MAP_POOL_LOW)) {
+		(void)proc_lockClear(&map_common.lock);
+		return;
+	}
+	/* Cache may map a new slab, which allocates an entry for kernel map - it comes from the reserve */
+	map_common.busy = 1;
+	(void)proc_lockClear(&map_common.lock);
+
+	for (i = 0; i < n + MAP_POOL_BATCH; i++) {
+		e = vm_kmemCacheAlloc(map_common.cache);
+		if (e == NULL) {
+			break;
+		}
+		e->next = list;
+		list = e;
+	}
+
+	(void)proc_lockSet(&map_common.lock);
+	while (list != NULL) {
+		e = list;
+		list = e->next;
+		e->next = map_common.free;
+		map_common.free = e;
+		map_common.nfree++;
+		map_common.ntotal++;
+	}
+	map_common.busy = 0;
+	(void)proc_threadBroadcast(&map_common.fillq);
+	(void)proc_lockClear(&map_common.lock);
+}
+
+
+static void map_poolTrim(void)
+{
+	map_entry_t *e, *list = NULL;
+
+	(void)proc_lockSet(&map_common.lock);
+	if ((map_common.busy != 0) || (map_common.nfree <= MAP_POOL_HIGH)) {
+		(void)proc_lockClear(&map_common.lock);
+		return;
+	}
+	map_common.busy = 1;
+
+	while ((map_common.nfree > MAP_POOL_HIGH) && (map_common.free != NULL)) {
+		e = map_common.free;
+		map_common.free = e->next;
+		e->next = list;
+		list = e;
+		map_common.nfree--;
+		map_common.ntotal--;
+	}
+	(void)proc_lockClear(&map_common.lock);
+
+	while (list != NULL) {
+		e = list;
+		list = e->next;
+		vm_kmemCacheFree(map_common.cache, e);
+	}
+
+	(void)proc_lockSet(&map_common.lock);
+	map_common.busy = 0;
+	(void)proc_threadBroadcast(&map_common.fillq);
+	(void)proc_lockClear(&map_common.lock);
+}
+
+
+static map_entry_t *map_allocN(vm_map_t *map, size_t n)
+{
+	map_entry_t *e = NULL, *t;
+	size_t i, reserve = 0;
+
+	/* Kernel map may use the reserve, other maps grow the pool (no kernel map lock is held here) */
+	if (map != map_common.kmap) {
+		map_poolFill(n, 1);
+		reserve = MAP_POOL_RESERVE;
+	}
+
+	(void)proc_lockSet(&map_common.lock);
+
+	if (map_common.nfree < n + reserve) {
 		(void)proc_lockClear(&map_common.lock);
 #ifndef NDEBUG
 		lib_printf("vm: Entry pool exhausted!\n");
@@ -1471,13 +1892,18 @@ static map_entry_t *map_allocN(size_t n)
 	}
 
 	map_common.nfree -= n;
-	e = map_common.free;
-	tmp = e;
-	for (i = 0; i < (n - 1U); i++) {
-		tmp = tmp->next;
+	for (i = 0; i < n; i++) {
+		t = map_common.free;
+		if (t != NULL) {
+			map_common.free = t->next;
+		}
+		else {
+			t = map_common.reserve;
+			map_common.reserve = t->next;
+		}
+		t->next = e;
+		e = t;
 	}
-	map_common.free = tmp->next;
-	tmp->next = NULL;
 
 	(void)proc_lockClear(&map_common.lock);
 
@@ -1485,9 +1911,9 @@ static map_entry_t *map_allocN(size_t n)
 }
 
 
-static map_entry_t *map_alloc(void)
+static map_entry_t *map_alloc(vm_map_t *map)
 {
-	return map_allocN(1);
+	return map_allocN(map, 1);
 }
 
 
@@ -1568,7 +1994,7 @@ static int _map_mapsInit(vm_map_t *kmap, vm_object_t *kernel, void **bss, void *
 					continue;
 				}
 
-				entry = map_alloc();
+				entry = map_alloc(map_common.kmap);
 				if (entry == NULL) {
 					return -ENOMEM;
 				}
@@ -1620,14 +2046,31 @@ int _map_init(vm_map_t *kmap, vm_object_t *kernel, void **bss, void **top)
 	(void)proc_lockInit(&kmap->lock, &proc_lockAttrDefault, "map.kmap");
 	lib_rbInit(&kmap->tree, map_cmp, map_augment);
 
+#ifndef NOMMU
+	kmap->msgarea = NULL;
+	kmap->msgcache = NULL;
+	kmap->msgrefs = 0;
+	kmap->msggen = 0;
+	kmap->msgpins = NULL;
+	hal_spinlockCreate(&kmap->msgspinlock, "map.msg");
+	kmap->wprot = 0;
+	hal_spinlockCreate(&kmap->uwspinlock, "map.uwrite");
+#endif
+
 	map_common.kmap = kmap;
 	map_common.kernel = kernel;
 
 	vm_pageGetStats(&freesz);
 
-	/* Init map entry pool */
-	map_common.ntotal = freesz / (3U * SIZE_PAGE + sizeof(map_entry_t));
+	/* Init map entry boot pool, it grows from cache later */
+	map_common.ntotal = min(freesz / (3U * SIZE_PAGE + sizeof(map_entry_t)), MAP_POOL_BOOT);
 	map_common.nfree = map_common.ntotal;
+	map_common.nentries = map_common.ntotal;
+	map_common.cache = NULL;
+	map_common.busy = 0;
+	map_common.fillq = NULL;
+	map_common.free = NULL;
+	map_common.faultAround = MAP_FAULT_AROUND;
 
 	while ((ptr_t)(*top) - (ptr_t)(*bss) < (ptr_t)sizeof(map_entry_t) * (ptr_t)map_common.ntotal) {
 		result = _page_sbrk(&map_common.kmap->pmap, bss, top);
@@ -1637,7 +2080,7 @@ int _map_init(vm_map_t *kmap, vm_object_t *kernel, void **bss, void **top)
 	map_common.entries = (*bss);
 	poolsz = min((ptr_t)(*top) - (ptr_t)(*bss), sizeof(map_entry_t) * map_common.ntotal);
 
-	map_common.free = map_common.entries;
+	map_common.reserve = map_common.entries;
 
 	for (i = 0; i < map_common.nfree - 1U; ++i) {
 		map_common.entries[i].next = map_common.entries + i + 1U;
@@ -1656,7 +2099,7 @@ int _map_init(vm_map_t *kmap, vm_object_t *kernel, void **bss, void **top)
 	prot = PROT_READ | PROT_EXEC;
 	i = 0;
 	while (pmap_segment(i, &vaddr, &size, &prot, top) >= 0) {
-		e = map_alloc();
+		e = map_alloc(map_common.kmap);
 		if (e == NULL) {
 			break;
 		}
@@ -1681,3 +2124,9 @@ int _map_init(vm_map_t *kmap, vm_object_t *kernel, void **bss, void **top)
 
 	return EOK;
 }
+
+
+void _map_cacheInit(void)
+{
+	map_common.cache = vm_kmemCacheCreate("map.entry", sizeof(map_entry_t), 0, NULL);
+}
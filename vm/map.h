@@ -37,6 +37,16 @@ typedef struct _vm_map_t {
 	void *stop;
 	rbtree_t tree;
 	lock_t lock;
+#ifndef NOMMU
+	struct _msg_area_t *msgarea;
+	struct _msg_wcache_t *msgcache; /* Message windows cached in this map */
+	volatile unsigned int msgrefs;  /* Cached windows of other maps showing pages of this map */
+	volatile unsigned int msggen;   /* Bumped when pages shown in other maps are invalidated */
+	struct _kmsg_layout_t *msgpins; /* Messages sent from this map with directly mapped pages */
+	spinlock_t msgspinlock;         /* Protects msgpins */
+	unsigned int wprot;             /* Write access is being revoked (fork, mprotect) */
+	spinlock_t uwspinlock;          /* Serializes wprot with kernel writes that can't fault */
+#endif
 } vm_map_t;
 
 
@@ -57,6 +67,10 @@ typedef struct _map_entry_t {
 
 	vm_map_t *map;
 
+	/* Entries mapping the same object */
+	struct _map_entry_t *onext;
+	struct _map_entry_t *oprev;
+
 	size_t aoffs;
 	struct _amap_t *amap;
 
@@ -88,6 +102,24 @@ void *_vm_mmap(vm_map_t *map, void *vaddr, page_t *p, size_t size, vm_prot_t pro
 int vm_mapForce(vm_map_t *map, void *paddr, vm_prot_t prot);
 
 
+/* Faults in pages of [vaddr, vaddr + size) not accessible with prot, e.g. left unpopulated or write-protected by fork */
+int vm_mapPopulate(vm_map_t *map, void *vaddr, size_t size, vm_prot_t prot);
+
+
+#ifndef NOMMU
+/* Checks that [vaddr, vaddr + size) can be written without a fault and keeps its write access until
+ * vm_mapWriteEnd(), for writes done where a fault can't be handled (e.g. under a spinlock). Doesn't sleep */
+int vm_mapWriteBegin(vm_map_t *map, void *vaddr, size_t size, spinlock_ctx_t *sc);
+
+
+void vm_mapWriteEnd(vm_map_t *map, spinlock_ctx_t *sc);
+#endif
+
+
+/* Sets number of resident pages mapped around read fault (0 disables) */
+void vm_mapFaultAround(size_t pages);
+
+
 int vm_mapFlags(vm_map_t *map, void *vaddr);
 
 
@@ -133,4 +165,8 @@ int vm_mapBelongs(const struct _process_t *proc, const void *ptr, size_t size);
 int _map_init(vm_map_t *kmap, struct _vm_object_t *kernel, void **bss, void **top);
 
 
+/* Enables growing of map entry pool, needs kmalloc */
+void _map_cacheInit(void);
+
+
 #endif
@@ -20,8 +20,41 @@
 #include "kmalloc.h"
 #include "object.h"
 #include "map.h"
+#include "amap.h"
 #include "proc/name.h"
 #include "proc/threads.h"
+#include "proc/msg.h"
+
+
+#define OBJECT_RA_MIN 4U  /* Pages fetched on random access */
+#define OBJECT_RA_MAX 32U /* Max readahead window in pages */
+
+#define OBJECT_FLAT_MAX    64U /* Larger objects use sparse page index */
+#define OBJECT_RADIX_SHIFT 6U
+#define OBJECT_RADIX_SLOTS (1UL << OBJECT_RADIX_SHIFT)
+#define OBJECT_RADIX_MASK  (OBJECT_RADIX_SLOTS - 1U)
+
+/* Page cluster spans at most two leaves */
+#define OBJECT_SPARE_MAX(o) (2U * (o)->levels)
+
+#define OBJECT_RECLAIM_MAPS  8U     /* Max maps locked to unmap a reclaimed page */
+#define OBJECT_RECLAIM_BATCH 16U    /* Pages scanned per object lock hold */
+#define OBJECT_RECLAIM_SLEEP 20000U /* Reclaimer backoff when nothing could be freed (us) */
+
+
+typedef struct _object_node_t {
+	void *slots[OBJECT_RADIX_SLOTS];
+} object_node_t;
+
+
+/* Resident page of file object, clean pages are kept on LRU list */
+typedef struct _object_page_t {
+	struct _object_page_t *next;
+	struct _object_page_t *prev;
+	vm_object_t *o;
+	size_t idx;
+	page_t *page;
+} object_page_t;
 
 
 static struct {
@@ -29,9 +62,167 @@ static struct {
 	vm_object_t *kernel;
 	vm_map_t *kmap;
 	lock_t lock;
+	vm_object_t *closing;
+	thread_t *closeq;
+	vm_kmemcache_t *nodes;
+	vm_kmemcache_t *recs;
+	object_page_t *lru; /* Most recently used at head */
 } object_common;
 
 
+static object_page_t *_object_recGet(vm_object_t *o, size_t idx)
+{
+	object_node_t *node;
+	unsigned int l;
+
+	if (o->levels == 0U) {
+		return o->pages[idx];
+	}
+
+	node = o->root;
+	for (l = o->levels - 1U; (node != NULL) && (l > 0U); l--) {
+		node = node->slots[(idx >> (l * OBJECT_RADIX_SHIFT)) & OBJECT_RADIX_MASK];
+	}
+
+	return (node != NULL) ? node->slots[idx & OBJECT_RADIX_MASK] : NULL;
+}
+
+
+static page_t *_object_pageGet(vm_object_t *o, size_t idx)
+{
+	object_page_t *rec;
+
+	if (o->extent != NULL) {
+		return o->extent + idx;
+	}
+
+	rec = _object_recGet(o, idx);
+
+	return (rec != NULL) ? rec->page : NULL;
+}
+
+
+/* Index nodes are taken from preallocated spare list, allocator can't be called under object lock */
+static int _object_recSet(vm_object_t *o, size_t idx, object_page_t *p, object_node_t **spare)
+{
+	object_node_t *node;
+	void **slot;
+	unsigned int l;
+
+	if (o->levels == 0U) {
+		o->pages[idx] = p;
+		return EOK;
+	}
+
+	slot = &o->root;
+	for (l = o->levels; l > 0U; l--) {
+		if (*slot == NULL) {
+			node = *spare;
+			if (node == NULL) {
+				return -ENOMEM;
+			}
+			*spare = node->slots[0];
+			hal_memset(node, 0, sizeof(*node));
+			*slot = node;
+		}
+		node = *slot;
+		slot = &node->slots[(idx >> ((l - 1U) * OBJECT_RADIX_SHIFT)) & OBJECT_RADIX_MASK];
+	}
+
+	*slot = p;
+
+	return EOK;
+}
+
+
+static void _object_lruRemove(object_page_t *rec)
+{
+	if (rec->next != NULL) {
+		LIST_REMOVE(&object_common.lru, rec);
+	}
+}
+
+
+static void object_recFree(object_page_t *rec)
+{
+	vm_pageFree(rec->page);
+	vm_kmemCacheFree(object_common.recs, rec);
+}
+
+
+static void object_nodeWalk(object_node_t *node, unsigned int level, void (*fn)(object_page_t *), int release)
+{
+	size_t i;
+
+	for (i = 0; i < OBJECT_RADIX_SLOTS; i++) {
+		if (node->slots[i] == NULL) {
+			continue;
+		}
+
+		if (level > 1U) {
+			object_nodeWalk(node->slots[i], level - 1U, fn, release);
+		}
+		else {
+			fn(node->slots[i]);
+		}
+	}
+
+	if (release != 0) {
+		vm_kmemCacheFree(object_common.nodes, node);
+	}
+}
+
+
+/* Calls fn for each resident page record, release frees index nodes */
+static void object_indexWalk(vm_object_t *o, void (*fn)(object_page_t *), int release)
+{
+	size_t i;
+
+	if (o->levels != 0U) {
+		if (o->root != NULL) {
+			object_nodeWalk(o->root, o->levels, fn, release);
+		}
+		return;
+	}
+
+	for (i = 0; i < round_page(o->size) / SIZE_PAGE; ++i) {
+		if (o->pages[i] != NULL) {
+			fn(o->pages[i]);
+		}
+	}
+}
+
+
+static object_node_t *object_spareAlloc(vm_object_t *o)
+{
+	object_node_t *spare = NULL, *node;
+	unsigned int i;
+
+	for (i = 0; i < OBJECT_SPARE_MAX(o); i++) {
+		node = vm_kmemCacheAlloc(object_common.nodes);
+		if (node == NULL) {
+			break;
+		}
+		node->slots[0] = spare;
+		spare = node;
+	}
+
+	return spare;
+}
+
+
+static void object_spareFree(object_node_t *spare)
+{
+	object_node_t *node;
+
+	while (spare != NULL) {
+		node = spare;
+		spare = node->slots[0];
+		vm_kmemCacheFree(object_common.nodes, node);
+	}
+}
+
+
 static int object_cmp(rbnode_t *n1, rbnode_t *n2)
 {
 	vm_object_t *o1 = lib_treeof(vm_object_t, linkage, n1);
@@ -56,10 +247,33 @@ static int object_cmp(rbnode_t *n1, rbnode_t *n2)
 }
 
 
+/* Closes files of released objects without vm locks held, as close sends a message */
+static void object_closethr(void *arg)
+{
+	vm_object_t *o;
+
+	(void)arg;
+
+	for (;;) {
+		(void)proc_lockSet(&object_common.lock);
+		while (object_common.closing == NULL) {
+			(void)proc_lockWait(&object_common.closeq, &object_common.lock, 0);
+		}
+		o = object_common.closing;
+		object_common.closing = o->next;
+		(void)proc_lockClear(&object_common.lock);
+
+		(void)proc_close(o->oid, 0);
+		vm_kfree(o);
+	}
+}
+
+
 int vm_objectGet(vm_object_t **o, oid_t oid)
 {
 	vm_object_t t, *no = NULL;
-	size_t i, n;
+	size_t i, n, cap;
+	unsigned int levels = 0;
 	off_t sz;
 	int err = -ENOMEM;
 
@@ -80,7 +294,12 @@ int vm_objectGet(vm_object_t **o, oid_t oid)
 		/* parasoft-suppress-next-line MISRAC2012-RULE_14_3 "size_t depends on architecture" */
 		else if ((sizeof(off_t) <= sizeof(size_t)) || (sz <= (off_t)((size_t)-1))) {
 			n = round_page((size_t)sz) / SIZE_PAGE;
-			no = (vm_object_t *)vm_kmalloc(sizeof(vm_object_t) + n * sizeof(page_t *));
+			if (n > OBJECT_FLAT_MAX) {
+				for (cap = OBJECT_RADIX_SLOTS, levels = 1; cap < n; cap <<= OBJECT_RADIX_SHIFT) {
+					levels++;
+				}
+			}
+			no = (vm_object_t *)vm_kmalloc(sizeof(vm_object_t) + ((levels == 0U) ? n : 0U) * sizeof(page_t *));
 		}
 		else {
 			/* No action required */
@@ -102,8 +321,17 @@ int vm_objectGet(vm_object_t **o, oid_t oid)
 			/* Safe to cast - sz fits into size_t from above checks */
 			(*o)->size = (size_t)sz;
 			(*o)->refs = 0;
-
-			for (i = 0; i < n; ++i) {
+			(*o)->opened = 0;
+			(*o)->ranext = 0;
+			(*o)->rawin = 0;
+			(*o)->next = NULL;
+			(*o)->levels = levels;
+			(*o)->root = NULL;
+			(*o)->extent = NULL;
+			(*o)->entries = NULL;
+			(*o)->dirty = 0;
+
+			for (i = 0; (levels == 0U) && (i < n); ++i) {
 				(*o)->pages[i] = NULL;
 			}
 
@@ -137,8 +365,6 @@ vm_object_t *vm_objectRef(vm_object_t *o)
 
 int vm_objectPut(vm_object_t *o)
 {
-	unsigned int i;
-
 	if ((o == NULL) || (o == VM_OBJ_PHYSMEM)) {
 		return EOK;
 	}
@@ -151,64 +377,153 @@ int vm_objectPut(vm_object_t *o)
 	}
 
 	lib_rbRemove(&object_common.tree, &o->linkage);
+	if (o->extent == NULL) {
+		object_indexWalk(o, _object_lruRemove, 0);
+	}
 	(void)proc_lockClear(&object_common.lock);
 
-	/* Contiguous object 'holds' all pages in pages[0] */
-	if ((o->oid.port == (u32)(-1)) && (o->oid.id == (id_t)(-1))) {
-		vm_pageFree(o->pages[0]);
+	/* Contiguous object holds all pages in a single extent */
+	if (o->extent != NULL) {
+		vm_pageFree(o->extent);
 	}
 	else {
-		for (i = 0; i < round_page(o->size) / SIZE_PAGE; ++i) {
-			if (o->pages[i] != NULL) {
-				vm_pageFree(o->pages[i]);
-			}
-		}
+		object_indexWalk(o, object_recFree, 1);
 	}
 
-	vm_kfree(o);
+	/* vm_objectPut() may be called under map locks - close the file later */
+	if (o->opened != 0) {
+		(void)proc_lockSet(&object_common.lock);
+		o->next = object_common.closing;
+		object_common.closing = o;
+		(void)proc_threadBroadcast(&object_common.closeq);
+		(void)proc_lockClear(&object_common.lock);
+	}
+	else {
+		vm_kfree(o);
+	}
 
 	return EOK;
 }
 
 
-static page_t *object_fetch(oid_t oid, u64 offs)
+static int object_open(vm_object_t *o)
+{
+	int err;
+
+	(void)proc_lockSet(&object_common.lock);
+	err = o->opened;
+	(void)proc_lockClear(&object_common.lock);
+
+	if (err != 0) {
+		return EOK;
+	}
+
+	err = proc_open(o->oid, 0);
+	if (err < 0) {
+		return err;
+	}
+
+	(void)proc_lockSet(&object_common.lock);
+	err = o->opened;
+	o->opened = 1;
+	(void)proc_lockClear(&object_common.lock);
+
+	/* Somebody opened it in the meantime */
+	if (err != 0) {
+		(void)proc_close(o->oid, 0);
+	}
+
+	return EOK;
+}
+
+
+/* Returns number of pages to fetch starting at idx, updates readahead state */
+static size_t _object_cluster(vm_object_t *o, size_t idx)
+{
+	size_t n, npages = round_page(o->size) / SIZE_PAGE;
+
+	if ((idx == o->ranext) && (o->rawin != 0U)) {
+		o->rawin = min(2U * o->rawin, OBJECT_RA_MAX);
+	}
+	else {
+		o->rawin = OBJECT_RA_MIN;
+	}
+
+	/* Stop at first resident page */
+	for (n = 1; (n < o->rawin) && (idx + n < npages); n++) {
+		if (_object_pageGet(o, idx + n) != NULL) {
+			break;
+		}
+	}
+	o->ranext = idx + n;
+
+	return n;
+}
+
+
+/* Reads n pages of object starting at idx with a single message */
+static int object_fetch(vm_object_t *o, size_t idx, size_t n, page_t **pages)
 {
-	page_t *p;
 	void *v;
+	size_t i;
+	int ret;
 
-	if (proc_open(oid, 0) < 0) {
-		return NULL;
+	for (i = 0; i < n; i++) {
+		pages[i] = vm_pageAlloc(SIZE_PAGE, PAGE_OWNER_APP);
+		if ((pages[i] == NULL) && (i == 0U) && (vm_objectReclaim(OBJECT_RA_MIN) != 0U)) {
+			pages[i] = vm_pageAlloc(SIZE_PAGE, PAGE_OWNER_APP);
+		}
+		if (pages[i] == NULL) {
+			break;
+		}
 	}
 
-	p = vm_pageAlloc(SIZE_PAGE, PAGE_OWNER_APP);
-	if (p == NULL) {
-		(void)proc_close(oid, 0);
-		return NULL;
+	/* Readahead is optional */
+	n = i;
+	if (n == 0U) {
+		return -ENOMEM;
 	}
 
-	v = vm_mmap(object_common.kmap, NULL, p, SIZE_PAGE, PROT_WRITE | PROT_USER, object_common.kernel, 0, MAP_NONE);
-	if (v == NULL) {
-		vm_pageFree(p);
-		(void)proc_close(oid, 0);
-		return NULL;
+	v = vm_mapFind(object_common.kmap, NULL, n * SIZE_PAGE, MAP_NONE, PROT_READ | PROT_WRITE | PROT_USER);
+	ret = (v == NULL) ? -ENOMEM : EOK;
+
+	for (i = 0; (i < n) && (ret == EOK); i++) {
+		ret = page_map(&object_common.kmap->pmap, v + i * SIZE_PAGE, pages[i]->addr, PGHD_READ | PGHD_WRITE | PGHD_PRESENT | PGHD_USER);
 	}
 
-	if (proc_read(oid, (off_t)offs, v, SIZE_PAGE, 0) < 0) {
-		(void)vm_munmap(object_common.kmap, v, SIZE_PAGE);
-		vm_pageFree(p);
-		(void)proc_close(oid, 0);
-		return NULL;
+	if (ret == EOK) {
+		ret = proc_read(o->oid, (off_t)idx * (off_t)SIZE_PAGE, v, n * SIZE_PAGE, 0);
+		if ((ret > 0) && ((size_t)ret > n * SIZE_PAGE)) {
+			/* Server reported more than it was asked for */
+			ret = -EIO;
+		}
+		else if (ret >= 0) {
+			/* Zero past the end of file */
+			hal_memset(v + ret, 0, n * SIZE_PAGE - (size_t)ret);
+		}
 	}
 
-	(void)vm_munmap(object_common.kmap, v, SIZE_PAGE);
-	(void)proc_close(oid, 0);
+	if (v != NULL) {
+		(void)vm_munmap(object_common.kmap, v, n * SIZE_PAGE);
+	}
 
-	return p;
+	if (ret < 0) {
+		for (i = 0; i < n; i++) {
+			vm_pageFree(pages[i]);
+		}
+		return ret;
+	}
+
+	return (int)n;
 }
 
 
 int vm_objectPage(vm_map_t *map, amap_t **amap, vm_object_t *o, void *vaddr, u64 offs, page_t **page)
 {
+	page_t *pages[OBJECT_RA_MAX];
+	object_page_t *recs[OBJECT_RA_MAX], *rec;
+	object_node_t *spare = NULL;
+	size_t idx, i, n;
 	int err;
 
 	if (o == NULL) {
@@ -233,13 +548,31 @@ int vm_objectPage(vm_map_t *map, amap_t **amap, vm_object_t *o, void *vaddr, u64
 		return -EINVAL;
 	}
 
-	*page = o->pages[offs / SIZE_PAGE];
-	if (*page != NULL) {
+	idx = (size_t)(offs / SIZE_PAGE);
+
+	if (o->extent != NULL) {
+		*page = o->extent + idx;
+		(void)proc_lockClear(&object_common.lock);
+		return EOK;
+	}
+
+	rec = _object_recGet(o, idx);
+	if (rec != NULL) {
+		/* Move to LRU head */
+		if ((rec->next != NULL) && (object_common.lru != rec)) {
+			LIST_REMOVE(&object_common.lru, rec);
+			LIST_ADD(&object_common.lru, rec);
+			object_common.lru = rec;
+		}
+
+		*page = rec->page;
 		(void)proc_lockClear(&object_common.lock);
 		return EOK;
 	}
 
-	/* Fetch page from backing store */
+	/* Fetch page cluster from backing store */
+
+	n = _object_cluster(o, idx);
 
 	(void)proc_lockClear(&object_common.lock);
 
@@ -249,41 +582,102 @@ int vm_objectPage(vm_map_t *map, amap_t **amap, vm_object_t *o, void *vaddr, u64
 
 	(void)proc_lockClear(&map->lock);
 
-	*page = object_fetch(o->oid, offs);
+	err = object_open(o);
+	if (err == EOK) {
+		err = object_fetch(o, idx, n, pages);
+	}
+	n = (err > 0) ? (size_t)err : 0U;
+
+	for (i = 0; i < n; i++) {
+		recs[i] = vm_kmemCacheAlloc(object_common.recs);
+		if (recs[i] == NULL) {
+			break;
+		}
+		recs[i]->o = o;
+		recs[i]->idx = idx + i;
+		recs[i]->page = pages[i];
+		recs[i]->next = NULL;
+		recs[i]->prev = NULL;
+	}
+
+	/* Pages without record can't be cached */
+	while (n > i) {
+		vm_pageFree(pages[--n]);
+	}
+
+	if ((n != 0U) && (o->levels != 0U)) {
+		spare = object_spareAlloc(o);
+	}
 
 	err = vm_lockVerify(map, amap, o, vaddr, offs);
 	if (err != 0) {
-		if (*page != NULL) {
-			vm_pageFree(*page);
+		for (i = 0; i < n; i++) {
+			object_recFree(recs[i]);
 		}
+		object_spareFree(spare);
 
 		return err;
 	}
 
 	(void)proc_lockSet(&object_common.lock);
 
-	if (o->pages[offs / SIZE_PAGE] != NULL) {
-		/* Someone loaded a page in the meantime, use it */
-		if (*page != NULL) {
-			vm_pageFree(*page);
+	/* Someone could have loaded some pages in the meantime, use them */
+	for (i = 0; i < n; i++) {
+		if ((_object_recGet(o, idx + i) != NULL) || (_object_recSet(o, idx + i, recs[i], &spare) < 0)) {
+			pages[i] = NULL;
+		}
+		else if (o->dirty == 0) {
+			LIST_ADD(&object_common.lru, recs[i]);
+			object_common.lru = recs[i];
+		}
+		else {
+			/* No action required */
 		}
-
-		*page = o->pages[offs / SIZE_PAGE];
-		(void)proc_lockClear(&object_common.lock);
-		return EOK;
 	}
 
-	o->pages[offs / SIZE_PAGE] = *page;
+	*page = _object_pageGet(o, idx);
 	(void)proc_lockClear(&object_common.lock);
+
+	for (i = 0; i < n; i++) {
+		if (pages[i] == NULL) {
+			object_recFree(recs[i]);
+		}
+	}
+	object_spareFree(spare);
+
 	return EOK;
 }
 
 
+size_t vm_objectResident(vm_object_t *o, u64 offs, size_t n, page_t **pages)
+{
+	size_t idx, i, found = 0;
+
+	if ((o == NULL) || (o == VM_OBJ_PHYSMEM) || (o == object_common.kernel)) {
+		return 0;
+	}
+
+	(void)proc_lockSet(&object_common.lock);
+
+	idx = (size_t)(offs / SIZE_PAGE);
+	for (i = 0; i < n; i++) {
+		/* LRU position is left alone, pages mapped ahead weren't used yet */
+		pages[i] = ((offs + i * SIZE_PAGE) < o->size) ? _object_pageGet(o, idx + i) : NULL;
+		if (pages[i] != NULL) {
+			found++;
+		}
+	}
+
+	(void)proc_lockClear(&object_common.lock);
+
+	return found;
+}
+
+
 vm_object_t *vm_objectContiguous(size_t size)
 {
 	vm_object_t *o;
 	page_t *p;
-	size_t i, n;
 
 	p = vm_pageAlloc(size, PAGE_OWNER_APP);
 	if (p == NULL) {
@@ -291,9 +685,8 @@ vm_object_t *vm_objectContiguous(size_t size)
 	}
 
 	size = 1UL << p->idx;
-	n = size / SIZE_PAGE;
 
-	o = vm_kmalloc(sizeof(vm_object_t) + n * sizeof(page_t *));
+	o = vm_kmalloc(sizeof(vm_object_t));
 	if (o == NULL) {
 		vm_pageFree(p);
 		return NULL;
@@ -305,14 +698,196 @@ vm_object_t *vm_objectContiguous(size_t size)
 	o->oid.id = (id_t)(-1);
 	o->refs = 1;
 	o->size = size;
+	o->extent = p;
 
-	for (i = 0; i < n; ++i) {
-		o->pages[i] = p + i;
+	return o;
+}
+
+
+#ifdef SIZE_LARGEPAGE
+
+vm_object_t *vm_objectLarge(size_t size)
+{
+	vm_object_t *o;
+	size_t offs;
+	void *v;
+
+	o = vm_objectContiguous(size);
+	if (o == NULL) {
+		return NULL;
+	}
+
+	/* Zero through kernel window one large page at a time */
+	for (offs = 0; offs < o->size; offs += SIZE_LARGEPAGE) {
+		v = vm_mmap(object_common.kmap, NULL, NULL, SIZE_LARGEPAGE, PROT_READ | PROT_WRITE, o, (off_t)offs, MAP_NONE);
+		if (v == NULL) {
+			(void)vm_objectPut(o);
+			return NULL;
+		}
+		hal_memset(v, 0, SIZE_LARGEPAGE);
+		(void)vm_munmap(object_common.kmap, v, SIZE_LARGEPAGE);
 	}
 
 	return o;
 }
 
+#endif
+
+
+static int object_tracked(vm_object_t *o)
+{
+	return ((o != NULL) && (o != VM_OBJ_PHYSMEM) && (object_common.kernel != NULL) && (o != object_common.kernel) && (o->extent == NULL)) ? 1 : 0;
+}
+
+
+void vm_objectLink(vm_object_t *o, map_entry_t *e)
+{
+	if (object_tracked(o) == 0) {
+		return;
+	}
+
+	(void)proc_lockSet(&object_common.lock);
+	LIST_ADD_EX(&o->entries, e, onext, oprev);
+	/* Writes go directly to object pages */
+	if (((e->protOrig & PROT_WRITE) != 0U) && ((e->flags & MAP_NEEDSCOPY) == 0U) && (e->amap == NULL)) {
+		o->dirty = 1;
+	}
+	(void)proc_lockClear(&object_common.lock);
+}
+
+
+void vm_objectUnlink(vm_object_t *o, map_entry_t *e)
+{
+	if (object_tracked(o) == 0) {
+		return;
+	}
+
+	(void)proc_lockSet(&object_common.lock);
+	LIST_REMOVE_EX(&o->entries, e, onext, oprev);
+	(void)proc_lockClear(&object_common.lock);
+}
+
+
+/* Removes page from all user maps, fails if any of them is busy or page is used by the kernel.
+ * Map locks are only tried as they are normally taken before the object lock */
+static int _object_unmap(object_page_t *rec)
+{
+	vm_map_t *maps[OBJECT_RECLAIM_MAPS];
+	map_entry_t *e = rec->o->entries;
+	u64 offs = (u64)rec->idx * SIZE_PAGE;
+	unsigned int i, nmaps = 0;
+	int err = EOK;
+#ifndef NOMMU
+	void *vaddr;
+#endif
+
+	if (e == NULL) {
+		return EOK;
+	}
+
+	do {
+		if ((e->offs != VM_OFFS_MAX) && (offs >= e->offs) && (offs < e->offs + e->size)) {
+#ifdef NOMMU
+			err = -EBUSY;
+#else
+			if ((e->map == object_common.kmap) || (msg_mapBusy(e->map, e->vaddr + (size_t)(offs - e->offs)) != 0)) {
+				err = -EBUSY;
+			}
+#endif
+			i = 0;
+			while ((i < nmaps) && (maps[i] != e->map)) {
+				i++;
+			}
+
+			if ((err == EOK) && (i == nmaps)) {
+				if ((nmaps == OBJECT_RECLAIM_MAPS) || (proc_lockTry(&e->map->lock) < 0)) {
+					err = -EBUSY;
+				}
+				else {
+					maps[nmaps++] = e->map;
+				}
+			}
+		}
+		e = e->onext;
+	} while ((err == EOK) && (e != rec->o->entries));
+
+#ifndef NOMMU
+	if (err == EOK) {
+		do {
+			if ((e->offs != VM_OFFS_MAX) && (offs >= e->offs) && (offs < e->offs + e->size)) {
+				vaddr = e->vaddr + (size_t)(offs - e->offs);
+				if ((pmap_resolve(&e->map->pmap, vaddr) & ~(SIZE_PAGE - 1U)) == rec->page->addr) {
+					msg_mapInvalidate(e->map, vaddr, SIZE_PAGE);
+					(void)pmap_remove(&e->map->pmap, vaddr, vaddr + SIZE_PAGE);
+				}
+			}
+			e = e->onext;
+		} while (e != rec->o->entries);
+	}
+#endif
+
+	for (i = 0; i < nmaps; i++) {
+		(void)proc_lockClear(&maps[i]->lock);
+	}
+
+	return err;
+}
+
+
+size_t vm_objectReclaim(size_t n)
+{
+	object_page_t *rec, *freed;
+	object_node_t *spare = NULL;
+	size_t nfreed = 0, nscan = 2U * n + OBJECT_RA_MAX, nbatch;
+	int empty = 0;
+
+	/* Lock is dropped between batches not to stall faults on a long scan */
+	while ((empty == 0) && (nfreed < n) && (nscan > 0U)) {
+		freed = NULL;
+
+		(void)proc_lockSet(&object_common.lock);
+
+		for (nbatch = OBJECT_RECLAIM_BATCH; (nfreed < n) && (nscan > 0U) && (nbatch > 0U); nbatch--, nscan--) {
+			if (object_common.lru == NULL) {
+				empty = 1;
+				break;
+			}
+
+			rec = object_common.lru->prev;
+			LIST_REMOVE(&object_common.lru, rec);
+
+			/* Object became dirty, its pages stay off the list */
+			if (rec->o->dirty != 0) {
+				continue;
+			}
+
+			if (_object_unmap(rec) < 0) {
+				/* Page in use, give it another round */
+				LIST_ADD(&object_common.lru, rec);
+				object_common.lru = rec;
+				continue;
+			}
+
+			/* Slot exists, no index nodes are needed */
+			(void)_object_recSet(rec->o, rec->idx, NULL, &spare);
+
+			rec->next = freed;
+			freed = rec;
+			nfreed++;
+		}
+
+		(void)proc_lockClear(&object_common.lock);
+
+		while (freed != NULL) {
+			rec = freed;
+			freed = rec->next;
+			object_recFree(rec);
+		}
+	}
+
+	return nfreed;
+}
+
 
 int _object_init(vm_map_t *kmap, vm_object_t *kernel)
 {
@@ -326,7 +901,24 @@ int _object_init(vm_map_t *kmap, vm_object_t *kernel)
 	(void)proc_lockInit(&object_common.lock, &proc_lockAttrDefault, "object.common");
 	lib_rbInit(&object_common.tree, object_cmp, NULL);
 
+	object_common.closing = NULL;
+	object_common.closeq = NULL;
+
+	object_common.lru = NULL;
+
+	object_common.nodes = vm_kmemCacheCreate("object.node", sizeof(object_node_t), 0, NULL);
+	object_common.recs = vm_kmemCacheCreate("object.page", sizeof(object_page_t), 0, NULL);
+	if ((object_common.nodes == NULL) || (object_common.recs == NULL)) {
+		return -ENOMEM;
+	}
+
 	kernel->refs = 0;
+	kernel->opened = 0;
+	kernel->levels = 0;
+	kernel->root = NULL;
+	kernel->extent = NULL;
+	kernel->entries = NULL;
+	kernel->dirty = 0;
 	kernel->oid.port = 0;
 	kernel->oid.id = 0;
 	(void)lib_rbInsert(&object_common.tree, &kernel->linkage);
@@ -335,3 +927,37 @@ int _object_init(vm_map_t *kmap, vm_object_t *kernel)
 
 	return EOK;
 }
+
+
+#ifndef NOMMU
+static void object_reclaimthr(void *arg)
+{
+	size_t n, freed;
+
+	(void)arg;
+
+	for (;;) {
+		n = vm_pageReclaimWait();
+
+		/* Pre-zeroed pool is given back first, its pages are free to drop */
+		freed = amap_zeroRelease();
+		if (n > freed) {
+			freed += vm_objectReclaim(n - freed);
+		}
+
+		if ((n == 0U) || (freed == 0U)) {
+			/* Nothing to reclaim, don't spin below watermark */
+			(void)proc_threadSleep(OBJECT_RECLAIM_SLEEP);
+		}
+	}
+}
+#endif
+
+
+void _object_start(void)
+{
+	(void)proc_threadCreate(NULL, object_closethr, NULL, 4, (size_t)SIZE_KSTACK, NULL, 0, 0, NULL);
+#ifndef NOMMU
+	(void)proc_threadCreate(NULL, object_reclaimthr, NULL, 4, (size_t)SIZE_KSTACK, NULL, 0, 0, NULL);
+#endif
+}
@@ -23,13 +23,24 @@
 
 
 struct _vm_map_t;
+struct _map_entry_t;
+struct _object_page_t;
 
 typedef struct _vm_object_t {
 	rbnode_t linkage;
+	struct _vm_object_t *next; /* Deferred close list */
 	oid_t oid;
 	int refs;
+	int opened;    /* Backing file is kept open while object exists */
+	int dirty;     /* Mapped writable without copy, pages can't be reclaimed */
+	size_t ranext; /* Page index expected by sequential access */
+	size_t rawin;  /* Current readahead window in pages */
 	size_t size;
-	page_t *pages[];
+	unsigned int levels; /* Depth of sparse page index, 0 for flat array */
+	void *root;          /* Sparse page index */
+	page_t *extent;      /* All pages of contiguous object */
+	struct _map_entry_t *entries; /* Map entries of the object, for page reclaim */
+	struct _object_page_t *pages[]; /* Flat page index of small object */
 } vm_object_t;
 
 
@@ -53,10 +64,37 @@ int vm_objectPut(vm_object_t *o);
 int vm_objectPage(struct _vm_map_t *map, amap_t **amap, vm_object_t *o, void *vaddr, u64 offs, page_t **page);
 
 
+/* Fills pages of n consecutive indices from offs which are resident (NULL otherwise) without fetching them, returns their number */
+size_t vm_objectResident(vm_object_t *o, u64 offs, size_t n, page_t **pages);
+
+
 vm_object_t *vm_objectContiguous(size_t size);
 
 
+#ifdef SIZE_LARGEPAGE
+
+/* Zeroed contiguous object backing anonymous large page mappings */
+vm_object_t *vm_objectLarge(size_t size);
+
+#endif
+
+
+/* Tracks map entries of file objects, called under entry's map lock */
+void vm_objectLink(vm_object_t *o, struct _map_entry_t *e);
+
+
+void vm_objectUnlink(vm_object_t *o, struct _map_entry_t *e);
+
+
+/* Frees up to n clean object pages not used by the kernel, returns number of freed pages */
+size_t vm_objectReclaim(size_t n);
+
+
 int _object_init(struct _vm_map_t *kmap, vm_object_t *kernel);
 
 
+/* Starts background page reclaimer */
+void _object_start(void);
+
+
 #endif
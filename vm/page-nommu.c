@@ -160,6 +160,11 @@ void vm_pageinfo(meminfo_t *info)
 }
 
 
+void _page_cacheInit(void)
+{
+}
+
+
 void _page_init(pmap_t *pmap, void **bss, void **top)
 {
 	page_t *p;
@@ -25,15 +25,38 @@
 
 #define SIZE_VM_SIZES ((unsigned int)(sizeof(void *) * (size_t)__CHAR_BIT__))
 
+#define PAGE_PCP_HIGH  32U /* Max single pages cached per CPU */
+#define PAGE_PCP_BATCH 8U  /* Pages moved between CPU cache and buddy lists at once */
+
+#define PAGE_INFO_BATCH 16U /* Page map records gathered under the lock at once */
+
+#define PAGE_RECLAIM_LOW  32U /* Reclaimer is woken below 1/32 of memory free */
+#define PAGE_RECLAIM_HIGH 16U /* and frees up to 1/16 of memory */
+
+
+/* Per CPU cache of single pages, taken from the buddy allocator (PAGE_CACHED, not PAGE_FREE), hot pages at head */
+typedef struct {
+	spinlock_t spinlock;
+	page_t *pages;
+	unsigned int count;
+} page_pcp_t;
+
 
 static struct {
 	page_t *sizes[SIZE_VM_SIZES];
 	page_t *pages; /* pages ordering and their addresses (page_t::addr) stay invariant after _page_init() */
 
 	size_t totalsz; /* stays invariant after _page_init() */
-	size_t allocsz;
+	size_t allocsz; /* includes pages in CPU caches */
 	size_t bootsz;
 
+	page_pcp_t *pcp;
+	unsigned int npcp;
+
+	spinlock_t reclaimsl;
+	thread_t *reclaimq;
+	int reclaimer;
+
 	lock_t lock;
 } pages_info;
 
@@ -90,34 +113,23 @@ static page_t *_page_alloc(size_t size, vm_flags_t flags)
 }
 
 
-page_t *vm_pageAlloc(size_t size, vm_flags_t flags)
+static void page_doubleFree(page_t *p)
 {
-	page_t *p;
-
-	(void)proc_lockSet(&pages_info.lock);
-	p = _page_alloc(size, flags);
-	(void)proc_lockClear(&pages_info.lock);
-	return p;
+	hal_cpuDisableInterrupts();
+	lib_printf("page: double free (%p)\n", p);
+	hal_cpuEnableInterrupts();
+	for (;;) {
+	}
 }
 
 
-void vm_pageFree(page_t *p)
+static void _page_free(page_t *p)
 {
 	unsigned int idx, i;
 	page_t *lh = p, *rh = p;
 
-	if (p == NULL) {
-		return;
-	}
-
-	(void)proc_lockSet(&pages_info.lock);
-
 	if ((lh->flags & PAGE_FREE) != 0U) {
-		hal_cpuDisableInterrupts();
-		lib_printf("page: double free (%p)\n", lh);
-		hal_cpuEnableInterrupts();
-		for (;;) {
-		}
+		page_doubleFree(lh);
 	}
 
 	idx = p->idx;
@@ -162,9 +174,253 @@ void vm_pageFree(page_t *p)
 	}
 
 	LIST_ADD(&pages_info.sizes[idx], p);
+}
+
+
+static page_pcp_t *page_pcpGet(void)
+{
+	if (pages_info.pcp == NULL) {
+		return NULL;
+	}
+
+	return &pages_info.pcp[hal_cpuGetID() % pages_info.npcp];
+}
+
+
+static unsigned int page_pcpCount(void)
+{
+	unsigned int i, n = 0;
+
+	/* Read without locks, used for statistics only */
+	for (i = 0; i < pages_info.npcp; i++) {
+		n += pages_info.pcp[i].count;
+	}
+
+	return n;
+}
+
+
+static page_t *page_pcpAlloc(page_pcp_t *pcp, vm_flags_t flags)
+{
+	page_t *p, *batch = NULL;
+	spinlock_ctx_t sc;
+	unsigned int i;
+
+	hal_spinlockSet(&pcp->spinlock, &sc);
+	p = pcp->pages;
+	if (p != NULL) {
+		LIST_REMOVE(&pcp->pages, p);
+		p->flags &= ~PAGE_CACHED;
+		pcp->count--;
+	}
+	hal_spinlockClear(&pcp->spinlock, &sc);
+
+	if (p == NULL) {
+		/* Refill with a batch, one of the pages is returned */
+		(void)proc_lockSet(&pages_info.lock);
+		for (i = 0; i < PAGE_PCP_BATCH; i++) {
+			p = _page_alloc(SIZE_PAGE, 0);
+			if (p == NULL) {
+				break;
+			}
+			LIST_ADD(&batch, p);
+		}
+		(void)proc_lockClear(&pages_info.lock);
+
+		p = batch;
+		if (p == NULL) {
+			return NULL;
+		}
+		LIST_REMOVE(&batch, p);
+
+		if (batch != NULL) {
+			hal_spinlockSet(&pcp->spinlock, &sc);
+			while (batch != NULL) {
+				page_t *q = batch->prev;
+				LIST_REMOVE(&batch, q);
+				q->flags |= PAGE_CACHED;
+				LIST_ADD(&pcp->pages, q);
+				pcp->count++;
+			}
+			hal_spinlockClear(&pcp->spinlock, &sc);
+		}
+	}
+
+	p->flags |= flags;
+
+	return p;
+}
+
+
+static void page_pcpFree(page_pcp_t *pcp, page_t *p)
+{
+	page_t *q, *drain = NULL;
+	spinlock_ctx_t sc;
+	unsigned int i;
+
+	hal_spinlockSet(&pcp->spinlock, &sc);
+
+	/* Page may be cached by any CPU, flag is changed under its cache lock */
+	if ((p->flags & PAGE_CACHED) != 0U) {
+		hal_spinlockClear(&pcp->spinlock, &sc);
+		page_doubleFree(p);
+	}
+
+	/* Freed page is hot, put it first */
+	p->flags |= PAGE_CACHED;
+	LIST_ADD(&pcp->pages, p);
+	pcp->pages = p;
+	pcp->count++;
+
+	/* Drain the coldest pages */
+	if (pcp->count > PAGE_PCP_HIGH) {
+		for (i = 0; i < PAGE_PCP_BATCH; i++) {
+			q = pcp->pages->prev;
+			LIST_REMOVE(&pcp->pages, q);
+			q->flags &= ~PAGE_CACHED;
+			LIST_ADD(&drain, q);
+			pcp->count--;
+		}
+	}
+
+	hal_spinlockClear(&pcp->spinlock, &sc);
+
+	if (drain != NULL) {
+		(void)proc_lockSet(&pages_info.lock);
+		while (drain != NULL) {
+			q = drain;
+			LIST_REMOVE(&drain, q);
+			_page_free(q);
+		}
+		(void)proc_lockClear(&pages_info.lock);
+	}
+}
+
+
+/* Returns all CPU cached pages to the buddy allocator, so they can be merged */
+static void page_pcpDrain(void)
+{
+	page_t *q, *drain = NULL;
+	page_pcp_t *pcp;
+	spinlock_ctx_t sc;
+	unsigned int i;
+
+	for (i = 0; i < pages_info.npcp; i++) {
+		pcp = &pages_info.pcp[i];
+
+		hal_spinlockSet(&pcp->spinlock, &sc);
+		while (pcp->pages != NULL) {
+			q = pcp->pages;
+			LIST_REMOVE(&pcp->pages, q);
+			q->flags &= ~PAGE_CACHED;
+			LIST_ADD(&drain, q);
+		}
+		pcp->count = 0;
+		hal_spinlockClear(&pcp->spinlock, &sc);
+	}
+
+	if (drain != NULL) {
+		(void)proc_lockSet(&pages_info.lock);
+		while (drain != NULL) {
+			q = drain;
+			LIST_REMOVE(&drain, q);
+			_page_free(q);
+		}
+		(void)proc_lockClear(&pages_info.lock);
+	}
+}
+
+
+static int page_low(void)
+{
+	/* Read without lock, CPU cached pages are counted as allocated */
+	return ((pages_info.totalsz - pages_info.allocsz) < (pages_info.totalsz / PAGE_RECLAIM_LOW)) ? 1 : 0;
+}
+
+
+static void page_reclaimWakeup(void)
+{
+	spinlock_ctx_t sc;
 
+	if ((pages_info.reclaimer != 0) && (page_low() != 0)) {
+		hal_spinlockSet(&pages_info.reclaimsl, &sc);
+		(void)proc_threadWakeup(&pages_info.reclaimq);
+		hal_spinlockClear(&pages_info.reclaimsl, &sc);
+	}
+}
+
+
+int vm_pageLow(void)
+{
+	return page_low();
+}
+
+
+size_t vm_pageReclaimWait(void)
+{
+	spinlock_ctx_t sc;
+	size_t freesz, highsz = pages_info.totalsz / PAGE_RECLAIM_HIGH;
+
+	hal_spinlockSet(&pages_info.reclaimsl, &sc);
+	pages_info.reclaimer = 1;
+	while (page_low() == 0) {
+		(void)proc_threadWait(&pages_info.reclaimq, &pages_info.reclaimsl, 0, &sc);
+	}
+	hal_spinlockClear(&pages_info.reclaimsl, &sc);
+
+	freesz = pages_info.totalsz - pages_info.allocsz;
+
+	return (freesz < highsz) ? ((highsz - freesz) / SIZE_PAGE) : 0U;
+}
+
+
+page_t *vm_pageAlloc(size_t size, vm_flags_t flags)
+{
+	page_t *p;
+	page_pcp_t *pcp = page_pcpGet();
+
+	/* Single pages are served from the CPU cache without the global lock */
+	if ((size <= SIZE_PAGE) && (pcp != NULL)) {
+		p = page_pcpAlloc(pcp, flags);
+	}
+	else {
+		(void)proc_lockSet(&pages_info.lock);
+		p = _page_alloc(size, flags);
+		(void)proc_lockClear(&pages_info.lock);
+	}
+
+	/* Pages cached by other CPUs can be the missing ones or block merging of larger blocks */
+	if ((p == NULL) && (pcp != NULL) && (page_pcpCount() != 0U)) {
+		page_pcpDrain();
+
+		(void)proc_lockSet(&pages_info.lock);
+		p = _page_alloc(size, flags);
+		(void)proc_lockClear(&pages_info.lock);
+	}
+
+	page_reclaimWakeup();
+
+	return p;
+}
+
+
+void vm_pageFree(page_t *p)
+{
+	page_pcp_t *pcp = page_pcpGet();
+
+	if (p == NULL) {
+		return;
+	}
+
+	/* Double free of a cached page is detected by page_pcpFree() */
+	if ((pcp != NULL) && (p->idx == hal_cpuGetFirstBit(SIZE_PAGE)) && ((p->flags & PAGE_FREE) == 0U)) {
+		page_pcpFree(pcp, p);
+		return;
+	}
+
+	(void)proc_lockSet(&pages_info.lock);
+	_page_free(p);
 	(void)proc_lockClear(&pages_info.lock);
-	return;
 }
 
 
@@ -350,6 +606,44 @@ int page_map(pmap_t *pmap, void *vaddr, addr_t pa, vm_attr_t attr)
 }
 
 
+#ifdef SIZE_LARGEPAGE
+
+int page_mapLarge(pmap_t *pmap, void *vaddr, addr_t pa, vm_attr_t attr)
+{
+	page_t *ap, *p = NULL;
+	addr_t ptable;
+	int err;
+
+	(void)proc_lockSet(&pages_info.lock);
+	err = pmap_enterLarge(pmap, pa, vaddr, attr, NULL, &ptable);
+	if (err == -EFAULT) {
+		ap = _page_alloc(SIZE_PAGE, PAGE_OWNER_KERNEL | PAGE_KERNEL_PTABLE);
+		if (ap == NULL) {
+			err = -ENOMEM;
+		}
+		else {
+			err = pmap_enterLarge(pmap, pa, vaddr, attr, ap, &ptable);
+			if (err != EOK) {
+				_page_free(ap);
+			}
+		}
+	}
+
+	/* Empty page table replaced by the block */
+	if ((err == EOK) && (ptable != 0U)) {
+		p = page_get(ptable);
+	}
+	if (p != NULL) {
+		_page_free(p);
+	}
+	(void)proc_lockClear(&pages_info.lock);
+
+	return err;
+}
+
+#endif
+
+
 int _page_sbrk(pmap_t *pmap, void **start, void **end)
 {
 	page_t *np, *ap = NULL;
@@ -373,49 +667,88 @@ int _page_sbrk(pmap_t *pmap, void **start, void **end)
 
 void vm_pageGetStats(size_t *freesz)
 {
-	*freesz = pages_info.totalsz - pages_info.allocsz;
+	*freesz = pages_info.totalsz - pages_info.allocsz + page_pcpCount() * SIZE_PAGE;
 }
 
 
+/* User buffer can fault (e.g. pages write-protected by fork), it's written in batches without the lock */
 void vm_pageinfo(meminfo_t *info)
 {
+	pageinfo_t buf[PAGE_INFO_BATCH];
 	char c;
 	page_t *p;
-	unsigned int rep, i = 0;
-	int size = 0;
+	unsigned int rep, i = 0, k, alloc, free, boot;
+	int size = 0, copied = 0;
 
 	(void)proc_lockSet(&pages_info.lock);
+	alloc = (unsigned int)(pages_info.allocsz - page_pcpCount() * SIZE_PAGE);
+	free = (unsigned int)(pages_info.totalsz - alloc);
+	boot = (unsigned int)pages_info.bootsz;
+	(void)proc_lockClear(&pages_info.lock);
 
-	info->page.alloc = (unsigned int)pages_info.allocsz;
-	info->page.free = (unsigned int)(pages_info.totalsz - pages_info.allocsz);
-	info->page.boot = (unsigned int)pages_info.bootsz;
+	info->page.alloc = alloc;
+	info->page.free = free;
+	info->page.boot = boot;
 	info->page.sz = (unsigned int)sizeof(page_t);
 
 	if (info->page.mapsz != -1) {
-		while (i < pages_info.totalsz / SIZE_PAGE) {
-			p = pages_info.pages + i;
+		do {
+			k = 0;
+
+			(void)proc_lockSet(&pages_info.lock);
+
+			while ((i < pages_info.totalsz / SIZE_PAGE) && (k < PAGE_INFO_BATCH)) {
+				p = pages_info.pages + i;
 
-			c = pmap_marker(p);
-			for (rep = 0; ((size_t)i + rep + 1U) < pages_info.totalsz / SIZE_PAGE; rep++) {
-				if ((c != pmap_marker(pages_info.pages + i + rep + 1U)) || ((pages_info.pages[i + rep + 1U].addr - pages_info.pages[i + rep].addr) > SIZE_PAGE)) {
-					break;
+				c = pmap_marker(p);
+				for (rep = 0; ((size_t)i + rep + 1U) < pages_info.totalsz / SIZE_PAGE; rep++) {
+					if ((c != pmap_marker(pages_info.pages + i + rep + 1U)) || ((pages_info.pages[i + rep + 1U].addr - pages_info.pages[i + rep].addr) > SIZE_PAGE)) {
+						break;
+					}
 				}
-			}
 
-			if (info->page.mapsz > size && info->page.map != NULL) {
-				info->page.map[size].count = rep + 1U;
-				info->page.map[size].marker = c;
-				info->page.map[size].addr = p->addr;
+				if (info->page.mapsz > size && info->page.map != NULL) {
+					buf[k].count = rep + 1U;
+					buf[k].marker = c;
+					buf[k].addr = p->addr;
+					k++;
+				}
+
+				i += rep + 1U;
+				++size;
 			}
 
-			i += rep + 1U;
-			++size;
-		}
+			(void)proc_lockClear(&pages_info.lock);
+
+			if (k != 0U) {
+				hal_memcpy(info->page.map + copied, buf, k * sizeof(buf[0]));
+				copied += (int)k;
+			}
+		} while (i < pages_info.totalsz / SIZE_PAGE);
 
 		info->page.mapsz = size;
 	}
+}
 
-	(void)proc_lockClear(&pages_info.lock);
+
+void _page_cacheInit(void)
+{
+	unsigned int i, n = hal_cpuGetCount();
+	page_pcp_t *pcp;
+
+	pcp = vm_kmalloc(sizeof(page_pcp_t) * n);
+	if (pcp == NULL) {
+		return;
+	}
+
+	for (i = 0; i < n; i++) {
+		hal_spinlockCreate(&pcp[i].spinlock, "page.pcp");
+		pcp[i].pages = NULL;
+		pcp[i].count = 0;
+	}
+
+	pages_info.npcp = n;
+	pages_info.pcp = pcp;
 }
 
 
@@ -433,6 +766,12 @@ void _page_init(pmap_t *pmap, void **bss, void **top)
 	pages_info.totalsz = 0;
 	pages_info.allocsz = 0;
 	pages_info.bootsz = 0;
+	pages_info.pcp = NULL;
+	pages_info.npcp = 0;
+
+	hal_spinlockCreate(&pages_info.reclaimsl, "page.reclaim");
+	pages_info.reclaimq = NULL;
+	pages_info.reclaimer = 0;
 
 	for (k = 0; k < SIZE_VM_SIZES; k++) {
 		pages_info.sizes[k] = NULL;
@@ -38,16 +38,36 @@ void _page_showPages(void);
 int page_map(pmap_t *pmap, void *vaddr, addr_t pa, vm_attr_t attr);
 
 
+#ifdef SIZE_LARGEPAGE
+
+/* Maps SIZE_LARGEPAGE block, fails with -EBUSY if small pages are mapped in the range */
+int page_mapLarge(pmap_t *pmap, void *vaddr, addr_t pa, vm_attr_t attr);
+
+#endif
+
+
 int _page_sbrk(pmap_t *pmap, void **start, void **end);
 
 
 void vm_pageGetStats(size_t *freesz);
 
 
+/* Checks if free memory is below low watermark */
+int vm_pageLow(void);
+
+
+/* Waits until free memory drops below low watermark, returns number of pages to reclaim */
+size_t vm_pageReclaimWait(void);
+
+
 void vm_pageinfo(meminfo_t *info);
 
 
 void _page_init(pmap_t *pmap, void **bss, void **top);
 
 
+/* Enables per CPU single page caches, needs kmalloc */
+void _page_cacheInit(void);
+
+
 #endif
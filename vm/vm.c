@@ -47,10 +47,19 @@ void _vm_init(vm_map_t *kmap, vm_object_t *kernel)
 	(void)_map_init(kmap, kernel, &vm.bss, &vm.top);
 
 	_zone_init(kmap, kernel, &vm.bss, &vm.top);
-	(void)_kmalloc_init();
+	(void)_kmalloc_init(kmap, kernel);
+	_page_cacheInit();
+	_map_cacheInit();
 
 	(void)_object_init(kmap, kernel);
 	_amap_init(kmap, kernel);
 
 	return;
 }
+
+
+void _vm_start(void)
+{
+	_object_start();
+	_amap_start();
+}
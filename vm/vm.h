@@ -33,4 +33,8 @@ void vm_meminfo(meminfo_t *info);
 void _vm_init(vm_map_t *kmap, vm_object_t *kernel);
 
 
+/* Starts background memory management threads */
+void _vm_start(void);
+
+
 #endif